@@ -23,5 +23,11 @@ public class Grid : ModuleRules
                 "UnrealEd"
             }
         );
+
+        // Heightmap PNGs are inflated a row at a time by the importer
+        AddEngineThirdPartyPrivateStaticDependencies(Target, "zlib");
+
+        // Pathfinding traces are a debugging aid, shipping builds leave the recorder out
+        PublicDefinitions.Add("WITH_GRID_PATH_TRACE=" + (Target.Configuration != UnrealTargetConfiguration.Shipping ? "1" : "0"));
     }
 }
\ No newline at end of file
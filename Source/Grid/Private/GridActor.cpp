@@ -4,15 +4,23 @@
 #include "GridActor.h"
 
 #include "GridUtilities.h"
+#include "GridChunkStore.h"
+#include "GridSnapshot.h"
 #include "Components/InstancedStaticMeshComponent.h"
 #include "GridGenerateInstancesWorker.h"
 #include "Async/Async.h"
+#include "Camera/PlayerCameraManager.h"
+#include "Containers/Ticker.h"
+#include "GameFramework/PlayerController.h"
+#include "Misc/Paths.h"
 
 // Sets default values
 AGridActor::AGridActor()
 {
 	// Set this actor to call Tick() every frame.  You can turn this off to improve performance if you don't need it.
-	PrimaryActorTick.bCanEverTick = false;
+	// Only ticks while chunk streaming is running
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
 
 	GridComponent = CreateDefaultSubobject<UInstancedStaticMeshComponent>(TEXT("GridComponent"));
 	RootComponent = GridComponent;
@@ -21,31 +29,84 @@ AGridActor::AGridActor()
 
 	InitializeInstances(GridMesh, GridMaterial);
 
-	GridGenerateInstancesWorker = nullptr;
+	Occupancy.OnOccupancyChanged.AddUObject(this, &AGridActor::HandleOccupancyChanged);
 }
 
 // Called when the game starts or when spawned
 void AGridActor::BeginPlay()
 {
 	Super::BeginPlay();
-	
+
+	RebuildOccupancy();
+
+	if (bStreamChunks)
+	{
+		StartChunkStreaming();
+	}
+}
+
+void AGridActor::EndPlay(const EEndPlayReason::Type EndPlayReason)
+{
+	StopChunkStreaming();
+
+	Super::EndPlay(EndPlayReason);
 }
 
 void AGridActor::BeginDestroy()
 {
-	if (GridGenerateInstancesWorker)
+	CancelGeneration();
+	Super::BeginDestroy();
+}
+
+void AGridActor::PostRegisterAllComponents()
+{
+	Super::PostRegisterAllComponents();
+
+	// Loaded Grids, and Grids saved with all their instances on the root, get their chunk components back
+	if (ChunkInstances.IsEmpty() && (!GetGridTiles().IsEmpty() || GridComponent->GetInstanceCount() > 0))
 	{
-		delete GridGenerateInstancesWorker;
-		GridGenerateInstancesWorker = nullptr;
+		RebuildInstances();
 	}
-	Super::BeginDestroy();
 }
 
+#if WITH_EDITOR
+void AGridActor::PostEditUndo()
+{
+	Super::PostEditUndo();
+
+	CachedSnapshot.Reset();
+	RecordGridReset();
+	RebuildOccupancy();
+	RebuildInstances();
+}
+#endif
+
 
 // Called every frame
 void AGridActor::Tick(float DeltaTime)
 {
 	Super::Tick(DeltaTime);
+
+	if (TerrainTracer)
+	{
+		TerrainTracer->Tick(GetWorld(), this);
+	}
+
+	if (GenerationQueue)
+	{
+		DrainGenerationQueue();
+	}
+
+	if (ChunkStore)
+	{
+		UpdateChunkStreaming();
+	}
+}
+
+bool AGridActor::ShouldTickIfViewportsOnly() const
+{
+	// Lets streaming follow the focus actors in the editor too, and Grids spawned in the editor fill in
+	return ChunkStore.IsValid() || GenerationQueue.IsValid();
 }
 
 // ***
@@ -61,18 +122,191 @@ void AGridActor::SpawnGrid(const FVector CenterLocation, const FVector TileSize,
 	DestroyGrid();
 
 	CalculateCenterAndBottomLeft(GridCenterLocation, GridBottomLeftCorner);
+
+	// Lets the Tile payload rebuild default transforms instead of storing them
+	GridTilesData->GridOrigin = GridBottomLeftCorner;
+	GridTilesData->GridTileSize = GridTileSize;
 	
-	GridGenerateInstancesWorker = new FGridGenerateInstancesWorker(this, GridCenterLocation, GridTileSize, GridTileCount, GridBottomLeftCorner, bFastGen);
-	GridGenerateInstancesWorker->CreateThread("GridThread");
+	// Traced Grids come in through the generation queue as their chunks finish tracing
+	if (bConformToWorld)
+	{
+		GenerationQueue = MakeShared<FGridGenerationQueue>();
+		TerrainTracer = MakeShared<FGridTerrainTracer>(ConformSettings, GridBottomLeftCorner, GridTileSize, GridTileCount, GenerationQueue.ToSharedRef());
+		SetActorTickEnabled(true);
+		return;
+	}
+
+	// Nothing to generate, the Tiles are there by default
+	if (bImplicitTiles && !bStreamChunks)
+	{
+		OnGridGenerated.Broadcast();
+		return;
+	}
+
+	const TSharedRef<FGridGenerateInstancesWorker> Worker = MakeShared<FGridGenerateInstancesWorker>(GridCenterLocation, GridTileSize, GridTileCount, GridBottomLeftCorner, bFastGen);
+	Worker->bTerrain = bGenerateTerrain;
+	Worker->TerrainSettings = TerrainSettings;
+
+	// Streamed Grids are generated straight into the chunk store and never held in memory as a whole
+	if (bStreamChunks)
+	{
+		Worker->ChunkStore = GetOrCreateChunkStore();
+	}
+	else if (bProgressiveGeneration)
+	{
+		GenerationQueue = MakeShared<FGridGenerationQueue>();
+		Worker->GenerationQueue = GenerationQueue;
+		SetActorTickEnabled(true);
+	}
+
+	// The jobs only reach the Grid through a weak pointer, so they can finish after it's gone
+	const FGridJobHandle Generate = FGridJobScheduler::Launch(TEXT("GenerateGrid"), [Worker](FGridJob& Job)
+	{
+		return Worker->Run(Job);
+	});
+	GenerationJobs.Emplace(Generate);
+
+	const TWeakObjectPtr<AGridActor> WeakThis(this);
+
+	// Progressive Grids are drained by Tick, the others are handed over once generation is done
+	if (bStreamChunks)
+	{
+		GenerationJobs.Emplace(FGridJobScheduler::LaunchOnGameThread(TEXT("SetGridChunkSummaries"), [Worker, WeakThis](FGridJob&)
+		{
+			if (AGridActor* This = WeakThis.Get())
+			{
+				This->SetChunkSummaries(MoveTemp(Worker->ChunkSummaries));
+			}
+			return true;
+		}, {Generate}));
+	}
+	else if (!bProgressiveGeneration)
+	{
+		GenerationJobs.Emplace(FGridJobScheduler::LaunchOnGameThread(TEXT("TakeGeneratedGridTiles"), [Worker, WeakThis](FGridJob&)
+		{
+			// The buffers are moved all the way into the Grid, nothing is copied on the way
+			if (const AGridActor* This = WeakThis.Get())
+			{
+				This->TakeGeneratedTiles(Worker->TakePayload(), MoveTemp(Worker->Transforms));
+			}
+			return true;
+		}, {Generate}));
+	}
+}
+
+void AGridActor::ImportGrid(const FVector CenterLocation, const FVector TileSize, const FGridImportSettings& Settings)
+{
+	GridCenterLocation = CenterLocation;
+	GridTileSize = TileSize;
+
+	DestroyGrid();
+
+	// The size only comes out of the files, so the import always goes through the chunk store, starting from an empty one
+	const bool bStreamImportedGrid = bStreamChunks;
+	const TSharedRef<FGridChunkStore> Store = GetOrCreateChunkStore().ToSharedRef();
+	Store->Clear();
+
+	const TSharedRef<FGridImporter> Importer = MakeShared<FGridImporter>(Settings, GridCenterLocation, GridTileSize, Store);
+
+	const FGridJobHandle Import = FGridJobScheduler::Launch(TEXT("ImportGrid"), [Importer](FGridJob& Job)
+	{
+		return Importer->Run(Job);
+	});
+	GenerationJobs.Emplace(Import);
+
+	const TWeakObjectPtr<AGridActor> WeakThis(this);
+	GenerationJobs.Emplace(FGridJobScheduler::LaunchOnGameThread(TEXT("SetImportedGridChunkSummaries"), [Importer, WeakThis, bStreamImportedGrid](FGridJob&)
+	{
+		if (AGridActor* This = WeakThis.Get())
+		{
+			This->GridTileCount = Importer->GetGridSize();
+			This->CalculateCenterAndBottomLeft(This->GridCenterLocation, This->GridBottomLeftCorner);
+			This->GridTilesData->GridOrigin = This->GridBottomLeftCorner;
+			This->GridTilesData->GridTileSize = This->GridTileSize;
+
+			This->SetChunkSummaries(MoveTemp(Importer->ChunkSummaries));
+
+			// A Grid that doesn't stream gets every imported chunk in memory and stops reading from the store
+			if (!bStreamImportedGrid)
+			{
+				TArray<FIntPoint> Chunks;
+				This->ChunkSummaries.GetKeys(Chunks);
+				for (const FIntPoint Chunk : Chunks)
+				{
+					This->LoadChunkNow(Chunk);
+				}
+
+				This->StopChunkStreaming();
+				This->bStreamChunks = false;
+			}
+
+			This->OnGridGenerated.Broadcast();
+		}
+		return true;
+	}, {Import}));
+}
+
+bool AGridActor::IsGenerating() const
+{
+	return GenerationQueue.IsValid() || TerrainTracer.IsValid() || GenerationJobs.ContainsByPredicate([](const FGridJobHandle& Job)
+	{
+		return !Job.IsComplete();
+	});
+}
+
+float AGridActor::GetGenerationProgress() const
+{
+	if (TerrainTracer)
+	{
+		return TerrainTracer->GetProgress();
+	}
+
+	return GenerationJobs.IsEmpty() ? 1.0f : GenerationJobs[0].GetProgress();
+}
+
+void AGridActor::CancelGeneration()
+{
+	for (const FGridJobHandle& Job : GenerationJobs)
+	{
+		Job.Cancel();
+	}
+	GenerationJobs.Empty();
+	TerrainTracer.Reset();
+
+	// Chunks of the previous Grid still on their way in are dropped with the queue
+	if (GenerationQueue)
+	{
+		GenerationQueue.Reset();
+		SetActorTickEnabled(ChunkStore.IsValid());
+	}
 }
 
 
-void AGridActor::GenerateGridTiles(const TArray<FTransform> Transforms, const TArray<FIntVector> Indexes, const TMap<FIntVector, FGridTileData> GridTiles, const TMap<FIntPoint, FTileHeightTranslator> TileHeightTranslator) const
+void AGridActor::GenerateGridTiles(const TArray<FTransform>& Transforms, const TArray<FIntVector>& Indexes, const TMap<FIntVector, FGridTileData>& GridTiles, const TMap<FIntPoint, FTileHeightTranslator>& TileHeightTranslator) const
 {
-	GridComponent->AddInstances(Transforms, false, false, false);
-	GetGridTiles() = GridTiles;
-	GetInstanceIndexes() = Indexes;
-	GetTileHeightTranslator() = TileHeightTranslator;
+	// Blueprints own their containers, this is the one copy
+	FGridTilesPayload Payload;
+	Payload.GridTiles = GridTiles;
+	Payload.InstanceIndexes = Indexes;
+	Payload.TileHeightTranslator = TileHeightTranslator;
+
+	TakeGeneratedTiles(MoveTemp(Payload), TArray<FTransform>(Transforms));
+}
+
+void AGridActor::TakeGeneratedTiles(FGridTilesPayload&& Payload, TArray<FTransform>&& Transforms) const
+{
+	AddInstances(Payload.InstanceIndexes, Transforms);
+
+	// The instance components keep their own copy, the transforms can go before the Tiles move in
+	Transforms.Empty();
+	Payload.InstanceIndexes.Empty();
+
+	GetGridTiles() = MoveTemp(Payload.GridTiles);
+	GetTileHeightTranslator() = MoveTemp(Payload.TileHeightTranslator);
+	CachedSnapshot.Reset();
+	RecordGridReset();
+	RebuildOccupancy();
+	OnGridGenerated.Broadcast();
 }
 
 
@@ -81,7 +315,11 @@ void AGridActor::AddGridTiles(const TArray<FIntVector> Indexes) const
 	if (Indexes.IsEmpty())
 		return;
 
+	// Deferred edits were made first, they have to land first
+	CommitTileEdits();
+
 	TArray<FTransform> Transforms;
+	TArray<FIntVector> Added;
 
 	for (FIntVector Index : Indexes)
 	{
@@ -94,41 +332,25 @@ void AGridActor::AddGridTiles(const TArray<FIntVector> Indexes) const
 				GetTileScale());
 					
 			Transforms.Emplace(Transform);
-			
-			GetInstanceIndexes().Emplace(Index);
+			Added.Emplace(Index);
+
 			GetGridTiles().Emplace(Index, FGridTileData(Index, ETileType::Normal, Transform));
 			AddTileToTranslator(Index);
+			MarkChunkDirty(Index);
+			RecordTileChange(Index, EGridTileChange::Added);
 		}
 	}
 	
-	GridComponent->AddInstances(Transforms, false, false, false);
+	AddInstances(Added, Transforms);
 }
 
 void AGridActor::RemoveGridTiles(const TArray<FIntVector> Indexes)
 {
 	if (Indexes.IsEmpty())
 		return;
-	
-	TArray<int32> InstanceIndexes;
-	TArray<FIntVector> InstanceIndexesToRemove;
-
-	for (FIntVector Index : Indexes)
-	{
-		if (IsIndexValid(Index))
-		{
-			InstanceIndexes.Emplace(GetInstanceIndexes().Find(Index));
-			InstanceIndexesToRemove.Emplace(Index);
-			GetGridTiles().Remove(Index);
-			RemoveTileFromTranslator(Index);
-		}
-	}
-	
-	GridComponent->RemoveInstances(InstanceIndexes);
 
-	for (FIntVector InstanceIndexToRemove : InstanceIndexesToRemove)
-	{
-		GetInstanceIndexes().Remove(InstanceIndexToRemove);
-	}
+	CommitTileEdits();
+	RemoveTiles(Indexes);
 }
 
 
@@ -136,18 +358,70 @@ void AGridActor::AddGridTile(FGridTileData Data) const
 {
 	if (Data.Type != ETileType::None && IsWithinBounds(Data.Index))
 	{
+		if (bDeferTileEdits)
+		{
+			DeferTileEdit([&] { return TileEditBuffer.RecordAdd(Data); });
+			return;
+		}
+
+		// Edits deferred before deferring was turned off go in first
+		CommitTileEdits();
+
+		const EGridTileChange Change = IsIndexValid(Data.Index) ? EGridTileChange::Modified : EGridTileChange::Added;
+
+		// The new Tile comes with its own states, AddInstance replaces whatever instance was there
+		UntrackTileStates(Data.Index);
+		ImplicitInstances.Remove(Data.Index);
+
 		GetGridTiles().Emplace(Data.Index, Data);
-		RemoveTileFromTranslator(Data.Index);
 		AddTileToTranslator(Data.Index);
+		TrackTileStates(Data);
+		MarkChunkDirty(Data.Index);
+		RecordTileChange(Data.Index, Change);
+
+		// The new data decides who stands on the Tile
+		if (Occupancy.GetUnitAt(Data.Index) != Data.UnitOnTile)
+		{
+			Occupancy.RemoveAt(Data.Index);
+			Occupancy.Place(Data.UnitOnTile, Data.Index);
+		}
+
 		AddInstance(Data);
 	}
 }
 
 void AGridActor::RemoveGridTile(const FIntVector Index) const
 {
+	if (bDeferTileEdits)
+	{
+		DeferTileEdit([&] { return TileEditBuffer.RecordRemove(Index, IsIndexValid(Index)); });
+		return;
+	}
+
+	CommitTileEdits();
+
+	if (IsImplicitTile(Index))
+	{
+		SuppressImplicitTile(Index);
+		ImplicitTileStates.Remove(Index);
+		MarkChunkDirty(Index);
+		RecordTileChange(Index, EGridTileChange::Removed);
+		Occupancy.RemoveAt(Index);
+
+		if (ImplicitInstances.Remove(Index) > 0)
+		{
+			RemoveInstance(Index);
+		}
+		return;
+	}
+
 	if (GetGridTiles().Remove(Index) > 0)
 	{
+		SuppressImplicitTile(Index);
 		RemoveTileFromTranslator(Index);
+		MarkChunkDirty(Index);
+		RecordTileChange(Index, EGridTileChange::Removed);
+		Occupancy.RemoveAt(Index);
 		RemoveInstance(Index);
 	}
 }
@@ -155,318 +429,2181 @@ void AGridActor::RemoveGridTile(const FIntVector Index) const
 void AGridActor::ClearGridTiles() const
 {
 	GetGridTiles().Empty();
+	GetTileHeightTranslator().Empty();
+	GridTilesData->RemovedImplicitTiles.Empty();
+	TilesByState.Empty();
+	ImplicitTileStates.Empty();
+	TileOverlay.Empty();
+	TileEditBuffer.Reset();
+	CachedSnapshot.Reset();
+	RecordGridReset();
+	Occupancy.Reset();
 }
 
 
 void AGridActor::DestroyGrid()
 {
+	// A Grid still being generated would otherwise land on top of the cleared one
+	CancelGeneration();
+
 	ClearGridTiles();
 	ClearInstances();
-}
-
-
-void AGridActor::CalculateCenterAndBottomLeft(FVector& CenterLocation, FVector& BottomLeftCornerLocation) const
-{
-	const FVector LocalCenterLocation = UGridUtilities::SnapVectorToVector(GridCenterLocation, GridTileSize);
 
-	CenterLocation = LocalCenterLocation;
-	BottomLeftCornerLocation = LocalCenterLocation - (GridTileSize * FVector(((GridTileCount - FIntPoint(GridTileCount.X % 2 == 0 ? 0 : 1, GridTileCount.Y % 2 == 0 ? 0 : 1)) / 2.0f),0.0f));
-	
+	if (ChunkStore)
+	{
+		// In-flight saves would otherwise write the old Grid back into the store
+		FlushChunkStreaming();
+		ChunkStore->Clear();
+		ChunkSummaries.Empty();
+		LoadedChunks.Empty();
+		DirtyChunks.Empty();
+		bChunkSummariesDirty = false;
+	}
 }
 
 
 // ***
-// Grid Utilities
+// Grid Regions
 // ***
 
-FVector AGridActor::GetTileLocationFromGridIndex(const FIntVector Index) const
-{
-	return GridBottomLeftCorner + (GridTileSize * FVector(Index));
-}
-
-FVector AGridActor::GetTileScale() const
+int32 AGridActor::FillRect(const FIntPoint Min, const FIntPoint Max, const ETileType Type, const int32 Height)
 {
-	return GridTileSize / 100.f;
-}
+	CommitTileEdits();
 
-FIntVector AGridActor::GetTileIndexFromWorldLocation(const FVector Location) const
-{
-	const FVector LocationOnGrid = Location - GridBottomLeftCorner;
+	TArray<FIntVector> Indexes;
+	for (int32 y = FMath::Max(Min.Y, 0); y <= FMath::Min(Max.Y, GridTileCount.Y); ++y)
+	{
+		for (int32 x = FMath::Max(Min.X, 0); x <= FMath::Min(Max.X, GridTileCount.X); ++x)
+		{
+			Indexes.Emplace(x, y, Height);
+		}
+	}
 
-	return FIntVector(UGridUtilities::SnapVectorToVector(LocationOnGrid, GridTileSize) / GridTileSize);
+	return FillTiles(Indexes, Type);
 }
 
-TMap<FIntVector, FGridTileData>& AGridActor::GetGridTiles() const
+int32 AGridActor::SetTypeInRegion(const FIntPoint Min, const FIntPoint Max, const ETileType Type)
 {
-	return  GridTilesData->GridTiles;
-}
+	// The region is gathered from the Grid as the pending edits leave it
+	CommitTileEdits();
 
-TArray<FIntVector>& AGridActor::GetInstanceIndexes() const
-{
-	return GridTilesData->InstanceIndexes;
-}
+	TArray<FIntVector> Indexes;
+	GatherRectTiles(Min, Max, Indexes);
 
-TMap<FIntPoint, FTileHeightTranslator>& AGridActor::GetTileHeightTranslator() const
-{
-	return GridTilesData->TileHeightTranslator;
+	return SetTileTypes(Indexes, Type);
 }
 
-TArray<FIntVector> AGridActor::FindGridTilesAtIndex(const FIntPoint Index) const
+int32 AGridActor::RaiseRegion(const FIntPoint Min, const FIntPoint Max, const int32 Amount)
 {
-	 return GetTileHeightTranslator().FindRef(Index).Translator;
-}
+	CommitTileEdits();
 
-bool AGridActor::IsIndexValid(const FIntVector Index) const
-{
-	return GetGridTiles().Contains(Index);
-}
+	TArray<FIntVector> Indexes;
+	GatherRectTiles(Min, Max, Indexes);
 
-bool AGridActor::IsWithinBounds(const FIntVector Index) const
-{
-	return (Index.X >= 0 && Index.X <= GridTileCount.X) && (Index.Y >= 0 && Index.Y <= GridTileCount.Y);
+	return MoveTiles(Indexes, Amount);
 }
 
-bool AGridActor::IsTileWalkable(const FIntVector Index) const
+int32 AGridActor::ApplyStencil(const FIntVector Origin, const TArray<FIntVector>& Offsets, const EGridStencilOperation Operation, const ETileType Type, const int32 Amount)
 {
-	return UGridTilesData::IsTileTypeWalkable(GetGridTiles().Find(Index)->Type);
-}
-
+	CommitTileEdits();
 
-void AGridActor::AddTileToTranslator(FIntVector Index) const
-{
-	FTileHeightTranslator Translator = GetTileHeightTranslator().FindRef(FIntPoint(Index.X, Index.Y));
-	Translator.Translator.Emplace(Index);
-	GetTileHeightTranslator().Emplace(FIntPoint(Index.X, Index.Y), Translator);
-}
+	TArray<FIntVector> Indexes;
+	Indexes.Reserve(Offsets.Num());
 
-void AGridActor::RemoveTileFromTranslator(FIntVector Index) const
-{
-	FTileHeightTranslator Translator = GetTileHeightTranslator().FindRef(FIntPoint(Index.X, Index.Y));
-	Translator.Translator.Remove(Index);
-	
-	if (Translator.Translator.IsEmpty())
+	if (Operation == EGridStencilOperation::Raise)
 	{
-		GetTileHeightTranslator().Remove(FIntPoint(Index.X, Index.Y));
+		TSet<FIntPoint> Columns;
+		for (const FIntVector Offset : Offsets)
+		{
+			const FIntPoint Column(Origin.X + Offset.X, Origin.Y + Offset.Y);
+			if (!Columns.Contains(Column))
+			{
+				Columns.Add(Column);
+				Indexes.Append(GetGridTilesAtIndex(Column));
+			}
+		}
+
+		return MoveTiles(Indexes, Amount);
 	}
-	else
+
+	for (const FIntVector Offset : Offsets)
 	{
-		GetTileHeightTranslator().Emplace(FIntPoint(Index.X, Index.Y), Translator);
+		Indexes.Emplace(Origin + Offset);
 	}
 
-}
-
-
-
-//	***
-// Instance code
-//	***
+	switch (Operation)
+	{
+	case EGridStencilOperation::Fill:
+		return FillTiles(Indexes, Type);
 
-void AGridActor::AddInstance(const FGridTileData& Data) const
-{
-	RemoveInstance(Data.Index);
+	case EGridStencilOperation::SetType:
+		return SetTileTypes(Indexes, Type);
 
-	GridComponent->AddInstance(Data.Transform);
+	case EGridStencilOperation::Remove:
+		return RemoveTiles(Indexes);
 
-	GetInstanceIndexes().Emplace(Data.Index);
+	default:
+		return 0;
+	}
 }
 
-void AGridActor::RemoveInstance(const FIntVector Index) const
+int32 AGridActor::FillTiles(const TConstArrayView<FIntVector> Indexes, const ETileType Type)
 {
-	if (GetInstanceIndexes().Contains(Index))
+	if (Type == ETileType::None)
 	{
-		GridComponent->RemoveInstance(GetInstanceIndexes().Find(Index));
-		GetInstanceIndexes().Remove(Index);
+		return RemoveTiles(Indexes);
 	}
-}
 
-void AGridActor::ClearInstances() const
-{
-	GridComponent->ClearInstances();
-	GetInstanceIndexes().Empty();
-}
+	FGridInstanceEdits Edits;
+	int32 Touched = 0;
 
-void AGridActor::MoveGridTile(const FIntVector Index, const int32 MoveAmount)
-{
-	/*if (IsIndexValid(FIntVector(Index.X, Index.Y, Index.Z + 1 * MoveAmount)))
+	for (const FIntVector Index : Indexes)
 	{
-		MoveGridTile(Index, MoveAmount + MoveAmount);
-	}*/
-	
-	const FGridTileData Data = GetGridTiles().FindRef(Index);
-	RemoveGridTile(Index);
+		if (!IsWithinBounds(Index))
+		{
+			continue;
+		}
 
-	const FTransform Transform = FTransform(
-	 Data.Transform.GetRotation(),
-	 FVector(Data.Transform.GetLocation().X, Data.Transform.GetLocation().Y, Data.Transform.GetLocation().Z + GridTileSize.Z * MoveAmount),
-	 Data.Transform.GetScale3D()
-	 );
-            
-	AddGridTile(
-		FGridTileData(
-			 FIntVector(Data.Index.X, Data.Index.Y, Data.Index.Z + 1 * MoveAmount),
-			 Data.Type,
-			Transform,
-			Data.States
-			));
-}
+		// Existing Tiles keep their transform, states and unit
+		if (FGridTileData* Existing = GetGridTiles().Find(Index))
+		{
+			if (Existing->Type != Type)
+			{
+				Existing->Type = Type;
+				MarkChunkDirty(Index);
+				RecordTileChange(Index, EGridTileChange::Modified);
+				++Touched;
+			}
+			continue;
+		}
 
+		const FTransform Transform = FTransform(
+			FRotator(0,0,0),
+			GetTileLocationFromGridIndex(Index),
+			GetTileScale());
+
+		GetGridTiles().Emplace(Index, FGridTileData(Index, Type, Transform));
+		AddTileToTranslator(Index);
+		MarkChunkDirty(Index);
+		RecordTileChange(Index, EGridTileChange::Added);
+		Edits.Added.Emplace(Index);
+		++Touched;
+	}
 
-void AGridActor::InitializeInstances(UStaticMesh* Mesh, UMaterialInstance* Material)
-{
-	GridMesh = Mesh;
-	GridMaterial = Material;
-	
-	GridComponent->SetStaticMesh(Mesh);
-	GridComponent->SetMaterial(0, Material);
+	ApplyInstanceEdits(Edits);
+	return Touched;
 }
 
-// ***
-// Grid Patterns
-// ***
-
-TArray<FIntVector> AGridActor::GetIndexesFromPatternAndRange(FIntVector OriginIndex, const EGridPattern Pattern, const FIntPoint Range)
+int32 AGridActor::AddTiles(const TConstArrayView<FGridTileData> Tiles) const
 {
-	switch (Pattern)
+	FGridInstanceEdits Edits;
+
+	for (const FGridTileData& Data : Tiles)
 	{
-	case EGridPattern::None:
+		if (Data.Type == ETileType::None || !IsWithinBounds(Data.Index))
 		{
-			TArray<FIntVector> Result;
-			Result.Emplace(OriginIndex);
-			return Result;
+			continue;
 		}
-		
-	case EGridPattern::Line:
-		return OffsetIndexArray(GetPatternLine(Range), OriginIndex);
-		
-	case EGridPattern::Diagonal:
-		return OffsetIndexArray(GetPatternDiagonal(Range), OriginIndex);
-		
-	case EGridPattern::HalfDiagonal:
-		return OffsetIndexArray(GetPatternHalfDiagonal(Range), OriginIndex);
-		
-	case EGridPattern::Star:
-		return OffsetIndexArray(GetPatternStar(Range), OriginIndex);
-		
-	case EGridPattern::Diamond:
-		return OffsetIndexArray(GetPatternDiamond(Range), OriginIndex);
-		
-	case EGridPattern::Square:
-		return OffsetIndexArray(GetPatternSquare(Range), OriginIndex);
-	}
 
-	return TArray<FIntVector>();
-}
+		const EGridTileChange Change = IsIndexValid(Data.Index) ? EGridTileChange::Modified : EGridTileChange::Added;
 
-TArray<FIntVector> AGridActor::OffsetIndexArray(TArray<FIntVector> Array, const FIntVector Offset)
-{
-	TArray<FIntVector> Result;
-	
-	for (FIntVector Element : Array)
-	{
-		Result.Emplace(Element + Offset);
+		// The replaced Tile's instance goes, the new one comes in with the rest of the batch
+		if (GetGridTiles().Contains(Data.Index) || ImplicitInstances.Remove(Data.Index) > 0)
+		{
+			Edits.Removed.Add(Data.Index);
+		}
+		UntrackTileStates(Data.Index);
+
+		GetGridTiles().Emplace(Data.Index, Data);
+		AddTileToTranslator(Data.Index);
+		TrackTileStates(Data);
+		MarkChunkDirty(Data.Index);
+		RecordTileChange(Data.Index, Change);
+
+		if (Occupancy.GetUnitAt(Data.Index) != Data.UnitOnTile)
+		{
+			Occupancy.RemoveAt(Data.Index);
+			Occupancy.Place(Data.UnitOnTile, Data.Index);
+		}
+
+		Edits.Added.Emplace(Data.Index);
 	}
 
-	return Result;
+	ApplyInstanceEdits(Edits);
+	return Edits.Added.Num();
 }
 
-TArray<FIntVector> AGridActor::GetPatternLine(const FIntPoint Range)
+int32 AGridActor::SetTileTypes(const TConstArrayView<FIntVector> Indexes, const ETileType Type)
 {
-	TArray<FIntVector> Result;
-	
-	for (int32 i = Range.X; i <= Range.Y; ++i)
+	// Tiles can't be None, that's what removing them is for
+	if (Type == ETileType::None)
 	{
-		// Y = Right
-		Result.AddUnique(FIntVector(0, i, 0));
-		// Y = Left
-		Result.AddUnique(FIntVector(0, -i, 0));
-		// X = Up
-		Result.AddUnique(FIntVector(i, 0, 0));
-		// X = Down
-		Result.AddUnique(FIntVector(-i, 0, 0));
+		return 0;
 	}
 
-	return Result;
-}
-
-TArray<FIntVector> AGridActor::GetPatternDiagonal(const FIntPoint Range)
-{
-	TArray<FIntVector> Result;
-	
-	for (int32 i = Range.X; i <= Range.Y; ++i)
+	// Types don't show on the instances, only default Tiles that get stored need one
+	FGridInstanceEdits Edits;
+	int32 Touched = 0;
+	for (const FIntVector Index : Indexes)
 	{
-		// X = Up	Y = Right
-		Result.AddUnique(FIntVector(i, i, 0));
-		// X = Down	Y = Left
-		Result.AddUnique(FIntVector(-i, -i, 0));
-		// X = Up	Y = Left
-		Result.AddUnique(FIntVector(i, -i, 0));
-		// X = Down	Y = Right
-		Result.AddUnique(FIntVector(-i, i, 0));
+		FGridTileData* Data = GetGridTiles().Find(Index);
+		if (!Data && IsImplicitTile(Index) && Type != ETileType::Normal)
+		{
+			Data = MaterializeImplicitTile(Index, Edits);
+		}
+
+		if (Data && Data->Type != Type)
+		{
+			Data->Type = Type;
+			MarkChunkDirty(Index);
+			RecordTileChange(Index, EGridTileChange::Modified);
+			++Touched;
+		}
 	}
 
-	return Result;
+	ApplyInstanceEdits(Edits);
+	return Touched;
 }
 
-TArray<FIntVector> AGridActor::GetPatternHalfDiagonal(const FIntPoint Range)
+int32 AGridActor::MoveTiles(const TConstArrayView<FIntVector> Indexes, const int32 MoveAmount)
 {
-	return GetPatternDiagonal(FIntPoint(Range.X, Range.Y / 2));
+	return MoveTiles(Indexes, MakeArrayView(&MoveAmount, 1));
 }
 
-TArray<FIntVector> AGridActor::GetPatternStar(const FIntPoint Range)
+int32 AGridActor::MoveTiles(const TConstArrayView<FIntVector> Indexes, const TConstArrayView<int32> MoveAmounts)
 {
-	TArray<FIntVector> Result = GetPatternLine(Range);
-	TArray<FIntVector> Diagonal = GetPatternDiagonal(Range);
-
-	Result.Append(Diagonal);
+	check(MoveAmounts.Num() == 1 || MoveAmounts.Num() == Indexes.Num());
 
-	return  Result;
-}
+	// Take every moving Tile out first, so Tiles moving within the same column never collide with each other
+	TArray<TPair<FGridTileData, int32>> Moving;
+	TArray<TPair<AActor*, FIntVector>> Units;
+	TSet<FIntVector> MovingImplicit;
+	Moving.Reserve(Indexes.Num());
 
-TArray<FIntVector> AGridActor::GetPatternDiamond(const FIntPoint Range)
-{
-	TArray<FIntVector> Result;
+	for (int32 i = 0; i < Indexes.Num(); ++i)
+	{
+		const FIntVector Index = Indexes[i];
+		const int32 MoveAmount = MoveAmounts.Num() == 1 ? MoveAmounts[0] : MoveAmounts[i];
+		if (MoveAmount == 0)
+		{
+			continue;
+		}
+
+		// Default Tiles leave nothing stored behind, they're taken from the default instead
+		FGridTileData Data;
+		if (IsImplicitTile(Index))
+		{
+			Data = MakeImplicitTile(Index);
+			ImplicitTileStates.Remove(Index);
+
+			// One showing its states or overlay already has an instance to move
+			if (ImplicitInstances.Remove(Index) == 0)
+			{
+				MovingImplicit.Add(Index);
+			}
+		}
+		else if (!GetGridTiles().RemoveAndCopyValue(Index, Data))
+		{
+			continue;
+		}
+
+		SuppressImplicitTile(Index);
+		RemoveTileFromTranslator(Index);
+		MarkChunkDirty(Index);
+		RecordTileChange(Index, EGridTileChange::Removed);
+
+		if (AActor* Unit = Occupancy.RemoveAt(Index))
+		{
+			Units.Emplace(Unit, Index + FIntVector(0, 0, MoveAmount));
+		}
+
+		Moving.Emplace(MoveTemp(Data), MoveAmount);
+	}
+
+	FGridInstanceEdits Edits;
+	Edits.Moved.Reserve(Moving.Num());
+
+	for (TPair<FGridTileData, int32>& Move : Moving)
+	{
+		FGridTileData& Data = Move.Key;
+		const int32 MoveAmount = Move.Value;
+		const FIntVector From = Data.Index;
+		const FIntVector To = From + FIntVector(0, 0, MoveAmount);
+
+		Data.Index = To;
+		Data.Transform.AddToTranslation(FVector(0.0f, 0.0f, GridTileSize.Z * MoveAmount));
+
+		// A Tile that stays where this one lands gets replaced, like AddGridTile does
+		const bool bReplaced = GetGridTiles().Remove(To) > 0;
+		if (bReplaced)
+		{
+			RemoveTileFromTranslator(To);
+			Occupancy.RemoveAt(To);
+			Edits.Removed.Add(To);
+		}
+		else if (ImplicitInstances.Remove(To) > 0)
+		{
+			Edits.Removed.Add(To);
+		}
+
+		TrackTileStates(Data);
+		GetGridTiles().Emplace(To, MoveTemp(Data));
+		AddTileToTranslator(To);
+		MarkChunkDirty(To);
+		RecordTileChange(To, bReplaced ? EGridTileChange::Modified : EGridTileChange::Added);
+
+		// A default Tile without an instance gets one where it lands
+		if (MovingImplicit.Contains(From))
+		{
+			Edits.Added.Emplace(To);
+		}
+		else
+		{
+			Edits.Moved.Emplace(From, To);
+		}
+	}
+
+	for (const TPair<AActor*, FIntVector>& Unit : Units)
+	{
+		Occupancy.Place(Unit.Key, Unit.Value);
+	}
+
+	ApplyInstanceEdits(Edits);
+	return Moving.Num();
+}
+
+int32 AGridActor::RemoveTiles(const TConstArrayView<FIntVector> Indexes)
+{
+	FGridInstanceEdits Edits;
+	int32 Touched = 0;
+
+	for (const FIntVector Index : Indexes)
+	{
+		// Default Tiles only have an instance while they show states or an overlay, otherwise there's just the default to switch off
+		if (IsImplicitTile(Index))
+		{
+			SuppressImplicitTile(Index);
+			ImplicitTileStates.Remove(Index);
+			MarkChunkDirty(Index);
+			RecordTileChange(Index, EGridTileChange::Removed);
+			Occupancy.RemoveAt(Index);
+			++Touched;
+
+			if (ImplicitInstances.Remove(Index) > 0)
+			{
+				Edits.Removed.Add(Index);
+			}
+			continue;
+		}
+
+		if (GetGridTiles().Remove(Index) > 0)
+		{
+			SuppressImplicitTile(Index);
+			RemoveTileFromTranslator(Index);
+			MarkChunkDirty(Index);
+			RecordTileChange(Index, EGridTileChange::Removed);
+			Occupancy.RemoveAt(Index);
+			Edits.Removed.Add(Index);
+			++Touched;
+		}
+	}
+
+	ApplyInstanceEdits(Edits);
+	return Touched;
+}
+
+void AGridActor::GatherRectTiles(const FIntPoint Min, const FIntPoint Max, TArray<FIntVector>& OutIndexes) const
+{
+	for (int32 y = FMath::Max(Min.Y, 0); y <= FMath::Min(Max.Y, GridTileCount.Y); ++y)
+	{
+		for (int32 x = FMath::Max(Min.X, 0); x <= FMath::Min(Max.X, GridTileCount.X); ++x)
+		{
+			OutIndexes.Append(GetGridTilesAtIndex(FIntPoint(x, y)));
+		}
+	}
+}
+
+
+// ***
+// Grid States
+// ***
+
+int32 AGridActor::SetTilesState(const TArray<FIntVector>& Indexes, const ETileState State, const bool bEnabled)
+{
+	// A Tile added or moved by a pending edit only gets its state once it's there
+	CommitTileEdits();
+
+	TArray<FIntVector> Changed;
+	Changed.Reserve(Indexes.Num());
+	FGridInstanceEdits ImplicitEdits;
+
+	for (const FIntVector Index : Indexes)
+	{
+		FGridTileData* Data = GetGridTiles().Find(Index);
+
+		// Highlighting never stores a default Tile, its states are kept beside it and it gets an instance to show them
+		if (!Data)
+		{
+			if (IsImplicitTile(Index) && SetImplicitTileState(Index, State, bEnabled))
+			{
+				RecordTileChange(Index, EGridTileChange::Modified);
+				UpdateImplicitInstance(Index, ImplicitEdits);
+				Changed.Emplace(Index);
+			}
+			continue;
+		}
+
+		if (bEnabled)
+		{
+			if (Data->States.Contains(State))
+			{
+				continue;
+			}
+
+			Data->States.Add(State);
+			TilesByState.FindOrAdd(State).Add(Index);
+		}
+		else if (Data->States.Remove(State) == 0)
+		{
+			continue;
+		}
+
+		MarkChunkDirty(Index);
+		RecordTileChange(Index, EGridTileChange::Modified);
+		Changed.Emplace(Index);
+	}
+
+	ApplyInstanceEdits(ImplicitEdits);
+	UpdateInstanceStates(Changed);
+	return Changed.Num();
+}
+
+int32 AGridActor::ClearTileState(const ETileState State)
+{
+	CommitTileEdits();
+
+	TSet<FIntVector> Tiles;
+	if (!TilesByState.RemoveAndCopyValue(State, Tiles))
+	{
+		return 0;
+	}
+
+	return SetTilesState(Tiles.Array(), State, false);
+}
+
+bool AGridActor::SetImplicitTileState(const FIntVector Index, const ETileState State, const bool bEnabled) const
+{
+	if (bEnabled)
+	{
+		TArray<ETileState>& States = ImplicitTileStates.FindOrAdd(Index);
+		if (States.Contains(State))
+		{
+			return false;
+		}
+
+		States.Add(State);
+		TilesByState.FindOrAdd(State).Add(Index);
+		return true;
+	}
+
+	TArray<ETileState>* States = ImplicitTileStates.Find(Index);
+	if (!States || States->Remove(State) == 0)
+	{
+		return false;
+	}
+
+	if (States->IsEmpty())
+	{
+		ImplicitTileStates.Remove(Index);
+	}
+	return true;
+}
+
+void AGridActor::UpdateInstanceStates(const TConstArrayView<FIntVector> Indexes) const
+{
+	TMap<FIntPoint, TSet<FIntVector>> ChunkTiles;
+	for (const FIntVector Index : Indexes)
+	{
+		ChunkTiles.FindOrAdd(FGridChunk::GetChunkCoord(Index)).Add(Index);
+	}
+
+	for (const TPair<FIntPoint, TSet<FIntVector>>& Pair : ChunkTiles)
+	{
+		const FGridChunkInstances* Instances = ChunkInstances.Find(Pair.Key);
+		if (!Instances)
+		{
+			continue;
+		}
+
+		// One pass over the chunk's slots instead of a Find per Tile, the render data is rebuilt once per chunk
+		bool bWritten = false;
+		for (int32 Slot = 0; Slot < Instances->Indexes.Num(); ++Slot)
+		{
+			if (!Pair.Value.Contains(Instances->Indexes[Slot]))
+			{
+				continue;
+			}
+
+			if (const FGridTileData* Data = FindInstancedTile(Instances->Indexes[Slot]))
+			{
+				WriteInstanceCustomData(Instances->Component, Slot, *Data);
+				bWritten = true;
+			}
+		}
+
+		if (bWritten)
+		{
+			Instances->Component->MarkRenderStateDirty();
+		}
+	}
+}
+
+void AGridActor::WriteInstanceCustomData(UInstancedStaticMeshComponent* Component, const int32 Slot, const FGridTileData& Data) const
+{
+	float CustomData[InstanceCustomDataFloats];
+	MakeInstanceCustomData(Data, CustomData);
+
+	// The render data is rebuilt once for the whole batch by the caller
+	Component->SetCustomData(Slot, CustomData, false);
+}
+
+void AGridActor::MakeInstanceCustomData(const FGridTileData& Data, const TArrayView<float> OutCustomData) const
+{
+	uint32 Mask = 0;
+	for (const ETileState State : Data.States)
+	{
+		Mask |= 1u << static_cast<uint8>(State);
+	}
+
+	OutCustomData[0] = 0.0f;
+	OutCustomData[1] = static_cast<float>(Mask);
+	OutCustomData[2] = TileOverlay.FindRef(Data.Index);
+
+	for (const ETileState State : HighlightPriority)
+	{
+		if (Mask & (1u << static_cast<uint8>(State)))
+		{
+			OutCustomData[0] = static_cast<float>(State);
+			break;
+		}
+	}
+}
+
+void AGridActor::SetTilesOverlay(const TArray<FIntVector>& Indexes, const float Value)
+{
+	FGridInstanceEdits Edits;
+	for (const FIntVector Index : Indexes)
+	{
+		TileOverlay.Emplace(Index, Value);
+		UpdateImplicitInstance(Index, Edits);
+	}
+
+	ApplyInstanceEdits(Edits);
+	UpdateInstanceStates(Indexes);
+}
+
+void AGridActor::ClearTilesOverlay()
+{
+	TArray<FIntVector> Indexes;
+	TileOverlay.GenerateKeyArray(Indexes);
+	TileOverlay.Empty();
+
+	FGridInstanceEdits Edits;
+	for (const FIntVector Index : Indexes)
+	{
+		UpdateImplicitInstance(Index, Edits);
+	}
+
+	ApplyInstanceEdits(Edits);
+	UpdateInstanceStates(Indexes);
+}
+
+void AGridActor::TrackTileStates(const FGridTileData& Data) const
+{
+	for (const ETileState State : Data.States)
+	{
+		TilesByState.FindOrAdd(State).Add(Data.Index);
+	}
+}
+
+void AGridActor::UntrackTileStates(const FIntVector Index) const
+{
+	const FGridTileData* Data = GetGridTiles().Find(Index);
+	if (const TArray<ETileState>* States = Data ? &Data->States : ImplicitTileStates.Find(Index))
+	{
+		for (const ETileState State : *States)
+		{
+			if (TSet<FIntVector>* Tiles = TilesByState.Find(State))
+			{
+				Tiles->Remove(Index);
+			}
+		}
+	}
+
+	ImplicitTileStates.Remove(Index);
+	TileOverlay.Remove(Index);
+}
+
+
+void AGridActor::CalculateCenterAndBottomLeft(FVector& CenterLocation, FVector& BottomLeftCornerLocation) const
+{
+	CenterLocation = UGridUtilities::SnapVectorToVector(GridCenterLocation, GridTileSize);
+	BottomLeftCornerLocation = UGridUtilities::GetGridBottomLeftCorner(GridCenterLocation, GridTileSize, GridTileCount);
+}
+
+
+// ***
+// Grid Utilities
+// ***
+
+FVector AGridActor::GetTileLocationFromGridIndex(const FIntVector Index) const
+{
+	return GridBottomLeftCorner + (GridTileSize * FVector(Index));
+}
+
+FVector AGridActor::GetTileScale() const
+{
+	return GridTileSize / 100.f;
+}
+
+FIntVector AGridActor::GetTileIndexFromWorldLocation(const FVector Location) const
+{
+	const FVector LocationOnGrid = Location - GridBottomLeftCorner;
+
+	return FIntVector(UGridUtilities::SnapVectorToVector(LocationOnGrid, GridTileSize) / GridTileSize);
+}
+
+TMap<FIntVector, FGridTileData>& AGridActor::GetGridTiles() const
+{
+	return  GridTilesData->GridTiles;
+}
+
+TMap<FIntPoint, FTileHeightTranslator>& AGridActor::GetTileHeightTranslator() const
+{
+	return GridTilesData->TileHeightTranslator;
+}
+
+TArray<FIntVector> AGridActor::FindGridTilesAtIndex(const FIntPoint Index) const
+{
+	return TArray<FIntVector>(GetGridTilesAtIndex(Index));
+}
+
+TArrayView<const FIntVector> AGridActor::GetGridTilesAtIndex(const FIntPoint Index) const
+{
+	const FTileHeightTranslator* Translator = GetTileHeightTranslator().Find(Index);
+	const TArrayView<const FIntVector> Stored = Translator ? TArrayView<const FIntVector>(Translator->Translator) : TArrayView<const FIntVector>();
+
+	if (!IsImplicitTile(FIntVector(Index.X, Index.Y, 0)))
+	{
+		return Stored;
+	}
+
+	// The default Tile sorts in with the stored ones of its column
+	ImplicitColumn.Translator.Reset();
+	ImplicitColumn.Translator.Append(Stored);
+	ImplicitColumn.AddTile(FIntVector(Index.X, Index.Y, 0));
+
+	return ImplicitColumn.Translator;
+}
+
+bool AGridActor::IsIndexValid(const FIntVector Index) const
+{
+	return GetGridTiles().Contains(Index) || IsImplicitTile(Index);
+}
+
+bool AGridActor::IsWithinBounds(const FIntVector Index) const
+{
+	return (Index.X >= 0 && Index.X <= GridTileCount.X) && (Index.Y >= 0 && Index.Y <= GridTileCount.Y);
+}
+
+bool AGridActor::IsTileWalkable(const FIntVector Index) const
+{
+	if (const FGridTileData* Data = GetGridTiles().Find(Index))
+	{
+		return UGridTilesData::IsTileTypeWalkable(Data->Type);
+	}
+
+	// Implicit Tiles are Normal
+	if (IsImplicitTile(Index))
+	{
+		return true;
+	}
+
+	return IsTileInUnloadedChunk(Index) && IsUnloadedTileWalkable(Index);
+}
+
+bool AGridActor::IsImplicitTile(const FIntVector Index) const
+{
+	return bImplicitTiles
+		&& Index.Z == 0
+		&& Index.X >= 0 && Index.X < GridTileCount.X
+		&& Index.Y >= 0 && Index.Y < GridTileCount.Y
+		&& !GetGridTiles().Contains(Index)
+		&& !GridTilesData->RemovedImplicitTiles.Contains(FIntPoint(Index.X, Index.Y));
+}
+
+bool AGridActor::FindTileData(const FIntVector Index, FGridTileData& OutData) const
+{
+	if (const FGridTileData* Data = GetGridTiles().Find(Index))
+	{
+		OutData = *Data;
+		return true;
+	}
+
+	if (IsImplicitTile(Index))
+	{
+		OutData = MakeImplicitTile(Index);
+		return true;
+	}
+
+	return false;
+}
+
+FGridTileData AGridActor::MakeImplicitTile(const FIntVector Index) const
+{
+	FGridTileData Data(
+		Index,
+		ETileType::Normal,
+		FTransform(FRotator(0,0,0), GetTileLocationFromGridIndex(Index), GetTileScale()));
+
+	// The registry is the only place a unit on a default Tile is kept, its states are kept beside it too
+	Data.UnitOnTile = Occupancy.GetUnitAt(Index);
+	if (const TArray<ETileState>* States = ImplicitTileStates.Find(Index))
+	{
+		Data.States = *States;
+	}
+	return Data;
+}
+
+void AGridActor::GetImplicitTilesWithData(TArray<FIntVector>& OutIndexes) const
+{
+	TSet<FIntVector> Indexes;
+	for (const TPair<FIntVector, TArray<ETileState>>& Pair : ImplicitTileStates)
+	{
+		if (IsImplicitTile(Pair.Key))
+		{
+			Indexes.Add(Pair.Key);
+		}
+	}
+
+	Occupancy.ForEachOccupiedTile([&](const FIntVector Index)
+	{
+		if (IsImplicitTile(Index))
+		{
+			Indexes.Add(Index);
+		}
+	});
+
+	OutIndexes = Indexes.Array();
+}
+
+
+TSharedRef<const FGridSnapshot> AGridActor::GetGridSnapshot() const
+{
+	if (!CachedSnapshot)
+	{
+		CachedSnapshot = MakeShared<const FGridSnapshot>(FGridSnapshot::Capture(*this));
+	}
+	else if (!SnapshotDirtyChunks.IsEmpty())
+	{
+		// Holders of the previous snapshot keep their version, only the edited chunks get copied again
+		FGridSnapshot Snapshot = CachedSnapshot->Fork();
+		for (const FIntPoint Chunk : SnapshotDirtyChunks)
+		{
+			Snapshot.SetChunk(Chunk, FGridSnapshot::CaptureChunk(*this, Chunk));
+		}
+		CachedSnapshot = MakeShared<const FGridSnapshot>(MoveTemp(Snapshot));
+	}
+
+	SnapshotDirtyChunks.Empty();
+	return CachedSnapshot.ToSharedRef();
+}
+
+bool AGridActor::GetChangedTilesSince(const int64 Version, TArray<FIntVector>& OutTiles, TArray<FIntRect>& OutRects) const
+{
+	return ChangeJournal.GetChangedTilesSince(Version, OutTiles, OutRects);
+}
+
+bool AGridActor::GetDirtyRectsSince(const int64 Version, TArray<FIntRect>& OutRects) const
+{
+	return ChangeJournal.GetDirtyRectsSince(Version, OutRects);
+}
+
+
+// ***
+// Grid Queries
+// ***
+
+int32 AGridActor::QueryTilesInRect(const FIntPoint Min, const FIntPoint Max, const FGridTileQueryFilter& Filter, TArray<FIntVector>& OutTiles) const
+{
+	return SpatialIndex.QueryRect(*this, Min, Max, FGridTileFilterMask::Make(Filter), OutTiles);
+}
+
+int32 AGridActor::QueryTilesInRadius(const FIntPoint Center, const float Radius, const FGridTileQueryFilter& Filter, TArray<FIntVector>& OutTiles) const
+{
+	return SpatialIndex.QueryRadius(*this, Center, Radius, FGridTileFilterMask::Make(Filter), OutTiles);
+}
+
+int32 AGridActor::QueryNearestTiles(const FIntVector Origin, const int32 Count, const FGridTileQueryFilter& Filter, TArray<FIntVector>& OutTiles, const int32 MaxRadius) const
+{
+	return SpatialIndex.QueryNearest(*this, Origin, Count, MaxRadius, FGridTileFilterMask::Make(Filter), OutTiles);
+}
+
+bool AGridActor::FindNearestTileToLocation(const FVector Location, const FGridTileQueryFilter& Filter, FIntVector& OutIndex, const int32 MaxRadius) const
+{
+	TArray<FIntVector> Nearest;
+	if (SpatialIndex.QueryNearest(*this, GetTileIndexFromWorldLocation(Location), 1, MaxRadius, FGridTileFilterMask::Make(Filter), Nearest) == 0)
+	{
+		return false;
+	}
+
+	OutIndex = Nearest[0];
+	return true;
+}
+
+bool AGridActor::TraceGridTiles(const FVector Start, const FVector End, FGridRayHit& OutHit) const
+{
+	// Grid space, column (x, y) covers [x, x + 1) on both axes
+	const FVector Origin = (Start - GridBottomLeftCorner) / GridTileSize + FVector(0.5, 0.5, 0.0);
+	const FVector Delta = (End - Start) / GridTileSize;
+	const FIntPoint ColumnCount = GridTileCount + FIntPoint(1, 1);
+
+	// Only the part of the segment over the Grid columns is walked
+	double TMin = 0.0;
+	double TMax = 1.0;
+	for (int32 Axis = 0; Axis < 2; ++Axis)
+	{
+		if (FMath::IsNearlyZero(Delta[Axis]))
+		{
+			if (Origin[Axis] < 0.0 || Origin[Axis] >= ColumnCount[Axis])
+			{
+				return false;
+			}
+			continue;
+		}
+
+		const double T0 = -Origin[Axis] / Delta[Axis];
+		const double T1 = (ColumnCount[Axis] - Origin[Axis]) / Delta[Axis];
+		TMin = FMath::Max(TMin, FMath::Min(T0, T1));
+		TMax = FMath::Min(TMax, FMath::Max(T0, T1));
+	}
+
+	if (TMin >= TMax)
+	{
+		return false;
+	}
+
+	const FVector Entry = Origin + Delta * TMin;
+	FIntPoint Column(
+		FMath::Clamp(FMath::FloorToInt32(Entry.X), 0, ColumnCount.X - 1),
+		FMath::Clamp(FMath::FloorToInt32(Entry.Y), 0, ColumnCount.Y - 1));
+
+	// Ray parameter of the next column boundary on each axis, and between two boundaries
+	FIntPoint Step;
+	double TNext[2];
+	double TStep[2];
+	for (int32 Axis = 0; Axis < 2; ++Axis)
+	{
+		Step[Axis] = Delta[Axis] >= 0.0 ? 1 : -1;
+
+		if (FMath::IsNearlyZero(Delta[Axis]))
+		{
+			TNext[Axis] = TStep[Axis] = TNumericLimits<double>::Max();
+			continue;
+		}
+
+		const double Boundary = Column[Axis] + (Step[Axis] > 0 ? 1 : 0);
+		TNext[Axis] = (Boundary - Origin[Axis]) / Delta[Axis];
+		TStep[Axis] = 1.0 / FMath::Abs(Delta[Axis]);
+	}
+
+	const double HalfHeight = GridTileSize.Z * 0.5;
+	const double DeltaZ = End.Z - Start.Z;
+
+	// Part of [TEnter, TExit] the ray spends within a Tile step of Z, the earliest one in the column wins
+	double BestT = TNumericLimits<double>::Max();
+	const auto TestTile = [&](const FIntVector Index, const double TileZ, const double TEnter, const double TExit)
+	{
+		double T0 = TEnter;
+		double T1 = TExit;
+		if (FMath::IsNearlyZero(DeltaZ))
+		{
+			if (FMath::Abs(Start.Z - TileZ) > HalfHeight)
+			{
+				return;
+			}
+		}
+		else
+		{
+			const double TBottom = (TileZ - HalfHeight - Start.Z) / DeltaZ;
+			const double TTop = (TileZ + HalfHeight - Start.Z) / DeltaZ;
+			T0 = FMath::Max(T0, FMath::Min(TBottom, TTop));
+			T1 = FMath::Min(T1, FMath::Max(TBottom, TTop));
+		}
+
+		if (T0 <= T1 && T0 < BestT)
+		{
+			BestT = T0;
+			OutHit.Index = Index;
+		}
+	};
+
+	double TEnter = TMin;
+	while (TEnter < TMax)
+	{
+		const double TExit = FMath::Min3(TNext[0], TNext[1], TMax);
+
+		if (const FTileHeightTranslator* Translator = GetTileHeightTranslator().Find(Column))
+		{
+			for (const FIntVector Index : Translator->Translator)
+			{
+				// Conformed Tiles sit at their traced height, not at their Index
+				const FGridTileData* Data = GetGridTiles().Find(Index);
+				TestTile(Index, Data ? Data->Transform.GetLocation().Z : GetTileLocationFromGridIndex(Index).Z, TEnter, TExit);
+			}
+		}
+
+		const FIntVector Implicit(Column.X, Column.Y, 0);
+		if (IsImplicitTile(Implicit))
+		{
+			TestTile(Implicit, GetTileLocationFromGridIndex(Implicit).Z, TEnter, TExit);
+		}
+
+		// Columns are walked in ray order, nothing further along can be hit first
+		if (BestT <= TExit)
+		{
+			OutHit.Location = Start + (End - Start) * BestT;
+			OutHit.Distance = (End - Start).Size() * BestT;
+			return true;
+		}
+
+		const int32 Axis = TNext[0] < TNext[1] ? 0 : 1;
+		Column[Axis] += Step[Axis];
+		TEnter = TNext[Axis];
+		TNext[Axis] += TStep[Axis];
+	}
+
+	return false;
+}
+
+
+// ***
+// Grid Units
+// ***
+
+bool AGridActor::PlaceUnit(AActor* Unit, const FIntVector Index)
+{
+	return IsValid(Unit) && IsIndexValid(Index) && Occupancy.Place(Unit, Index);
+}
+
+bool AGridActor::MoveUnit(AActor* Unit, const FIntVector To)
+{
+	return IsValid(Unit) && IsIndexValid(To) && Occupancy.Move(Unit, To);
+}
+
+AActor* AGridActor::RemoveUnitFromTile(const FIntVector Index)
+{
+	return Occupancy.RemoveAt(Index);
+}
+
+bool AGridActor::RemoveUnit(AActor* Unit)
+{
+	return Occupancy.RemoveUnit(Unit);
+}
+
+AActor* AGridActor::GetUnitOnTile(const FIntVector Index) const
+{
+	return Occupancy.GetUnitAt(Index);
+}
+
+bool AGridActor::FindUnitTile(const AActor* Unit, FIntVector& OutIndex) const
+{
+	return Occupancy.FindUnitTile(Unit, OutIndex);
+}
+
+bool AGridActor::IsTileOccupied(const FIntVector Index) const
+{
+	return Occupancy.IsOccupied(Index);
+}
+
+int32 AGridActor::GetAdjacentUnits(const FIntVector Index, const bool bIncludeDiagonals, TArray<AActor*>& OutUnits, const int32 MaxHeightDifference) const
+{
+	return Occupancy.GetAdjacentUnits(Index, bIncludeDiagonals, MaxHeightDifference, OutUnits);
+}
+
+void AGridActor::RebuildOccupancy() const
+{
+	Occupancy.Reset();
+
+	for (const TPair<FIntVector, FGridTileData>& Pair : GetGridTiles())
+	{
+		if (IsValid(Pair.Value.UnitOnTile))
+		{
+			Occupancy.Place(Pair.Value.UnitOnTile, Pair.Key);
+		}
+	}
+}
+
+void AGridActor::HandleOccupancyChanged(const FIntVector Index, AActor* Unit)
+{
+	// Keep the Tile data in step, it's what gets saved and what Blueprints read
+	if (FGridTileData* Data = GetGridTiles().Find(Index))
+	{
+		Data->UnitOnTile = Unit;
+	}
+
+	if (CachedSnapshot)
+	{
+		SnapshotDirtyChunks.Add(FGridChunk::GetChunkCoord(Index));
+	}
+
+	OnTileOccupancyChanged.Broadcast(Index, Unit);
+}
+
+
+// ***
+// Utilities
+// ***
+
+void AGridActor::AddTileToTranslator(FIntVector Index) const
+{
+	GetTileHeightTranslator().FindOrAdd(FIntPoint(Index.X, Index.Y)).AddTile(Index);
+}
+
+void AGridActor::RemoveTileFromTranslator(FIntVector Index) const
+{
+	const FIntPoint Column(Index.X, Index.Y);
+	FTileHeightTranslator* Translator = GetTileHeightTranslator().Find(Column);
+
+	if (Translator && Translator->RemoveTile(Index) && Translator->Translator.IsEmpty())
+	{
+		GetTileHeightTranslator().Remove(Column);
+	}
+}
+
+FGridTileData* AGridActor::MaterializeImplicitTile(const FIntVector Index, FGridInstanceEdits& Edits) const
+{
+	if (!IsImplicitTile(Index))
+	{
+		return GetGridTiles().Find(Index);
+	}
+
+	FGridTileData& Data = GetGridTiles().Emplace(Index, MakeImplicitTile(Index));
+	ImplicitTileStates.Remove(Index);
+	AddTileToTranslator(Index);
+
+	// Stored Tiles always have an instance, added with the rest of the edit. One shown for the default goes
+	if (ImplicitInstances.Remove(Index) > 0)
+	{
+		Edits.Removed.Add(Index);
+	}
+	Edits.Added.Emplace(Index);
+	return &Data;
+}
+
+void AGridActor::SuppressImplicitTile(const FIntVector Index) const
+{
+	if (bImplicitTiles && Index.Z == 0)
+	{
+		GridTilesData->RemovedImplicitTiles.Add(FIntPoint(Index.X, Index.Y));
+	}
+}
+
+
+
+//	***
+// Instance code
+//	***
+
+void AGridActor::AddInstance(const FGridTileData& Data) const
+{
+	RemoveInstance(Data.Index);
+
+	FGridChunkInstances& Instances = FindOrCreateChunkInstances(FGridChunk::GetChunkCoord(Data.Index));
+	const int32 Slot = Instances.Component->AddInstance(Data.Transform);
+	Instances.Indexes.Emplace(Data.Index);
+
+	if (!Data.States.IsEmpty() || TileOverlay.Contains(Data.Index))
+	{
+		WriteInstanceCustomData(Instances.Component, Slot, Data);
+		Instances.Component->MarkRenderStateDirty();
+	}
+}
+
+void AGridActor::RemoveInstance(const FIntVector Index) const
+{
+	FGridChunkInstances* Instances = ChunkInstances.Find(FGridChunk::GetChunkCoord(Index));
+	if (!Instances)
+	{
+		return;
+	}
+
+	// At most one chunk worth of slots to look through
+	const int32 Slot = Instances->Indexes.Find(Index);
+	if (Slot != INDEX_NONE)
+	{
+		Instances->Component->RemoveInstance(Slot);
+		Instances->Indexes.RemoveAt(Slot);
+	}
+}
+
+void AGridActor::ClearInstances() const
+{
+	for (TPair<FIntPoint, FGridChunkInstances>& Pair : ChunkInstances)
+	{
+		if (Pair.Value.Component)
+		{
+			Pair.Value.Component->DestroyComponent();
+		}
+	}
+	ChunkInstances.Empty();
+	ImplicitInstances.Empty();
+
+	// Grids saved before instances were split per chunk kept them on the root
+	GridComponent->ClearInstances();
+	GridTilesData->InstanceIndexes.Empty();
+}
+
+void AGridActor::AddInstances(const TConstArrayView<FIntVector> Indexes, const TConstArrayView<FTransform> Transforms) const
+{
+	check(Indexes.Num() == Transforms.Num());
+
+	for (int32 First = 0; First < Indexes.Num();)
+	{
+		const FIntPoint Chunk = FGridChunk::GetChunkCoord(Indexes[First]);
+
+		int32 Last = First + 1;
+		while (Last < Indexes.Num() && FGridChunk::GetChunkCoord(Indexes[Last]) == Chunk)
+		{
+			++Last;
+		}
+
+		FGridChunkInstances& Instances = FindOrCreateChunkInstances(Chunk);
+		Instances.Component->AddInstances(TArray<FTransform>(Transforms.Slice(First, Last - First)), false, false, false);
+		Instances.Indexes.Append(Indexes.Slice(First, Last - First));
+
+		First = Last;
+	}
+}
+
+FGridChunkInstances& AGridActor::FindOrCreateChunkInstances(const FIntPoint Chunk) const
+{
+	FGridChunkInstances& Instances = ChunkInstances.FindOrAdd(Chunk);
+	if (Instances.Component)
+	{
+		return Instances;
+	}
+
+	// Components are owned by the actor like the rest of the instance state the const edits keep up to date
+	AGridActor* Owner = const_cast<AGridActor*>(this);
+
+	UInstancedStaticMeshComponent* Component = NewObject<UInstancedStaticMeshComponent>(Owner, NAME_None, RF_Transient);
+	Component->SetMobility(GridComponent->Mobility);
+	Component->SetStaticMesh(GridMesh);
+	Component->SetMaterial(0, GridMaterial);
+	Component->SetCollisionProfileName(GridComponent->GetCollisionProfileName());
+	Component->SetCollisionEnabled(GridComponent->GetCollisionEnabled());
+	Component->SetNumCustomDataFloats(InstanceCustomDataFloats);
+	Component->SetupAttachment(GridComponent);
+
+	if (GetWorld())
+	{
+		Component->RegisterComponent();
+	}
+
+	Instances.Component = Component;
+	return Instances;
+}
+
+const FGridTileData* AGridActor::FindInstancedTile(const FIntVector Index) const
+{
+	if (const FGridTileData* Data = GetGridTiles().Find(Index))
+	{
+		return Data;
+	}
+
+	if (!ImplicitInstances.Contains(Index))
+	{
+		return nullptr;
+	}
+
+	ImplicitInstanceTile = MakeImplicitTile(Index);
+	return &ImplicitInstanceTile;
+}
+
+void AGridActor::UpdateImplicitInstance(const FIntVector Index, FGridInstanceEdits& Edits) const
+{
+	const bool bShown = IsImplicitTile(Index) && (ImplicitTileStates.Contains(Index) || TileOverlay.Contains(Index));
+	if (bShown == ImplicitInstances.Contains(Index))
+	{
+		return;
+	}
+
+	if (bShown)
+	{
+		ImplicitInstances.Add(Index);
+		Edits.Added.Emplace(Index);
+	}
+	else
+	{
+		ImplicitInstances.Remove(Index);
+		Edits.Removed.Add(Index);
+	}
+}
+
+void AGridActor::RebuildInstances() const
+{
+	ClearInstances();
+
+	TilesByState.Empty();
+
+	TMap<FIntPoint, TPair<TArray<FIntVector>, TArray<FTransform>>> Chunks;
+	TArray<FIntVector> Highlighted;
+	for (const TPair<FIntVector, FGridTileData>& Pair : GetGridTiles())
+	{
+		TPair<TArray<FIntVector>, TArray<FTransform>>& Chunk = Chunks.FindOrAdd(FGridChunk::GetChunkCoord(Pair.Key));
+		Chunk.Key.Emplace(Pair.Key);
+		Chunk.Value.Emplace(Pair.Value.Transform);
+
+		if (!Pair.Value.States.IsEmpty())
+		{
+			Highlighted.Emplace(Pair.Key);
+			TrackTileStates(Pair.Value);
+		}
+	}
+
+	// Default Tiles only get an instance while they show states or an overlay
+	TSet<FIntVector> Shown;
+	for (const TPair<FIntVector, TArray<ETileState>>& Pair : ImplicitTileStates)
+	{
+		for (const ETileState State : Pair.Value)
+		{
+			TilesByState.FindOrAdd(State).Add(Pair.Key);
+		}
+		Shown.Add(Pair.Key);
+	}
+
+	for (const TPair<FIntVector, float>& Pair : TileOverlay)
+	{
+		Shown.Add(Pair.Key);
+	}
+
+	for (const FIntVector Index : Shown)
+	{
+		if (IsImplicitTile(Index))
+		{
+			TPair<TArray<FIntVector>, TArray<FTransform>>& Chunk = Chunks.FindOrAdd(FGridChunk::GetChunkCoord(Index));
+			Chunk.Key.Emplace(Index);
+			Chunk.Value.Emplace(MakeImplicitTile(Index).Transform);
+			ImplicitInstances.Add(Index);
+			Highlighted.Emplace(Index);
+		}
+		else if (GetGridTiles().Contains(Index))
+		{
+			Highlighted.Emplace(Index);
+		}
+	}
+
+	for (const TPair<FIntPoint, TPair<TArray<FIntVector>, TArray<FTransform>>>& Pair : Chunks)
+	{
+		AddInstances(Pair.Value.Key, Pair.Value.Value);
+	}
+
+	UpdateInstanceStates(Highlighted);
+}
+
+void AGridActor::MoveGridTile(const FIntVector Index, const int32 MoveAmount)
+{
+	if (bDeferTileEdits)
+	{
+		DeferTileEdit([&] { return TileEditBuffer.RecordMove(Index, MoveAmount, IsIndexValid(Index)); });
+		return;
+	}
+
+	CommitTileEdits();
+
+	// Moves the instance in place instead of removing and adding it
+	MoveTiles(MakeArrayView(&Index, 1), MoveAmount);
+}
+
+int32 AGridActor::MoveGridTiles(const TArray<FIntVector>& Indexes, const TArray<int32>& MoveAmounts)
+{
+	if (MoveAmounts.Num() != 1 && MoveAmounts.Num() != Indexes.Num())
+	{
+		return 0;
+	}
+
+	CommitTileEdits();
+	return MoveTiles(Indexes, MoveAmounts);
+}
+
+void AGridActor::CommitTileEdits() const
+{
+	if (TileEditBuffer.IsEmpty())
+	{
+		return;
+	}
+
+	// Taken out first, so the batches below see an empty buffer
+	FGridEditBuffer Edits = MoveTemp(TileEditBuffer);
+	TileEditBuffer.Reset();
+
+	// Deferring goes through the const edit paths too, the commit is still an edit of the Grid
+	AGridActor* MutableThis = const_cast<AGridActor*>(this);
+
+	// Removed and added Tiles are never touched by a pending move, the order doesn't matter
+	if (!Edits.Removed.IsEmpty())
+	{
+		MutableThis->RemoveTiles(Edits.Removed.Array());
+	}
+
+	if (!Edits.Added.IsEmpty())
+	{
+		TArray<FGridTileData> Tiles;
+		Edits.Added.GenerateValueArray(Tiles);
+		AddTiles(Tiles);
+	}
+
+	if (!Edits.Moved.IsEmpty())
+	{
+		TArray<FIntVector> Indexes;
+		TArray<int32> MoveAmounts;
+		Edits.Moved.GenerateKeyArray(Indexes);
+		Edits.Moved.GenerateValueArray(MoveAmounts);
+		MutableThis->MoveTiles(Indexes, MoveAmounts);
+	}
+}
+
+void AGridActor::ApplyInstanceEdits(const FGridInstanceEdits& Edits) const
+{
+	// Moves only change the height, a Tile never leaves its chunk
+	TMap<FIntPoint, FGridInstanceEdits> ChunkEdits;
+
+	for (const FIntVector Index : Edits.Removed)
+	{
+		ChunkEdits.FindOrAdd(FGridChunk::GetChunkCoord(Index)).Removed.Add(Index);
+	}
+
+	for (const TPair<FIntVector, FIntVector>& Pair : Edits.Moved)
+	{
+		ChunkEdits.FindOrAdd(FGridChunk::GetChunkCoord(Pair.Key)).Moved.Emplace(Pair.Key, Pair.Value);
+	}
+
+	for (const FIntVector Index : Edits.Added)
+	{
+		ChunkEdits.FindOrAdd(FGridChunk::GetChunkCoord(Index)).Added.Emplace(Index);
+	}
+
+	for (const TPair<FIntPoint, FGridInstanceEdits>& Pair : ChunkEdits)
+	{
+		if (Pair.Value.Added.IsEmpty() && !ChunkInstances.Contains(Pair.Key))
+		{
+			continue;
+		}
+
+		ApplyChunkInstanceEdits(FindOrCreateChunkInstances(Pair.Key), Pair.Value);
+	}
+}
+
+void AGridActor::ApplyChunkInstanceEdits(FGridChunkInstances& ChunkInstance, const FGridInstanceEdits& Edits) const
+{
+	UInstancedStaticMeshComponent* Component = ChunkInstance.Component;
+	TArray<FIntVector>& Instances = ChunkInstance.Indexes;
+
+	if (!Edits.Removed.IsEmpty() || !Edits.Moved.IsEmpty())
+	{
+		const int32 PreviousNum = Instances.Num();
+		TBitArray<> Holes(false, PreviousNum);
+		TBitArray<> Dirty(false, PreviousNum);
+		int32 HoleCount = 0;
+
+		// One pass over the instances instead of a Find per edited Tile
+		for (int32 Slot = 0; Slot < PreviousNum; ++Slot)
+		{
+			if (Edits.Removed.Contains(Instances[Slot]))
+			{
+				Holes[Slot] = true;
+				++HoleCount;
+			}
+			else if (const FIntVector* NewIndex = Edits.Moved.Find(Instances[Slot]))
+			{
+				Instances[Slot] = *NewIndex;
+				Dirty[Slot] = true;
+			}
+		}
+
+		// Refill the holes with instances from the tail, so only the tail gets removed and nothing shifts
+		int32 Tail = PreviousNum - 1;
+		for (TConstSetBitIterator<> It(Holes); It; ++It)
+		{
+			const int32 Hole = It.GetIndex();
+			while (Tail > Hole && Holes[Tail])
+			{
+				--Tail;
+			}
+
+			if (Tail <= Hole)
+			{
+				break;
+			}
+
+			Instances[Hole] = Instances[Tail];
+			Dirty[Hole] = true;
+			--Tail;
+		}
+
+		const int32 NewNum = PreviousNum - HoleCount;
+		if (NewNum < PreviousNum)
+		{
+			TArray<int32> TailSlots;
+			TailSlots.Reserve(HoleCount);
+			for (int32 Slot = PreviousNum - 1; Slot >= NewNum; --Slot)
+			{
+				TailSlots.Emplace(Slot);
+			}
+
+			Component->RemoveInstances(TailSlots);
+			Instances.SetNum(NewNum);
+		}
+
+		// Dirty slots are written in contiguous runs, one batched transform update per run
+		TArray<FTransform> RunTransforms;
+		int32 RunStart = INDEX_NONE;
+
+		const auto FlushRun = [&]
+		{
+			if (!RunTransforms.IsEmpty())
+			{
+				Component->BatchUpdateInstancesTransforms(RunStart, RunTransforms, false, false, true);
+				RunTransforms.Reset();
+			}
+		};
+
+		for (TConstSetBitIterator<> It(Dirty); It && It.GetIndex() < NewNum; ++It)
+		{
+			const int32 Slot = It.GetIndex();
+			const FGridTileData* Data = FindInstancedTile(Instances[Slot]);
+			if (!Data)
+			{
+				continue;
+			}
+
+			if (Slot != RunStart + RunTransforms.Num())
+			{
+				FlushRun();
+				RunStart = Slot;
+			}
+
+			RunTransforms.Emplace(Data->Transform);
+
+			// The slot may now hold another Tile, its highlight goes with it
+			WriteInstanceCustomData(Component, Slot, *Data);
+		}
+
+		FlushRun();
+	}
+
+	if (!Edits.Added.IsEmpty())
+	{
+		TArray<FTransform> Transforms;
+		Transforms.Reserve(Edits.Added.Num());
+
+		const int32 FirstSlot = Instances.Num();
+		for (const FIntVector Index : Edits.Added)
+		{
+			const FGridTileData* Data = FindInstancedTile(Index);
+			check(Data);
+			Transforms.Emplace(Data->Transform);
+			Instances.Emplace(Index);
+		}
+
+		Component->AddInstances(Transforms, false, false, false);
+
+		for (int32 Slot = FirstSlot; Slot < Instances.Num(); ++Slot)
+		{
+			const FGridTileData* Data = FindInstancedTile(Instances[Slot]);
+			if (!Data->States.IsEmpty() || TileOverlay.Contains(Data->Index))
+			{
+				WriteInstanceCustomData(Component, Slot, *Data);
+			}
+		}
+	}
+
+	Component->MarkRenderStateDirty();
+}
+
+
+void AGridActor::InitializeInstances(UStaticMesh* Mesh, UMaterialInstance* Material)
+{
+	GridMesh = Mesh;
+	GridMaterial = Material;
 	
-	for (int32 i = Range.X; i <= Range.Y; ++i)
+	GridComponent->SetStaticMesh(Mesh);
+	GridComponent->SetMaterial(0, Material);
+
+	for (const TPair<FIntPoint, FGridChunkInstances>& Pair : ChunkInstances)
+	{
+		Pair.Value.Component->SetStaticMesh(Mesh);
+		Pair.Value.Component->SetMaterial(0, Material);
+	}
+}
+
+// ***
+// Grid Patterns
+// ***
+
+TArray<FIntVector> AGridActor::GetIndexesFromPatternAndRange(FIntVector OriginIndex, const EGridPattern Pattern, const FIntPoint Range)
+{
+	const TSharedRef<const TArray<FIntVector>> Offsets = GetPatternOffsets(Pattern, Range);
+
+	TArray<FIntVector> Result;
+	Result.Reserve(Offsets->Num());
+	for (const FIntVector Offset : *Offsets)
+	{
+		Result.Emplace(OriginIndex + Offset);
+	}
+
+	return Result;
+}
+
+TArray<FIntVector> AGridActor::GetIndexesFromPatternTowards(FIntVector OriginIndex, const EGridPattern Pattern, const FIntPoint Range, const FIntVector TargetIndex)
+{
+	const TSharedRef<const TArray<FIntVector>> Offsets = GetPatternOffsets(Pattern, Range, FIntPoint(TargetIndex.X - OriginIndex.X, TargetIndex.Y - OriginIndex.Y));
+
+	TArray<FIntVector> Result;
+	Result.Reserve(Offsets->Num());
+	for (const FIntVector Offset : *Offsets)
+	{
+		Result.Emplace(OriginIndex + Offset);
+	}
+
+	return Result;
+}
+
+
+// ***
+// Grid Progressive Generation
+// ***
+
+void AGridActor::DrainGenerationQueue()
+{
+	const double Deadline = FPlatformTime::Seconds() + GenerationFrameBudgetMs / 1000.0;
+
+	// At least one chunk per frame, so generation always moves forward
+	FGridGeneratedChunk Chunk;
+	while (GenerationQueue->Chunks.Dequeue(Chunk))
+	{
+		TArray<FTransform> Transforms;
+		TArray<FIntVector> Indexes;
+		Transforms.Reserve(Chunk.Tiles.Num());
+		Indexes.Reserve(Chunk.Tiles.Num());
+
+		for (FGridTileData& Data : Chunk.Tiles)
+		{
+			const FIntVector Index = Data.Index;
+			Transforms.Emplace(Data.Transform);
+			Indexes.Emplace(Index);
+			AddTileToTranslator(Index);
+			GetGridTiles().Emplace(Index, MoveTemp(Data));
+		}
+
+		// Each queued chunk fills its own component
+		AddInstances(Indexes, Transforms);
+
+		// The Grid was reset once when generation started, from there listeners follow it chunk by chunk
+		if (!Indexes.IsEmpty())
+		{
+			RecordChunkChange(Chunk.Chunk, EGridTileChange::Added);
+
+			if (CachedSnapshot)
+			{
+				SnapshotDirtyChunks.Add(Chunk.Chunk);
+			}
+		}
+
+		if (FPlatformTime::Seconds() >= Deadline)
+		{
+			break;
+		}
+	}
+
+	// Complete is set after the last chunk is queued, so an empty queue past that point stays empty
+	if (GenerationQueue->bComplete && GenerationQueue->Chunks.IsEmpty())
+	{
+		GenerationQueue.Reset();
+		TerrainTracer.Reset();
+		SetActorTickEnabled(ChunkStore.IsValid());
+		OnGridGenerated.Broadcast();
+	}
+}
+
+
+// ***
+// Grid Streaming
+// ***
+
+void AGridActor::StartChunkStreaming()
+{
+	bStreamChunks = true;
+
+	if (!ChunkStore)
+	{
+		GetOrCreateChunkStore();
+
+		TMap<FIntPoint, FGridChunkSummary> StoredSummaries;
+		if (ChunkStore->LoadSummaries(StoredSummaries))
+		{
+			// Chunks already in memory win over their stored version
+			for (TPair<FIntPoint, FGridChunkSummary>& Pair : StoredSummaries)
+			{
+				ChunkSummaries.FindOrAdd(Pair.Key, MoveTemp(Pair.Value));
+			}
+		}
+	}
+
+	SetActorTickEnabled(true);
+}
+
+void AGridActor::StopChunkStreaming()
+{
+	if (!ChunkStore)
 	{
-		for (int32 j = 0; j <= i; ++j)
+		return;
+	}
+
+	FlushChunkStreaming();
+
+	const TArray<FIntPoint> ChunksToSave = DirtyChunks.Array();
+	for (const FIntPoint Chunk : ChunksToSave)
+	{
+		// Edits made inside a streamed out chunk get merged with its stored Tiles first
+		if (!LoadedChunks.Contains(Chunk) && ChunkSummaries.Contains(Chunk))
 		{
-			// X = Up	Y = Left to Right
-			Result.AddUnique(FIntVector(j, -(i - j), 0));
-			// X = Up to Down	Y = Right
-			Result.AddUnique(FIntVector(i - j, j, 0));
-			// X = Down	Y = Right to Left
-			Result.AddUnique(FIntVector(-j, i - j, 0));
-			// X = Down to Up	Y = Left
-			Result.AddUnique(FIntVector(-(i - j), -j, 0));
+			TArray<FGridTileData> StoredTiles;
+			ChunkStore->LoadChunk(Chunk, StoredTiles);
+			StreamInChunk(Chunk, MoveTemp(StoredTiles));
 		}
+
+		TArray<FIntVector> Indexes;
+		GatherChunkTiles(Chunk, Indexes);
+		SaveChunk(Chunk, Indexes, false);
 	}
+	DirtyChunks.Empty();
 
-	return Result;
+	if (bChunkSummariesDirty)
+	{
+		ChunkStore->SaveSummaries(ChunkSummaries);
+		bChunkSummariesDirty = false;
+	}
+
+	SetActorTickEnabled(GenerationQueue.IsValid());
+	ChunkStore.Reset();
 }
 
-TArray<FIntVector> AGridActor::GetPatternSquare(const FIntPoint Range)
+void AGridActor::BakeChunkStore()
 {
-	TArray<FIntVector> Result;
-	
-	for (int32 i = Range.X; i <= Range.Y; ++i)
+	const TSharedPtr<FGridChunkStore> Store = GetOrCreateChunkStore();
+
+	FlushChunkStreaming();
+	Store->Clear();
+	ChunkSummaries.Empty();
+
+	TMap<FIntPoint, TArray<FIntVector>> ChunkIndexes;
+	for (const TPair<FIntVector, FGridTileData>& Pair : GetGridTiles())
+	{
+		ChunkIndexes.FindOrAdd(FGridChunk::GetChunkCoord(Pair.Key)).Emplace(Pair.Key);
+	}
+
+	for (const TPair<FIntPoint, TArray<FIntVector>>& Pair : ChunkIndexes)
+	{
+		SaveChunk(Pair.Key, Pair.Value, false);
+		LoadedChunks.Add(Pair.Key);
+	}
+
+	DirtyChunks.Empty();
+	Store->SaveSummaries(ChunkSummaries);
+	bChunkSummariesDirty = false;
+
+	// Without streaming the store is only a bake target, don't keep it alive
+	if (!bStreamChunks)
+	{
+		ChunkStore.Reset();
+		LoadedChunks.Empty();
+	}
+}
+
+void AGridActor::AddStreamingFocus(AActor* Focus)
+{
+	if (IsValid(Focus))
+	{
+		StreamingFocusActors.AddUnique(Focus);
+	}
+}
+
+void AGridActor::RemoveStreamingFocus(AActor* Focus)
+{
+	StreamingFocusActors.Remove(Focus);
+}
+
+bool AGridActor::IsChunkLoaded(const FIntPoint Chunk) const
+{
+	return !ChunkStore || LoadedChunks.Contains(Chunk);
+}
+
+bool AGridActor::LoadChunkNow(const FIntPoint Chunk)
+{
+	if (!ChunkStore || LoadedChunks.Contains(Chunk))
+	{
+		return true;
+	}
+
+	if (!ChunkSummaries.Contains(Chunk))
 	{
-		for (int32 j = -i; j <= i; ++j)
+		return false;
+	}
+
+	// A save still writing the chunk back has to land before it's read
+	if (TFuture<void>* Save = PendingChunkSaves.Find(Chunk))
+	{
+		Save->Wait();
+		PendingChunkSaves.Remove(Chunk);
+	}
+
+	TArray<FGridTileData> Tiles;
+	if (TFuture<TSharedPtr<TArray<FGridTileData>>>* Load = PendingChunkLoads.Find(Chunk))
+	{
+		if (const TSharedPtr<TArray<FGridTileData>>& Loaded = Load->Get())
 		{
-			// X = Down to Up	Y = Left
-			Result.AddUnique(FIntVector(j, -i, 0));
-			// X = Up	Y = Left to Right
-			Result.AddUnique(FIntVector(i, j, 0));
-			// X = Up to Down	Y = Right
-			Result.AddUnique(FIntVector(-j, i, 0));
-			// X = Down	Y = Right to Left
-			Result.AddUnique(FIntVector(-i, -j, 0));
+			Tiles = MoveTemp(*Loaded);
 		}
+		PendingChunkLoads.Remove(Chunk);
+	}
+	else if (!ChunkStore->LoadChunk(Chunk, Tiles))
+	{
+		return false;
 	}
 
-	return Result;
+	StreamInChunk(Chunk, MoveTemp(Tiles));
+	return true;
+}
+
+bool AGridActor::IsTileInUnloadedChunk(const FIntVector Index) const
+{
+	const FIntPoint Chunk = FGridChunk::GetChunkCoord(Index);
+	return ChunkStore && !LoadedChunks.Contains(Chunk) && ChunkSummaries.Contains(Chunk);
+}
+
+bool AGridActor::IsUnloadedTileWalkable(const FIntVector Index) const
+{
+	const FGridChunkSummary* Summary = ChunkSummaries.Find(FGridChunk::GetChunkCoord(Index));
+	return Summary && Summary->IsColumnWalkable(FIntPoint(Index.X, Index.Y));
+}
+
+void AGridActor::SetChunkSummaries(TMap<FIntPoint, FGridChunkSummary>&& Summaries)
+{
+	ChunkSummaries = MoveTemp(Summaries);
+	LoadedChunks.Empty();
+	bChunkSummariesDirty = false;
+
+	StartChunkStreaming();
+}
+
+TSharedPtr<FGridChunkStore> AGridActor::GetOrCreateChunkStore()
+{
+	if (!ChunkStore)
+	{
+		const FString Directory = ChunkStoreDirectory.IsEmpty()
+			? FPaths::ProjectSavedDir() / TEXT("GridChunks") / GetName()
+			: ChunkStoreDirectory;
+
+		ChunkStore = MakeShared<FGridChunkStore>(Directory);
+	}
+
+	return ChunkStore;
+}
+
+void AGridActor::UpdateChunkStreaming()
+{
+	// Gather every focus point
+	TArray<FVector, TInlineAllocator<8>> FocusLocations;
+	for (const AActor* Focus : StreamingFocusActors)
+	{
+		if (IsValid(Focus))
+		{
+			FocusLocations.Emplace(Focus->GetActorLocation());
+		}
+	}
+
+	if (bStreamAroundPlayerCamera)
+	{
+		const APlayerController* PlayerController = GetWorld() ? GetWorld()->GetFirstPlayerController() : nullptr;
+		if (PlayerController && PlayerController->PlayerCameraManager)
+		{
+			FocusLocations.Emplace(PlayerController->PlayerCameraManager->GetCameraLocation());
+		}
+	}
+
+	// Chunks to load, and the slightly larger set of chunks to keep, so we don't thrash on chunk borders
+	TSet<FIntPoint> WantedChunks;
+	TSet<FIntPoint> KeptChunks;
+	const int32 KeepRadius = ChunkStreamingRadius + 1;
+	for (const FVector& Location : FocusLocations)
+	{
+		const FIntPoint Center = FGridChunk::GetChunkCoord(GetTileIndexFromWorldLocation(Location));
+
+		for (int32 x = -KeepRadius; x <= KeepRadius; ++x)
+		{
+			for (int32 y = -KeepRadius; y <= KeepRadius; ++y)
+			{
+				const FIntPoint Chunk = Center + FIntPoint(x, y);
+				if (!ChunkSummaries.Contains(Chunk))
+				{
+					continue;
+				}
+
+				KeptChunks.Add(Chunk);
+				if (FMath::Abs(x) <= ChunkStreamingRadius && FMath::Abs(y) <= ChunkStreamingRadius)
+				{
+					WantedChunks.Add(Chunk);
+				}
+			}
+		}
+	}
+
+	// Finished saves
+	for (auto It = PendingChunkSaves.CreateIterator(); It; ++It)
+	{
+		if (It.Value().IsReady())
+		{
+			It.RemoveCurrent();
+		}
+	}
+
+	// Finished loads, each chunk's instances are added on their own
+	for (auto It = PendingChunkLoads.CreateIterator(); It; ++It)
+	{
+		if (!It.Value().IsReady())
+		{
+			continue;
+		}
+
+		const TSharedPtr<TArray<FGridTileData>> Tiles = It.Value().Get();
+		if (Tiles && KeptChunks.Contains(It.Key()))
+		{
+			StreamInChunk(It.Key(), MoveTemp(*Tiles));
+		}
+		It.RemoveCurrent();
+	}
+
+	// Chunks created by edits have nothing in the store yet, they count as loaded
+	for (const FIntPoint Chunk : DirtyChunks)
+	{
+		if (!ChunkSummaries.Contains(Chunk))
+		{
+			LoadedChunks.Add(Chunk);
+		}
+	}
+
+	// Chunks no focus point cares about anymore
+	TArray<FIntPoint> ChunksToUnload;
+	for (const FIntPoint Chunk : LoadedChunks)
+	{
+		if (!KeptChunks.Contains(Chunk))
+		{
+			ChunksToUnload.Emplace(Chunk);
+		}
+	}
+
+	for (const FIntPoint Chunk : ChunksToUnload)
+	{
+		StreamOutChunk(Chunk);
+	}
+
+	// Start loading the missing chunks, unless they're still being written back
+	for (const FIntPoint Chunk : WantedChunks)
+	{
+		if (LoadedChunks.Contains(Chunk) || PendingChunkLoads.Contains(Chunk) || PendingChunkSaves.Contains(Chunk))
+		{
+			continue;
+		}
+
+		PendingChunkLoads.Emplace(Chunk, Async(EAsyncExecution::ThreadPool, [Store = ChunkStore, Chunk]()
+		{
+			TSharedPtr<TArray<FGridTileData>> Tiles = MakeShared<TArray<FGridTileData>>();
+			Store->LoadChunk(Chunk, *Tiles);
+			return Tiles;
+		}));
+	}
+
+	if (bChunkSummariesDirty && PendingChunkSaves.IsEmpty())
+	{
+		ChunkStore->SaveSummaries(ChunkSummaries);
+		bChunkSummariesDirty = false;
+	}
+}
+
+void AGridActor::StreamInChunk(const FIntPoint Chunk, TArray<FGridTileData>&& Tiles)
+{
+	TArray<FTransform> Transforms;
+	TArray<FIntVector> Indexes;
+	TArray<FIntVector> Highlighted;
+	Transforms.Reserve(Tiles.Num());
+	Indexes.Reserve(Tiles.Num());
+
+	for (FGridTileData& Tile : Tiles)
+	{
+		// Tiles edited while the chunk was unloaded are kept over their stored version, a stored Tile replaces the implicit default
+		if (GetGridTiles().Contains(Tile.Index))
+		{
+			DirtyChunks.Add(Chunk);
+			continue;
+		}
+
+		Transforms.Emplace(Tile.Transform);
+		Indexes.Emplace(Tile.Index);
+
+		if (!Tile.States.IsEmpty())
+		{
+			Highlighted.Emplace(Tile.Index);
+			TrackTileStates(Tile);
+		}
+		AddTileToTranslator(Tile.Index);
+
+		// The stored Tile takes over from a default shown with its own instance
+		if (ImplicitInstances.Remove(Tile.Index) > 0)
+		{
+			RemoveInstance(Tile.Index);
+		}
+
+		// Units stay registered while their chunk is out, the store never holds them
+		Tile.UnitOnTile = Occupancy.GetUnitAt(Tile.Index);
+
+		const FIntVector Index = Tile.Index;
+		GetGridTiles().Emplace(Index, MoveTemp(Tile));
+	}
+
+	AddInstances(Indexes, Transforms);
+	UpdateInstanceStates(Highlighted);
+	LoadedChunks.Add(Chunk);
+
+	// A whole chunk coming in would otherwise push a thousand entries through the journal
+	if (!Indexes.IsEmpty())
+	{
+		RecordChunkChange(Chunk, EGridTileChange::Added);
+	}
+
+	if (CachedSnapshot)
+	{
+		SnapshotDirtyChunks.Add(Chunk);
+	}
+}
+
+void AGridActor::StreamOutChunk(const FIntPoint Chunk)
+{
+	TArray<FIntVector> Indexes;
+	GatherChunkTiles(Chunk, Indexes);
+
+	if (DirtyChunks.Contains(Chunk))
+	{
+		SaveChunk(Chunk, Indexes, true);
+	}
+
+	// Not RemoveTiles, the Tiles still exist in the store and the journal gets one entry for the chunk.
+	// Occupancy is kept, units on the chunk are given back to their Tiles when it streams in
+	FGridInstanceEdits Edits;
+	for (const FIntVector Index : Indexes)
+	{
+		GetGridTiles().Remove(Index);
+		RemoveTileFromTranslator(Index);
+		Edits.Removed.Add(Index);
+	}
+	ApplyInstanceEdits(Edits);
+
+	if (!Indexes.IsEmpty())
+	{
+		RecordChunkChange(Chunk, EGridTileChange::Removed);
+
+		if (CachedSnapshot)
+		{
+			SnapshotDirtyChunks.Add(Chunk);
+		}
+	}
+
+	DirtyChunks.Remove(Chunk);
+	LoadedChunks.Remove(Chunk);
+}
+
+void AGridActor::GatherChunkTiles(const FIntPoint Chunk, TArray<FIntVector>& OutIndexes) const
+{
+	// Walk the chunk's columns instead of the whole Tile map, default Tiles aren't saved with the chunk
+	const FIntPoint Origin = FGridChunk::GetChunkOrigin(Chunk);
+
+	for (int32 x = 0; x < FGridChunk::Size; ++x)
+	{
+		for (int32 y = 0; y < FGridChunk::Size; ++y)
+		{
+			if (const FTileHeightTranslator* Translator = GetTileHeightTranslator().Find(Origin + FIntPoint(x, y)))
+			{
+				OutIndexes.Append(Translator->Translator);
+			}
+		}
+	}
+}
+
+void AGridActor::SaveChunk(const FIntPoint Chunk, const TArray<FIntVector>& Indexes, const bool bAsync)
+{
+	TArray<FGridTileData> Tiles;
+	Tiles.Reserve(Indexes.Num());
+
+	for (const FIntVector Index : Indexes)
+	{
+		FGridTileData& Tile = Tiles.Emplace_GetRef(GetGridTiles().FindChecked(Index));
+		Tile.UnitOnTile = nullptr;
+	}
+
+	ChunkSummaries.Emplace(Chunk, FGridChunkSummary::Build(Tiles));
+	bChunkSummariesDirty = true;
+
+	if (!bAsync)
+	{
+		ChunkStore->SaveChunk(Chunk, Tiles);
+		return;
+	}
+
+	PendingChunkSaves.Emplace(Chunk, Async(EAsyncExecution::ThreadPool, [Store = ChunkStore, Chunk, Tiles = MoveTemp(Tiles)]()
+	{
+		Store->SaveChunk(Chunk, Tiles);
+	}));
+}
+
+void AGridActor::FlushChunkStreaming()
+{
+	for (TPair<FIntPoint, TFuture<TSharedPtr<TArray<FGridTileData>>>>& Pair : PendingChunkLoads)
+	{
+		Pair.Value.Wait();
+	}
+	PendingChunkLoads.Empty();
+
+	for (TPair<FIntPoint, TFuture<void>>& Pair : PendingChunkSaves)
+	{
+		Pair.Value.Wait();
+	}
+	PendingChunkSaves.Empty();
+}
+
+void AGridActor::MarkChunkDirty(const FIntVector Index) const
+{
+	const FIntPoint Chunk = FGridChunk::GetChunkCoord(Index);
+
+	if (CachedSnapshot)
+	{
+		SnapshotDirtyChunks.Add(Chunk);
+	}
+
+	if (ChunkStore)
+	{
+		DirtyChunks.Add(Chunk);
+	}
+}
+
+
+// ***
+// Grid Changes
+// ***
+
+void AGridActor::RecordTileChange(const FIntVector Index, const EGridTileChange Change) const
+{
+	ChangeJournal.SetCapacity(ChangeJournalCapacity);
+	ChangeJournal.Record(Index, Change);
+	QueueTileChangesBroadcast();
+}
+
+void AGridActor::RecordChunkChange(const FIntPoint Chunk, const EGridTileChange Change) const
+{
+	ChangeJournal.SetCapacity(ChangeJournalCapacity);
+	ChangeJournal.RecordChunk(Chunk, Change);
+	QueueTileChangesBroadcast();
+}
+
+void AGridActor::RecordGridReset() const
+{
+	ChangeJournal.Reset();
+	SpatialIndex.Reset();
+	QueueTileChangesBroadcast();
+}
+
+void AGridActor::QueueTileChangesBroadcast() const
+{
+	if (bTileChangesBroadcastQueued)
+	{
+		return;
+	}
+
+	bTileChangesBroadcastQueued = true;
+
+	// Runs once on the next frame, so every edit of this frame goes out in a single event
+	const TWeakObjectPtr<const AGridActor> WeakThis(this);
+	FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([WeakThis](float)
+	{
+		if (const AGridActor* Grid = WeakThis.Get())
+		{
+			Grid->BroadcastTileChanges();
+		}
+		return false;
+	}));
+}
+
+void AGridActor::BroadcastTileChanges() const
+{
+	bTileChangesBroadcastQueued = false;
+
+	FGridTileChanges Changes;
+	Changes.FromVersion = LastBroadcastVersion;
+	Changes.ToVersion = ChangeJournal.GetVersion();
+	Changes.bFullRefresh = !ChangeJournal.GetChangedTilesSince(LastBroadcastVersion, Changes.Tiles, Changes.Rects);
+
+	LastBroadcastVersion = Changes.ToVersion;
+
+	if (Changes.FromVersion != Changes.ToVersion)
+	{
+		OnGridTilesChanged.Broadcast(Changes);
+	}
 }
 
 
+// ***
+// Deferred edits
+// ***
+
+void AGridActor::DeferTileEdit(const TFunctionRef<bool()> Record) const
+{
+	if (!Record())
+	{
+		CommitTileEdits();
+		verify(Record());
+	}
+
+	QueueTileEditsCommit();
+}
 
+void AGridActor::QueueTileEditsCommit() const
+{
+	if (bTileEditsCommitQueued)
+	{
+		return;
+	}
 
+	bTileEditsCommitQueued = true;
 
+	// Same as the change broadcast, every edit recorded this frame is committed together on the next one
+	const TWeakObjectPtr<const AGridActor> WeakThis(this);
+	FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([WeakThis](float)
+	{
+		if (const AGridActor* Grid = WeakThis.Get())
+		{
+			Grid->bTileEditsCommitQueued = false;
+			Grid->CommitTileEdits();
+		}
+		return false;
+	}));
+}
@@ -0,0 +1,219 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridChangeJournal.h"
+#include "GridChunk.h"
+
+template <typename FunctionType>
+void FGridChangeJournal::ForEachChangeSince(const int64 SinceVersion, FunctionType&& Function) const
+{
+	// Oldest entry first
+	const int32 Oldest = (Head - Count + Capacity) % Capacity;
+
+	for (int32 i = 0; i < Count; ++i)
+	{
+		const FGridTileChange& Entry = Entries[(Oldest + i) % Capacity];
+		if (Entry.Version > SinceVersion)
+		{
+			Function(Entry);
+		}
+	}
+}
+
+FGridChangeJournal::FGridChangeJournal(const int32 InCapacity)
+	: Capacity(FMath::Max(InCapacity, 1))
+{
+}
+
+int64 FGridChangeJournal::Record(const FIntVector Index, const EGridTileChange Change)
+{
+	return Push(FGridTileChange(0, Index, Change));
+}
+
+int64 FGridChangeJournal::RecordChunk(const FIntPoint Chunk, const EGridTileChange Change)
+{
+	const FIntPoint Origin = FGridChunk::GetChunkOrigin(Chunk);
+	return Push(FGridTileChange(0, FIntVector(Origin.X, Origin.Y, 0), Change, true));
+}
+
+int64 FGridChangeJournal::Push(const FGridTileChange& Change)
+{
+	++Version;
+
+	// The ring only takes memory once something actually changes
+	if (Entries.Num() != Capacity)
+	{
+		Entries.SetNum(Capacity);
+	}
+
+	// Overwriting the oldest change, it can't be described anymore
+	if (Count == Capacity)
+	{
+		ForgottenVersion = Entries[Head].Version;
+	}
+	else
+	{
+		++Count;
+	}
+
+	Entries[Head] = Change;
+	Entries[Head].Version = Version;
+	Head = (Head + 1) % Capacity;
+
+	ChunkVersions.Emplace(FGridChunk::GetChunkCoord(Change.Index), Version);
+
+	return Version;
+}
+
+int64 FGridChangeJournal::Reset()
+{
+	++Version;
+	ForgottenVersion = Version;
+	ResetVersion = Version;
+	Head = 0;
+	Count = 0;
+	ChunkVersions.Empty();
+
+	return Version;
+}
+
+void FGridChangeJournal::SetCapacity(const int32 InCapacity)
+{
+	const int32 NewCapacity = FMath::Max(InCapacity, 1);
+	if (NewCapacity == Capacity)
+	{
+		return;
+	}
+
+	// Keep the most recent changes that still fit
+	TArray<FGridTileChange> Kept;
+	ForEachChangeSince(ForgottenVersion, [&Kept](const FGridTileChange& Entry)
+	{
+		Kept.Emplace(Entry);
+	});
+
+	const int32 Dropped = FMath::Max(Kept.Num() - NewCapacity, 0);
+	if (Dropped > 0)
+	{
+		ForgottenVersion = Kept[Dropped - 1].Version;
+	}
+
+	Capacity = NewCapacity;
+	Entries.Reset();
+	Head = 0;
+	Count = 0;
+
+	if (Kept.Num() > Dropped)
+	{
+		Entries.SetNum(Capacity);
+		for (int32 i = Dropped; i < Kept.Num(); ++i)
+		{
+			Entries[Count++] = Kept[i];
+		}
+		Head = Count % Capacity;
+	}
+}
+
+bool FGridChangeJournal::CanDescribeChangesSince(const int64 SinceVersion) const
+{
+	return SinceVersion >= ForgottenVersion && SinceVersion <= Version;
+}
+
+bool FGridChangeJournal::GetChangesSince(const int64 SinceVersion, TArray<FGridTileChange>& OutChanges) const
+{
+	if (!CanDescribeChangesSince(SinceVersion))
+	{
+		return false;
+	}
+
+	ForEachChangeSince(SinceVersion, [&OutChanges](const FGridTileChange& Entry)
+	{
+		OutChanges.Emplace(Entry);
+	});
+
+	return true;
+}
+
+bool FGridChangeJournal::GetChangedTilesSince(const int64 SinceVersion, TArray<FIntVector>& OutTiles, TArray<FIntRect>& OutRects) const
+{
+	if (!CanDescribeChangesSince(SinceVersion))
+	{
+		return false;
+	}
+
+	TSet<FIntVector> Seen;
+	TSet<FIntVector> SeenChunks;
+	ForEachChangeSince(SinceVersion, [&](const FGridTileChange& Entry)
+	{
+		bool bAlreadySeen = false;
+		(Entry.bWholeChunk ? SeenChunks : Seen).Add(Entry.Index, &bAlreadySeen);
+
+		if (bAlreadySeen)
+		{
+			return;
+		}
+
+		if (Entry.bWholeChunk)
+		{
+			const FIntPoint Origin(Entry.Index.X, Entry.Index.Y);
+			OutRects.Emplace(Origin, Origin + FIntPoint(FGridChunk::Size));
+		}
+		else
+		{
+			OutTiles.Emplace(Entry.Index);
+		}
+	});
+
+	return true;
+}
+
+bool FGridChangeJournal::GetDirtyChunksSince(const int64 SinceVersion, TArray<FIntPoint>& OutChunks) const
+{
+	// Chunk versions outlive the ring buffer, only a reset loses them
+	if (SinceVersion < ResetVersion || SinceVersion > Version)
+	{
+		return false;
+	}
+
+	for (const TPair<FIntPoint, int64>& Pair : ChunkVersions)
+	{
+		if (Pair.Value > SinceVersion)
+		{
+			OutChunks.Emplace(Pair.Key);
+		}
+	}
+
+	return true;
+}
+
+bool FGridChangeJournal::GetDirtyRectsSince(const int64 SinceVersion, TArray<FIntRect>& OutRects) const
+{
+	TArray<FIntPoint> Chunks;
+	if (!GetDirtyChunksSince(SinceVersion, Chunks))
+	{
+		return false;
+	}
+
+	// Row by row, so neighbouring chunks of a row end up next to each other
+	Chunks.Sort([](const FIntPoint& A, const FIntPoint& B)
+	{
+		return A.Y != B.Y ? A.Y < B.Y : A.X < B.X;
+	});
+
+	for (int32 i = 0; i < Chunks.Num();)
+	{
+		int32 RunEnd = i + 1;
+		while (RunEnd < Chunks.Num() && Chunks[RunEnd].Y == Chunks[i].Y && Chunks[RunEnd].X == Chunks[RunEnd - 1].X + 1)
+		{
+			++RunEnd;
+		}
+
+		const FIntPoint Min = FGridChunk::GetChunkOrigin(Chunks[i]);
+		const FIntPoint Max = FGridChunk::GetChunkOrigin(Chunks[RunEnd - 1] + FIntPoint(1, 1));
+		OutRects.Emplace(Min, Max);
+
+		i = RunEnd;
+	}
+
+	return true;
+}
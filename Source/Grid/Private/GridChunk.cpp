@@ -0,0 +1,46 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridChunk.h"
+
+void FGridChunkSummary::AddTile(const FGridTileData& Tile)
+{
+	MinZ = TileCount == 0 ? Tile.Index.Z : FMath::Min(MinZ, Tile.Index.Z);
+	MaxZ = TileCount == 0 ? Tile.Index.Z : FMath::Max(MaxZ, Tile.Index.Z);
+	++TileCount;
+
+	if (UGridTilesData::IsTileTypeWalkable(Tile.Type))
+	{
+		++WalkableCount;
+
+		const int32 Offset = FGridChunk::GetColumnOffset(FIntPoint(Tile.Index.X, Tile.Index.Y));
+		WalkableColumns[Offset >> 6] |= 1ull << (Offset & 63);
+	}
+}
+
+FGridChunkSummary FGridChunkSummary::Build(const TArray<FGridTileData>& Tiles)
+{
+	FGridChunkSummary Summary;
+
+	for (const FGridTileData& Tile : Tiles)
+	{
+		Summary.AddTile(Tile);
+	}
+
+	return Summary;
+}
+
+FArchive& operator<<(FArchive& Ar, FGridChunkSummary& Summary)
+{
+	Ar << Summary.TileCount;
+	Ar << Summary.WalkableCount;
+	Ar << Summary.MinZ;
+	Ar << Summary.MaxZ;
+
+	for (uint64& Word : Summary.WalkableColumns)
+	{
+		Ar << Word;
+	}
+
+	return Ar;
+}
@@ -0,0 +1,206 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridChunkStore.h"
+#include "HAL/FileManager.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+namespace GridChunkStore
+{
+	// Bump whenever the chunk file layout changes, older files are then ignored
+	static constexpr int32 FileVersion = 1;
+	static constexpr uint32 ChunkMagic = 0x4B4E4347;		// "GCNK"
+	static constexpr uint32 SummaryMagic = 0x4D534347;		// "GCSM"
+
+	// Counts read back are checked against these before anything is allocated, a corrupt file can't ask for more
+	static constexpr int32 MaxTilesPerColumn = 1024;
+	static constexpr int32 MaxTilesPerChunk = FGridChunk::ColumnCount * MaxTilesPerColumn;
+	static constexpr int32 MaxStatesPerTile = static_cast<int32>(ETileState::SpellRangeAoE) + 1;
+
+	// Smallest a serialized Tile or summary entry can be, so a count can't claim more than the file holds
+	static constexpr int64 MinTileBytes = sizeof(FIntVector) + sizeof(uint8) + 10 * sizeof(double) + sizeof(int32);
+	static constexpr int64 MinSummaryBytes = sizeof(FIntPoint) + 4 * sizeof(int32) + sizeof(FGridChunkSummary::WalkableColumns);
+
+	static bool IsCountValid(FArchive& Ar, const int32 Count, const int32 MaxCount, const int64 MinBytes)
+	{
+		if (Count < 0 || Count > MaxCount || Count * MinBytes > Ar.TotalSize() - Ar.Tell())
+		{
+			Ar.SetError();
+			return false;
+		}
+		return true;
+	}
+}
+
+FGridChunkStore::FGridChunkStore(const FString& InDirectory)
+	: Directory(InDirectory)
+{
+	IFileManager::Get().MakeDirectory(*Directory, true);
+}
+
+bool FGridChunkStore::SaveChunk(const FIntPoint Chunk, const TArray<FGridTileData>& Tiles) const
+{
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+
+	uint32 Magic = GridChunkStore::ChunkMagic;
+	int32 Version = GridChunkStore::FileVersion;
+	int32 TileCount = Tiles.Num();
+	Writer << Magic << Version << TileCount;
+
+	for (const FGridTileData& Tile : Tiles)
+	{
+		SerializeTile(Writer, const_cast<FGridTileData&>(Tile));
+	}
+
+	return FFileHelper::SaveArrayToFile(Bytes, *GetChunkPath(Chunk));
+}
+
+bool FGridChunkStore::LoadChunk(const FIntPoint Chunk, TArray<FGridTileData>& OutTiles) const
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *GetChunkPath(Chunk), FILEREAD_Silent))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(Bytes);
+
+	uint32 Magic = 0;
+	int32 Version = 0;
+	int32 TileCount = 0;
+	Reader << Magic << Version << TileCount;
+
+	if (Magic != GridChunkStore::ChunkMagic || Version != GridChunkStore::FileVersion
+		|| !GridChunkStore::IsCountValid(Reader, TileCount, GridChunkStore::MaxTilesPerChunk, GridChunkStore::MinTileBytes))
+	{
+		return false;
+	}
+
+	OutTiles.SetNum(TileCount);
+	for (FGridTileData& Tile : OutTiles)
+	{
+		SerializeTile(Reader, Tile);
+
+		if (Reader.IsError())
+		{
+			OutTiles.Reset();
+			return false;
+		}
+	}
+
+	return !Reader.IsError();
+}
+
+bool FGridChunkStore::SaveSummaries(const TMap<FIntPoint, FGridChunkSummary>& Summaries) const
+{
+	TArray<uint8> Bytes;
+	FMemoryWriter Writer(Bytes);
+
+	uint32 Magic = GridChunkStore::SummaryMagic;
+	int32 Version = GridChunkStore::FileVersion;
+	int32 Count = Summaries.Num();
+	Writer << Magic << Version << Count;
+
+	for (const TPair<FIntPoint, FGridChunkSummary>& Pair : Summaries)
+	{
+		FIntPoint Chunk = Pair.Key;
+		Writer << Chunk;
+		Writer << const_cast<FGridChunkSummary&>(Pair.Value);
+	}
+
+	return FFileHelper::SaveArrayToFile(Bytes, *GetSummariesPath());
+}
+
+bool FGridChunkStore::LoadSummaries(TMap<FIntPoint, FGridChunkSummary>& OutSummaries) const
+{
+	TArray<uint8> Bytes;
+	if (!FFileHelper::LoadFileToArray(Bytes, *GetSummariesPath(), FILEREAD_Silent))
+	{
+		return false;
+	}
+
+	FMemoryReader Reader(Bytes);
+
+	uint32 Magic = 0;
+	int32 Version = 0;
+	int32 Count = 0;
+	Reader << Magic << Version << Count;
+
+	if (Magic != GridChunkStore::SummaryMagic || Version != GridChunkStore::FileVersion
+		|| !GridChunkStore::IsCountValid(Reader, Count, TNumericLimits<int32>::Max(), GridChunkStore::MinSummaryBytes))
+	{
+		return false;
+	}
+
+	OutSummaries.Empty(Count);
+	for (int32 i = 0; i < Count; ++i)
+	{
+		FIntPoint Chunk;
+		Reader << Chunk;
+		Reader << OutSummaries.Add(Chunk);
+	}
+
+	return !Reader.IsError();
+}
+
+void FGridChunkStore::Clear() const
+{
+	TArray<FString> Files;
+	IFileManager::Get().FindFiles(Files, *(Directory / TEXT("*.gchunk")), true, false);
+
+	for (const FString& File : Files)
+	{
+		IFileManager::Get().Delete(*(Directory / File), false, true, true);
+	}
+
+	IFileManager::Get().Delete(*GetSummariesPath(), false, true, true);
+}
+
+void FGridChunkStore::SerializeTile(FArchive& Ar, FGridTileData& Tile)
+{
+	// UnitOnTile is runtime only and never written to the store
+	Ar << Tile.Index;
+
+	uint8 Type = static_cast<uint8>(Tile.Type);
+	Ar << Type;
+	Tile.Type = static_cast<ETileType>(Type);
+
+	Ar << Tile.Transform;
+
+	int32 StateCount = Tile.States.Num();
+	Ar << StateCount;
+
+	if (Ar.IsLoading())
+	{
+		// States are a set, there can't be more of them than there are states
+		if (StateCount < 0 || StateCount > GridChunkStore::MaxStatesPerTile)
+		{
+			Ar.SetError();
+			Tile.States.Reset();
+			return;
+		}
+
+		Tile.States.SetNum(StateCount);
+	}
+
+	for (ETileState& State : Tile.States)
+	{
+		uint8 Value = static_cast<uint8>(State);
+		Ar << Value;
+		State = static_cast<ETileState>(Value);
+	}
+}
+
+FString FGridChunkStore::GetChunkPath(const FIntPoint Chunk) const
+{
+	return Directory / FString::Printf(TEXT("Chunk_%d_%d.gchunk"), Chunk.X, Chunk.Y);
+}
+
+FString FGridChunkStore::GetSummariesPath() const
+{
+	return Directory / TEXT("Summaries.gsum");
+}
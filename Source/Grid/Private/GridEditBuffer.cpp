@@ -0,0 +1,83 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridEditBuffer.h"
+
+bool FGridEditBuffer::RecordAdd(const FGridTileData& Data)
+{
+	if (IsMoving(Data.Index))
+	{
+		return false;
+	}
+
+	Removed.Remove(Data.Index);
+	Added.Add(Data.Index, Data);
+	return true;
+}
+
+bool FGridEditBuffer::RecordRemove(const FIntVector Index, const bool bStored)
+{
+	if (IsMoving(Index))
+	{
+		return false;
+	}
+
+	// Nothing to remove once the pending add is gone
+	if (Added.Remove(Index) > 0 && !bStored)
+	{
+		return true;
+	}
+
+	Removed.Add(Index);
+	return true;
+}
+
+bool FGridEditBuffer::RecordMove(const FIntVector Index, const int32 MoveAmount, const bool bStored)
+{
+	if (MoveAmount == 0)
+	{
+		return true;
+	}
+
+	const FIntVector Target = Index + FIntVector(0, 0, MoveAmount);
+	if (Added.Contains(Index) || Removed.Contains(Index) || Added.Contains(Target) || Removed.Contains(Target)
+		|| Moved.Contains(Index) || MoveTargets.Contains(Target))
+	{
+		return false;
+	}
+
+	const FIntVector* Source = MoveTargets.Find(Index);
+	if (!Source)
+	{
+		Moved.Add(Index, MoveAmount);
+		MoveTargets.Add(Target, Index);
+		return true;
+	}
+
+	// The Tile the pending move replaced wouldn't be there anymore, only a Tile landing on an empty spot can move on
+	if (bStored)
+	{
+		return false;
+	}
+
+	const FIntVector From = *Source;
+	MoveTargets.Remove(Index);
+
+	if (Target == From)
+	{
+		Moved.Remove(From);
+		return true;
+	}
+
+	Moved.Add(From, Target.Z - From.Z);
+	MoveTargets.Add(Target, From);
+	return true;
+}
+
+void FGridEditBuffer::Reset()
+{
+	Added.Reset();
+	Removed.Reset();
+	Moved.Reset();
+	MoveTargets.Reset();
+}
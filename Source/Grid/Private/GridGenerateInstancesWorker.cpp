@@ -2,13 +2,12 @@
 
 
 #include "GridGenerateInstancesWorker.h"
-#include "Async/Async.h"
-#include "GridActor.h"
+#include "Async/ParallelFor.h"
+#include "GridChunkStore.h"
+#include "GridTileKey.h"
 
-#pragma region Main Thread Code
-FGridGenerateInstancesWorker::FGridGenerateInstancesWorker(UObject* InWorldContext, FVector CenterLocation, FVector TileSize, FIntPoint TileCount, FVector BottomLeftCorner, bool bFastGen)
+FGridGenerateInstancesWorker::FGridGenerateInstancesWorker(FVector CenterLocation, FVector TileSize, FIntPoint TileCount, FVector BottomLeftCorner, bool bFastGen)
 {
-	WorldContext = InWorldContext;
 	GridCenterLocation = CenterLocation;
 	GridTileSize = TileSize;
 	GridTileCount = TileCount;
@@ -17,93 +16,242 @@ FGridGenerateInstancesWorker::FGridGenerateInstancesWorker(UObject* InWorldConte
 	
 }
 
-FGridGenerateInstancesWorker::~FGridGenerateInstancesWorker()
+bool FGridGenerateInstancesWorker::Run(FGridJob& Job)
 {
-	Cleanup();
+	if (ChunkStore)
+	{
+		return GenerateToChunkStore(Job);
+	}
+
+	if (GenerationQueue)
+	{
+		return GenerateToQueue(Job);
+	}
+
+	TArray<FIntPoint> Chunks;
+	GetGeneratedChunks(Chunks);
+
+	// Every chunk builds into its own slot, no locking between the tasks
+	TArray<TArray<FGridTileData>> ChunkTiles;
+	ChunkTiles.SetNum(Chunks.Num());
+
+	std::atomic<int32> ChunksBuilt = 0;
+	ParallelFor(Chunks.Num(), [this, &Job, &Chunks, &ChunkTiles, &ChunksBuilt](const int32 i)
+	{
+		if (!Job.IsCancelled())
+		{
+			BuildChunkTiles(Chunks[i], ChunkTiles[i]);
+
+			// Building is most of the work, the merge gets the last tenth
+			Job.SetProgress(0.9f * ++ChunksBuilt / Chunks.Num());
+		}
+	});
+
+	if (Job.IsCancelled())
+	{
+		return false;
+	}
+
+	TArray<int32> Offsets;
+	Offsets.SetNumUninitialized(Chunks.Num());
+	int32 TileTotal = 0;
+	for (int32 i = 0; i < Chunks.Num(); ++i)
+	{
+		Offsets[i] = TileTotal;
+		TileTotal += ChunkTiles[i].Num();
+	}
+
+	// Flat arrays are filled in parallel, each chunk owns its slice
+	Transforms.SetNumUninitialized(TileTotal);
+	InstanceIndexes.SetNumUninitialized(TileTotal);
+
+	ParallelFor(Chunks.Num(), [this, &Offsets, &ChunkTiles](const int32 i)
+	{
+		int32 Slot = Offsets[i];
+		for (const FGridTileData& Data : ChunkTiles[i])
+		{
+			Transforms[Slot] = Data.Transform;
+			InstanceIndexes[Slot] = Data.Index;
+			++Slot;
+		}
+	});
+
+	// Hashed containers can't be filled concurrently, the chunks go in one after the other.
+	// Chunks and the Tiles inside them are both in Morton order, so the storage comes out already sorted.
+	GridTiles.Reserve(TileTotal);
+	TileHeightTranslator.Reserve(TileTotal);
+
+	for (TArray<FGridTileData>& Tiles : ChunkTiles)
+	{
+		for (FGridTileData& Data : Tiles)
+		{
+			const FIntVector Index = Data.Index;
+			TileHeightTranslator.FindOrAdd(FIntPoint(Index.X, Index.Y)).AddTile(Index);
+			GridTiles.Emplace(Index, MoveTemp(Data));
+		}
+
+		// Keeps the peak close to a single copy of the Grid
+		Tiles.Empty();
+	}
+
+	return true;
 }
-#pragma endregion
 
-bool FGridGenerateInstancesWorker::Init()
+FGridTilesPayload FGridGenerateInstancesWorker::TakePayload()
 {
-	return FGridRunnable::Init();
+	FGridTilesPayload Payload;
+	Payload.GridTiles = MoveTemp(GridTiles);
+	Payload.InstanceIndexes = MoveTemp(InstanceIndexes);
+	Payload.TileHeightTranslator = MoveTemp(TileHeightTranslator);
+	return Payload;
 }
 
-uint32 FGridGenerateInstancesWorker::Run()
+bool FGridGenerateInstancesWorker::GenerateToChunkStore(FGridJob& Job)
 {
-	if (!bGridFastGen)
+	TMap<FIntPoint, FGridChunkSummary> Summaries;
+	TArray<FGridTileData> Tiles;
+
+	TArray<FIntPoint> Chunks;
+	GetGeneratedChunks(Chunks);
+
+	for (int32 i = 0; i < Chunks.Num(); ++i)
 	{
-		for (int32 x = 0; x < GridTileCount.X; ++x)
+		if (Job.IsCancelled())
 		{
-			for (int32 y = 0; y < GridTileCount.Y; ++y)
-			{
-				FillData(
-					FGridTileData(FIntVector(x,y,0),
-					ETileType::Normal,
-					FTransform(FRotator(0.0f, 0.0f, 0.0f),
-								GetTileLocationFromGridIndex(FIntVector(x,y,0)),
-								GetTileScale())));
-			}
+			return false;
+		}
+
+		const FIntPoint Chunk = Chunks[i];
+		Job.SetProgress(static_cast<float>(i) / Chunks.Num());
+
+		BuildChunkTiles(Chunk, Tiles);
+		if (Tiles.IsEmpty())
+		{
+			continue;
 		}
+
+		ChunkStore->SaveChunk(Chunk, Tiles);
+		Summaries.Emplace(Chunk, FGridChunkSummary::Build(Tiles));
 	}
-	// Only generate borders
-	else
+
+	ChunkStore->SaveSummaries(Summaries);
+	ChunkSummaries = MoveTemp(Summaries);
+	return true;
+}
+
+bool FGridGenerateInstancesWorker::GenerateToQueue(FGridJob& Job)
+{
+	TArray<FIntPoint> Chunks;
+	GetGeneratedChunks(Chunks);
+
+	// Chunks are built in parallel a batch at a time and queued in order, so the Grid keeps its Morton layout
+	constexpr int32 BatchSize = 64;
+	TArray<TArray<FGridTileData>> Batch;
+
+	for (int32 First = 0; First < Chunks.Num() && !Job.IsCancelled(); First += BatchSize)
 	{
-		for (int32 x = 0; x <= GridTileCount.X; ++x)
+		const int32 Count = FMath::Min(BatchSize, Chunks.Num() - First);
+		Batch.SetNum(Count);
+
+		ParallelFor(Count, [this, &Chunks, &Batch, First](const int32 i)
+		{
+			BuildChunkTiles(Chunks[First + i], Batch[i]);
+		});
+
+		for (int32 i = 0; i < Count; ++i)
 		{
-			FillData(
-				FGridTileData(FIntVector(x,0,0),
-				ETileType::Normal,
-				FTransform(FRotator(0.0f, 0.0f, 0.0f),
-							GetTileLocationFromGridIndex(FIntVector(x,0,0)),
-							GetTileScale())));
-			FillData(
-				FGridTileData(FIntVector(x,GridTileCount.Y,0),
-				ETileType::Normal,
-				FTransform(FRotator(0.0f, 0.0f, 0.0f),
-							GetTileLocationFromGridIndex(FIntVector(x,GridTileCount.Y,0)),
-							GetTileScale())));
+			if (!Batch[i].IsEmpty())
+			{
+				GenerationQueue->Chunks.Enqueue(FGridGeneratedChunk(Chunks[First + i], MoveTemp(Batch[i])));
+			}
 		}
-		for (int32 y = 1; y < GridTileCount.Y; ++y)
+
+		Job.SetProgress(static_cast<float>(First + Count) / Chunks.Num());
+	}
+
+	GenerationQueue->bComplete = true;
+	return true;
+}
+
+void FGridGenerateInstancesWorker::GetGeneratedChunks(TArray<FIntPoint>& OutChunks) const
+{
+	const FIntPoint LastIndex = GetLastIndex();
+	if (LastIndex.X < 0 || LastIndex.Y < 0)
+	{
+		return;
+	}
+
+	const FIntPoint LastChunk = FGridChunk::GetChunkCoord(LastIndex);
+	OutChunks.Reserve((LastChunk.X + 1) * (LastChunk.Y + 1));
+
+	for (int32 ChunkX = 0; ChunkX <= LastChunk.X; ++ChunkX)
+	{
+		for (int32 ChunkY = 0; ChunkY <= LastChunk.Y; ++ChunkY)
 		{
-			FillData(
-				FGridTileData(FIntVector(0,y,0),
-				ETileType::Normal,
-				FTransform(FRotator(0.0f, 0.0f, 0.0f),
-							GetTileLocationFromGridIndex(FIntVector(0,y,0)),
-							GetTileScale())));
-			FillData(
-				FGridTileData(FIntVector(GridTileCount.X,y,0),
-				ETileType::Normal,
-				FTransform(FRotator(0.0f, 0.0f, 0.0f),
-							GetTileLocationFromGridIndex(FIntVector(GridTileCount.X,y,0)),
-							GetTileScale())));
+			// Border generation only touches the outer ring of chunks
+			if (bGridFastGen && ChunkX != 0 && ChunkY != 0 && ChunkX != LastChunk.X && ChunkY != LastChunk.Y)
+			{
+				continue;
+			}
+
+			OutChunks.Emplace(ChunkX, ChunkY);
 		}
 	}
 
-	AsyncTask(ENamedThreads::GameThread, [this]()
+	OutChunks.Sort([](const FIntPoint A, const FIntPoint B)
 	{
-		AGridActor* Grid = Cast<AGridActor>(WorldContext);
-		Grid->GenerateGridTiles(Transforms, InstanceIndexes, GridTiles, TileHeightTranslator);
+		return FGridTileKey::GetColumnCode(A) < FGridTileKey::GetColumnCode(B);
 	});
-	
-	bDone = true;
-
-	// ? I hear that it's good to let the thread sleep a bit, so the OS can utilise it better or something.
-	// ^- https://unrealcommunity.wiki/multithreading-with-frunnable-2a4xuf68
-	FPlatformProcess::Sleep(0.01f);
-	
-	return 0;
 }
 
-void FGridGenerateInstancesWorker::FillData(FGridTileData Data)
+void FGridGenerateInstancesWorker::BuildChunkTiles(const FIntPoint Chunk, TArray<FGridTileData>& OutTiles) const
 {
-	GridTiles.Emplace(Data.Index, Data);
-	InstanceIndexes.Emplace(Data.Index);
-	Transforms.Emplace(Data.Transform);
+	OutTiles.Reset();
+
+	const FIntPoint LastIndex = GetLastIndex();
+	const FIntPoint Origin = FGridChunk::GetChunkOrigin(Chunk);
 
-	FTileHeightTranslator Translator = TileHeightTranslator.FindRef(FIntPoint(Data.Index.X, Data.Index.Y));
-	Translator.Translator.Emplace(Data.Index);
-	TileHeightTranslator.Emplace(FIntPoint(Data.Index.X, Data.Index.Y), Translator);
+	TArray<FGridTerrainColumn> Terrain;
+	if (bTerrain)
+	{
+		FGridTerrain::BuildChunk(TerrainSettings, Chunk, Terrain);
+	}
+
+	// Chunks are aligned on a power of two, so walking the local Morton codes keeps the global Morton order
+	for (uint64 Code = 0; Code < FGridChunk::ColumnCount; ++Code)
+	{
+		uint32 LocalX, LocalY;
+		FGridMorton::Decode(Code, LocalX, LocalY);
+
+		const int32 x = Origin.X + LocalX;
+		const int32 y = Origin.Y + LocalY;
+
+		if (x > LastIndex.X || y > LastIndex.Y)
+		{
+			continue;
+		}
+
+		if (bGridFastGen && x != 0 && y != 0 && x != GridTileCount.X && y != GridTileCount.Y)
+		{
+			continue;
+		}
+
+		FIntVector Index(x,y,0);
+		ETileType Type = ETileType::Normal;
+		if (bTerrain)
+		{
+			const FGridTerrainColumn& Column = Terrain[FGridChunk::GetColumnOffset(FIntPoint(x, y))];
+			Index.Z = Column.Height;
+			Type = Column.Type;
+		}
+
+		OutTiles.Emplace(
+			Index,
+			Type,
+			FTransform(FRotator(0.0f, 0.0f, 0.0f),
+						GetTileLocationFromGridIndex(Index),
+						GetTileScale()));
+	}
 }
 
 FVector FGridGenerateInstancesWorker::GetTileLocationFromGridIndex(const FIntVector Index) const
@@ -115,13 +263,3 @@ FVector FGridGenerateInstancesWorker::GetTileScale() const
 {
 	return GridTileSize / 100.0f;
 }
-	
-
-void FGridGenerateInstancesWorker::Stop()
-{
-	FGridRunnable::Stop();
-}
-
-
-
-
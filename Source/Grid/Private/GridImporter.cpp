@@ -0,0 +1,705 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridImporter.h"
+#include "GridChunkStore.h"
+#include "GridTileKey.h"
+#include "GridUtilities.h"
+#include "Async/ParallelFor.h"
+#include "HAL/FileManager.h"
+#include "Misc/Paths.h"
+#include <atomic>
+
+THIRD_PARTY_INCLUDES_START
+#include "zlib.h"
+THIRD_PARTY_INCLUDES_END
+
+DEFINE_LOG_CATEGORY_STATIC(LogGridImporter, Log, All);
+
+namespace GridImporter
+{
+	static constexpr int32 ReadBufferSize = 64 * 1024;
+
+	/** Heightmap decoded one row at a time, samples go from 0 to 65535 */
+	class FHeightmapReader
+	{
+	public:
+		virtual ~FHeightmapReader() = default;
+
+		virtual bool ReadRow(TArrayView<uint16> OutRow) = 0;
+
+		FIntPoint Size = FIntPoint::ZeroValue;
+	};
+
+	/** 16 bit little endian samples, no header */
+	class FRawHeightmapReader final : public FHeightmapReader
+	{
+	public:
+		bool Open(const FString& Path, const FIntPoint RawSize, FString& OutError)
+		{
+			File.Reset(IFileManager::Get().CreateFileReader(*Path));
+			if (!File)
+			{
+				OutError = FString::Printf(TEXT("Can't open %s"), *Path);
+				return false;
+			}
+
+			const int64 SampleCount = File->TotalSize() / 2;
+			Size = RawSize;
+			if (Size.X <= 0 || Size.Y <= 0)
+			{
+				const int32 Side = static_cast<int32>(FMath::Sqrt(static_cast<double>(SampleCount)));
+				Size = FIntPoint(Side, Side);
+			}
+
+			if (Size.X <= 0 || static_cast<int64>(Size.X) * Size.Y > SampleCount)
+			{
+				OutError = FString::Printf(TEXT("%s is too small for a %dx%d heightmap"), *Path, Size.X, Size.Y);
+				return false;
+			}
+
+			Bytes.SetNumUninitialized(Size.X * 2);
+			return true;
+		}
+
+		virtual bool ReadRow(TArrayView<uint16> OutRow) override
+		{
+			File->Serialize(Bytes.GetData(), Bytes.Num());
+
+			for (int32 x = 0; x < Size.X; ++x)
+			{
+				OutRow[x] = static_cast<uint16>(Bytes[x * 2] | (Bytes[x * 2 + 1] << 8));
+			}
+
+			return !File->IsError();
+		}
+
+	private:
+		TUniquePtr<FArchive> File;
+
+		TArray<uint8> Bytes;
+	};
+
+	/**
+	 * Non-interlaced 8 or 16 bit PNG, only the first channel is read. The image data is inflated straight from the file
+	 * one row at a time, only the current and the previous row are kept around for unfiltering.
+	 */
+	class FPngHeightmapReader final : public FHeightmapReader
+	{
+	public:
+		virtual ~FPngHeightmapReader() override
+		{
+			if (bInflating)
+			{
+				inflateEnd(&Stream);
+			}
+		}
+
+		bool Open(const FString& Path, FString& OutError)
+		{
+			File.Reset(IFileManager::Get().CreateFileReader(*Path));
+			if (!File)
+			{
+				OutError = FString::Printf(TEXT("Can't open %s"), *Path);
+				return false;
+			}
+
+			static constexpr uint8 Signature[8] = {137, 80, 78, 71, 13, 10, 26, 10};
+			uint8 Header[8] = {};
+			File->Serialize(Header, sizeof(Header));
+
+			uint32 Length = 0;
+			uint32 Type = 0;
+			if (File->IsError() || FMemory::Memcmp(Header, Signature, sizeof(Signature)) != 0
+				|| !ReadChunkHeader(Length, Type) || Type != MakeChunkType("IHDR") || Length != 13)
+			{
+				OutError = FString::Printf(TEXT("%s isn't a PNG"), *Path);
+				return false;
+			}
+
+			uint8 ImageHeader[13] = {};
+			File->Serialize(ImageHeader, sizeof(ImageHeader));
+			Skip(4);
+
+			const int32 Width = static_cast<int32>(ReadBigEndian(ImageHeader));
+			const int32 Height = static_cast<int32>(ReadBigEndian(ImageHeader + 4));
+			BitDepth = ImageHeader[8];
+			const uint8 ColorType = ImageHeader[9];
+			const uint8 Interlace = ImageHeader[12];
+
+			int32 Channels = 0;
+			switch (ColorType)
+			{
+			case 0: Channels = 1; break;
+			case 2: Channels = 3; break;
+			case 4: Channels = 2; break;
+			case 6: Channels = 4; break;
+			default: break;
+			}
+
+			if (Channels == 0 || (BitDepth != 8 && BitDepth != 16) || Interlace != 0 || Width <= 0 || Height <= 0)
+			{
+				OutError = FString::Printf(TEXT("%s must be a non-interlaced 8 or 16 bit greyscale or RGB PNG"), *Path);
+				return false;
+			}
+
+			Size = FIntPoint(Width, Height);
+			BytesPerPixel = Channels * BitDepth / 8;
+
+			Row.SetNumZeroed(Width * BytesPerPixel + 1);
+			PreviousRow.SetNumZeroed(Width * BytesPerPixel);
+			Input.SetNumUninitialized(ReadBufferSize);
+
+			FMemory::Memzero(Stream);
+			if (inflateInit(&Stream) != Z_OK)
+			{
+				OutError = TEXT("Can't start inflating the PNG");
+				return false;
+			}
+
+			bInflating = true;
+			return true;
+		}
+
+		virtual bool ReadRow(TArrayView<uint16> OutRow) override
+		{
+			// Inflate exactly one filtered row, its filter byte first
+			Stream.next_out = Row.GetData();
+			Stream.avail_out = Row.Num();
+
+			while (Stream.avail_out > 0)
+			{
+				if (Stream.avail_in == 0 && !FillInput())
+				{
+					return false;
+				}
+
+				const int32 Result = inflate(&Stream, Z_NO_FLUSH);
+				if (Result != Z_OK && (Result != Z_STREAM_END || Stream.avail_out > 0))
+				{
+					return false;
+				}
+			}
+
+			if (!Unfilter())
+			{
+				return false;
+			}
+
+			const uint8* Pixels = PreviousRow.GetData();
+			for (int32 x = 0; x < Size.X; ++x)
+			{
+				const uint8* Pixel = Pixels + x * BytesPerPixel;
+				OutRow[x] = BitDepth == 16 ? static_cast<uint16>((Pixel[0] << 8) | Pixel[1]) : static_cast<uint16>(Pixel[0] * 257);
+			}
+
+			return true;
+		}
+
+	private:
+		static constexpr uint32 MakeChunkType(const char (&Name)[5])
+		{
+			return (static_cast<uint32>(Name[0]) << 24) | (static_cast<uint32>(Name[1]) << 16) | (static_cast<uint32>(Name[2]) << 8) | static_cast<uint32>(Name[3]);
+		}
+
+		static uint32 ReadBigEndian(const uint8* Bytes)
+		{
+			return (static_cast<uint32>(Bytes[0]) << 24) | (static_cast<uint32>(Bytes[1]) << 16) | (static_cast<uint32>(Bytes[2]) << 8) | static_cast<uint32>(Bytes[3]);
+		}
+
+		bool ReadChunkHeader(uint32& OutLength, uint32& OutType) const
+		{
+			uint8 Header[8] = {};
+			File->Serialize(Header, sizeof(Header));
+
+			OutLength = ReadBigEndian(Header);
+			OutType = ReadBigEndian(Header + 4);
+			return !File->IsError();
+		}
+
+		void Skip(const int64 Count) const
+		{
+			File->Seek(File->Tell() + Count);
+		}
+
+		/** Feeds the next piece of image data to the inflater, the image data may be split over any number of IDAT chunks */
+		bool FillInput()
+		{
+			while (RemainingImageData == 0)
+			{
+				if (bInImageData)
+				{
+					// CRC of the IDAT chunk just consumed
+					Skip(4);
+					bInImageData = false;
+				}
+
+				uint32 Length = 0;
+				uint32 Type = 0;
+				if (!ReadChunkHeader(Length, Type) || Type == MakeChunkType("IEND"))
+				{
+					return false;
+				}
+
+				if (Type == MakeChunkType("IDAT"))
+				{
+					RemainingImageData = Length;
+					bInImageData = true;
+				}
+				else
+				{
+					Skip(static_cast<int64>(Length) + 4);
+				}
+			}
+
+			const uint32 Count = FMath::Min<uint32>(RemainingImageData, Input.Num());
+			File->Serialize(Input.GetData(), Count);
+			RemainingImageData -= Count;
+
+			Stream.next_in = Input.GetData();
+			Stream.avail_in = Count;
+			return !File->IsError();
+		}
+
+		/** Undoes the row filter in place, then keeps the row as the previous one */
+		bool Unfilter()
+		{
+			uint8* Current = Row.GetData() + 1;
+			const uint8* Previous = PreviousRow.GetData();
+			const int32 Count = PreviousRow.Num();
+
+			switch (Row[0])
+			{
+			case 0:
+				break;
+			case 1:
+				for (int32 i = BytesPerPixel; i < Count; ++i)
+				{
+					Current[i] += Current[i - BytesPerPixel];
+				}
+				break;
+			case 2:
+				for (int32 i = 0; i < Count; ++i)
+				{
+					Current[i] += Previous[i];
+				}
+				break;
+			case 3:
+				for (int32 i = 0; i < Count; ++i)
+				{
+					const int32 Left = i >= BytesPerPixel ? Current[i - BytesPerPixel] : 0;
+					Current[i] += static_cast<uint8>((Left + Previous[i]) >> 1);
+				}
+				break;
+			case 4:
+				for (int32 i = 0; i < Count; ++i)
+				{
+					const int32 Left = i >= BytesPerPixel ? Current[i - BytesPerPixel] : 0;
+					const int32 Up = Previous[i];
+					const int32 UpLeft = i >= BytesPerPixel ? Previous[i - BytesPerPixel] : 0;
+
+					const int32 Estimate = Left + Up - UpLeft;
+					const int32 DistanceLeft = FMath::Abs(Estimate - Left);
+					const int32 DistanceUp = FMath::Abs(Estimate - Up);
+					const int32 DistanceUpLeft = FMath::Abs(Estimate - UpLeft);
+
+					const int32 Predictor = DistanceLeft <= DistanceUp && DistanceLeft <= DistanceUpLeft ? Left : DistanceUp <= DistanceUpLeft ? Up : UpLeft;
+					Current[i] += static_cast<uint8>(Predictor);
+				}
+				break;
+			default:
+				return false;
+			}
+
+			FMemory::Memcpy(PreviousRow.GetData(), Current, Count);
+			return true;
+		}
+
+		TUniquePtr<FArchive> File;
+
+		z_stream Stream;
+
+		bool bInflating = false;
+
+		bool bInImageData = false;
+
+		uint32 RemainingImageData = 0;
+
+		int32 BitDepth = 0;
+
+		int32 BytesPerPixel = 0;
+
+		TArray<uint8> Input;
+
+		TArray<uint8> Row;
+
+		TArray<uint8> PreviousRow;
+	};
+
+	/** CSV or TSV of Tile types, read one line at a time through a fixed buffer */
+	class FTypeMapReader
+	{
+	public:
+		bool Open(const FString& Path, FString& OutError)
+		{
+			File.Reset(IFileManager::Get().CreateFileReader(*Path));
+			if (!File)
+			{
+				OutError = FString::Printf(TEXT("Can't open %s"), *Path);
+				return false;
+			}
+
+			const FString Extension = FPaths::GetExtension(Path);
+			Delimiter = Extension.Equals(TEXT("tsv"), ESearchCase::IgnoreCase) || Extension.Equals(TEXT("txt"), ESearchCase::IgnoreCase) ? '\t' : ',';
+
+			Buffer.SetNumUninitialized(ReadBufferSize);
+			return true;
+		}
+
+		/** Counts the rows and the cells of the widest row, then starts over from the first row */
+		FIntPoint Measure()
+		{
+			FIntPoint Measured = FIntPoint::ZeroValue;
+			for (int32 Rows = 1; ReadLine(); ++Rows)
+			{
+				if (Line.IsEmpty())
+				{
+					continue;
+				}
+
+				int32 Cells = 1;
+				bool bQuoted = false;
+				for (const ANSICHAR Char : Line)
+				{
+					// Delimiters inside a quoted cell are part of it
+					bQuoted ^= Char == '"';
+					Cells += Char == Delimiter && !bQuoted;
+				}
+
+				Measured = FIntPoint(FMath::Max(Measured.X, Cells), Rows);
+			}
+
+			File->Seek(0);
+			Position = 0;
+			Filled = 0;
+			bFirstLine = true;
+			return Measured;
+		}
+
+		/** Missing cells and rows past the end of the file are Normal */
+		bool ReadRow(TArrayView<ETileType> OutRow)
+		{
+			for (ETileType& Type : OutRow)
+			{
+				Type = ETileType::Normal;
+			}
+
+			if (!ReadLine())
+			{
+				return !File->IsError();
+			}
+
+			int32 Cell = 0;
+			int32 CellStart = 0;
+			bool bQuoted = false;
+			for (int32 i = 0; i <= Line.Num() && Cell < OutRow.Num(); ++i)
+			{
+				// Same quoting as Measure, the quotes themselves are trimmed by ParseTileType
+				if (i < Line.Num() && Line[i] == '"')
+				{
+					bQuoted = !bQuoted;
+					continue;
+				}
+
+				if (i == Line.Num() || (Line[i] == Delimiter && !bQuoted))
+				{
+					OutRow[Cell++] = ParseTileType(Line.GetData() + CellStart, i - CellStart);
+					CellStart = i + 1;
+				}
+			}
+
+			return !File->IsError();
+		}
+
+	private:
+		bool ReadLine()
+		{
+			Line.Reset();
+
+			int32 Char = ReadByte();
+			if (Char < 0)
+			{
+				return false;
+			}
+
+			for (; Char >= 0 && Char != '\n'; Char = ReadByte())
+			{
+				if (Char != '\r')
+				{
+					Line.Add(static_cast<ANSICHAR>(Char));
+				}
+			}
+
+			// UTF-8 byte order mark
+			if (bFirstLine && Line.Num() >= 3 && static_cast<uint8>(Line[0]) == 0xEF && static_cast<uint8>(Line[1]) == 0xBB && static_cast<uint8>(Line[2]) == 0xBF)
+			{
+				Line.RemoveAt(0, 3);
+			}
+			bFirstLine = false;
+
+			return true;
+		}
+
+		int32 ReadByte()
+		{
+			if (Position == Filled)
+			{
+				Filled = static_cast<int32>(FMath::Min<int64>(Buffer.Num(), File->TotalSize() - File->Tell()));
+				Position = 0;
+
+				if (Filled <= 0)
+				{
+					Filled = 0;
+					return -1;
+				}
+
+				File->Serialize(Buffer.GetData(), Filled);
+			}
+
+			return Buffer[Position++];
+		}
+
+		static ETileType ParseTileType(const ANSICHAR* Cell, int32 Length)
+		{
+			while (Length > 0 && (*Cell == ' ' || *Cell == '"'))
+			{
+				++Cell;
+				--Length;
+			}
+
+			while (Length > 0 && (Cell[Length - 1] == ' ' || Cell[Length - 1] == '"'))
+			{
+				--Length;
+			}
+
+			if (Length == 0)
+			{
+				return ETileType::Normal;
+			}
+
+			// Lines aren't null terminated, digits are parsed by hand
+			if (FCharAnsi::IsDigit(Cell[0]))
+			{
+				int32 Value = 0;
+				for (int32 i = 0; i < Length && FCharAnsi::IsDigit(Cell[i]) && Value <= static_cast<int32>(ETileType::FlyingOnly); ++i)
+				{
+					Value = Value * 10 + (Cell[i] - '0');
+				}
+				return Value <= static_cast<int32>(ETileType::FlyingOnly) ? static_cast<ETileType>(Value) : ETileType::Normal;
+			}
+
+			static const TPair<const ANSICHAR*, ETileType> Names[] = {
+				{"None", ETileType::None},
+				{"Normal", ETileType::Normal},
+				{"Obstacle", ETileType::Obstacle},
+				{"FlyingOnly", ETileType::FlyingOnly},
+				{"Flying Only", ETileType::FlyingOnly}
+			};
+
+			for (const TPair<const ANSICHAR*, ETileType>& Name : Names)
+			{
+				if (FCStringAnsi::Strlen(Name.Key) == Length && FCStringAnsi::Strnicmp(Cell, Name.Key, Length) == 0)
+				{
+					return Name.Value;
+				}
+			}
+
+			return ETileType::Normal;
+		}
+
+		TUniquePtr<FArchive> File;
+
+		ANSICHAR Delimiter = ',';
+
+		TArray<uint8> Buffer;
+
+		int32 Position = 0;
+
+		int32 Filled = 0;
+
+		bool bFirstLine = true;
+
+		TArray<ANSICHAR> Line;
+	};
+}
+
+FGridImporter::FGridImporter(const FGridImportSettings& InSettings, const FVector& InCenterLocation, const FVector& InTileSize, const TSharedRef<FGridChunkStore>& InChunkStore)
+	: Settings(InSettings)
+	, CenterLocation(InCenterLocation)
+	, TileSize(InTileSize)
+	, ChunkStore(InChunkStore)
+{
+}
+
+bool FGridImporter::Run(FGridJob& Job)
+{
+	using namespace GridImporter;
+
+	const auto Fail = [this](FString Message)
+	{
+		UE_LOG(LogGridImporter, Error, TEXT("%s"), *Message);
+		Error = MoveTemp(Message);
+		return false;
+	};
+
+	FString OpenError;
+
+	TUniquePtr<FHeightmapReader> Heightmap;
+	if (!Settings.HeightmapFile.IsEmpty())
+	{
+		if (FPaths::GetExtension(Settings.HeightmapFile).Equals(TEXT("png"), ESearchCase::IgnoreCase))
+		{
+			TUniquePtr<FPngHeightmapReader> Png = MakeUnique<FPngHeightmapReader>();
+			if (!Png->Open(Settings.HeightmapFile, OpenError))
+			{
+				return Fail(OpenError);
+			}
+			Heightmap = MoveTemp(Png);
+		}
+		else
+		{
+			TUniquePtr<FRawHeightmapReader> Raw = MakeUnique<FRawHeightmapReader>();
+			if (!Raw->Open(Settings.HeightmapFile, Settings.RawSize, OpenError))
+			{
+				return Fail(OpenError);
+			}
+			Heightmap = MoveTemp(Raw);
+		}
+	}
+
+	TUniquePtr<FTypeMapReader> TypeMap;
+	if (!Settings.TypeMapFile.IsEmpty())
+	{
+		TypeMap = MakeUnique<FTypeMapReader>();
+		if (!TypeMap->Open(Settings.TypeMapFile, OpenError))
+		{
+			return Fail(OpenError);
+		}
+	}
+
+	if (!Heightmap && !TypeMap)
+	{
+		return Fail(TEXT("Nothing to import, set a heightmap or a type map"));
+	}
+
+	// The heightmap decides the size, the type map is cropped or padded with Normal Tiles to match
+	GridSize = Heightmap ? Heightmap->Size : TypeMap->Measure();
+	if (GridSize.X <= 0 || GridSize.Y <= 0)
+	{
+		return Fail(TEXT("Nothing to import, the files are empty"));
+	}
+
+	const FVector BottomLeftCorner = UGridUtilities::GetGridBottomLeftCorner(CenterLocation, TileSize, GridSize);
+	const FVector Scale = TileSize / 100.0f;
+	const float HeightScale = Settings.MaxHeight / 65535.0f;
+
+	// Only one band of chunk rows is ever decoded, whatever the size of the files
+	const int32 BandSize = FGridChunk::Size * GridSize.X;
+	const int32 ChunkCountX = (GridSize.X + FGridChunk::Size - 1) >> FGridChunk::SizeLog2;
+
+	TArray<uint16> Heights;
+	Heights.SetNumZeroed(BandSize);
+
+	TArray<ETileType> Types;
+	Types.Init(ETileType::Normal, BandSize);
+
+	TArray<TArray<FGridTileData>> BandTiles;
+	BandTiles.SetNum(ChunkCountX);
+
+	std::atomic<bool> bSaveFailed = false;
+
+	for (int32 BandY = 0; BandY < GridSize.Y; BandY += FGridChunk::Size)
+	{
+		if (Job.IsCancelled())
+		{
+			return false;
+		}
+
+		const int32 RowCount = FMath::Min(FGridChunk::Size, GridSize.Y - BandY);
+		for (int32 Row = 0; Row < RowCount; ++Row)
+		{
+			if (Heightmap && !Heightmap->ReadRow(MakeArrayView(Heights.GetData() + Row * GridSize.X, GridSize.X)))
+			{
+				return Fail(FString::Printf(TEXT("%s is truncated or corrupt at row %d"), *Settings.HeightmapFile, BandY + Row));
+			}
+
+			if (TypeMap && !TypeMap->ReadRow(MakeArrayView(Types.GetData() + Row * GridSize.X, GridSize.X)))
+			{
+				return Fail(FString::Printf(TEXT("Can't read %s at row %d"), *Settings.TypeMapFile, BandY + Row));
+			}
+		}
+
+		const int32 ChunkY = BandY >> FGridChunk::SizeLog2;
+		ParallelFor(ChunkCountX, [&](const int32 ChunkX)
+		{
+			TArray<FGridTileData>& Tiles = BandTiles[ChunkX];
+			Tiles.Reset();
+
+			const FIntPoint Chunk(ChunkX, ChunkY);
+			const FIntPoint Origin = FGridChunk::GetChunkOrigin(Chunk);
+
+			// Same Morton layout as generated chunks
+			for (uint64 Code = 0; Code < FGridChunk::ColumnCount; ++Code)
+			{
+				uint32 LocalX, LocalY;
+				FGridMorton::Decode(Code, LocalX, LocalY);
+
+				const int32 x = Origin.X + LocalX;
+				if (x >= GridSize.X || static_cast<int32>(LocalY) >= RowCount)
+				{
+					continue;
+				}
+
+				const int32 Sample = LocalY * GridSize.X + x;
+				if (Types[Sample] == ETileType::None)
+				{
+					continue;
+				}
+
+				const FIntVector Index(x, Origin.Y + LocalY, FMath::RoundToInt(Heights[Sample] * HeightScale));
+				Tiles.Emplace(
+					Index,
+					Types[Sample],
+					FTransform(FRotator(0.0f, 0.0f, 0.0f), BottomLeftCorner + (TileSize * FVector(Index)), Scale));
+			}
+
+			if (!Tiles.IsEmpty() && !ChunkStore->SaveChunk(Chunk, Tiles))
+			{
+				bSaveFailed = true;
+			}
+		});
+
+		if (bSaveFailed)
+		{
+			return Fail(FString::Printf(TEXT("Can't write chunks to %s"), *ChunkStore->GetDirectory()));
+		}
+
+		for (int32 ChunkX = 0; ChunkX < ChunkCountX; ++ChunkX)
+		{
+			if (!BandTiles[ChunkX].IsEmpty())
+			{
+				ChunkSummaries.Emplace(FIntPoint(ChunkX, ChunkY), FGridChunkSummary::Build(BandTiles[ChunkX]));
+			}
+		}
+
+		Job.SetProgress(static_cast<float>(BandY + RowCount) / GridSize.Y);
+	}
+
+	if (!ChunkStore->SaveSummaries(ChunkSummaries))
+	{
+		return Fail(FString::Printf(TEXT("Can't write chunk summaries to %s"), *ChunkStore->GetDirectory()));
+	}
+
+	UE_LOG(LogGridImporter, Display, TEXT("Imported a %dx%d Grid, %d chunks, into %s"), GridSize.X, GridSize.Y, ChunkSummaries.Num(), *ChunkStore->GetDirectory());
+	return true;
+}
@@ -0,0 +1,130 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridJobScheduler.h"
+#include "Async/Async.h"
+
+FGridJob::FGridJob(const TCHAR* InName)
+	: Name(InName)
+	, Completed(InName)
+{
+}
+
+
+// ***
+// Handles
+// ***
+
+void FGridJobHandle::Cancel() const
+{
+	if (Job)
+	{
+		Job->Cancel();
+	}
+}
+
+EGridJobStatus FGridJobHandle::GetStatus() const
+{
+	return Job ? Job->GetStatus() : EGridJobStatus::Cancelled;
+}
+
+bool FGridJobHandle::IsComplete() const
+{
+	return !Job || Job->IsComplete();
+}
+
+float FGridJobHandle::GetProgress() const
+{
+	return Job ? Job->GetProgress() : 0.0f;
+}
+
+void FGridJobHandle::Wait() const
+{
+	if (Job)
+	{
+		Job->Completed.Wait();
+	}
+}
+
+
+// ***
+// Scheduling
+// ***
+
+FGridJobHandle FGridJobScheduler::Launch(const TCHAR* Name, FGridJobFunction&& Work, const TConstArrayView<FGridJobHandle> Prerequisites)
+{
+	return Launch(Name, MoveTemp(Work), Prerequisites, false);
+}
+
+FGridJobHandle FGridJobScheduler::LaunchOnGameThread(const TCHAR* Name, FGridJobFunction&& Work, const TConstArrayView<FGridJobHandle> Prerequisites)
+{
+	return Launch(Name, MoveTemp(Work), Prerequisites, true);
+}
+
+FGridJobHandle FGridJobScheduler::Launch(const TCHAR* Name, FGridJobFunction&& Work, const TConstArrayView<FGridJobHandle> Prerequisites, const bool bGameThread)
+{
+	const TSharedPtr<FGridJob> Job = MakeShared<FGridJob>(Name);
+
+	TArray<TSharedPtr<FGridJob>> PrerequisiteJobs;
+	TArray<UE::Tasks::FTaskEvent> PrerequisiteEvents;
+	for (const FGridJobHandle& Prerequisite : Prerequisites)
+	{
+		if (Prerequisite.Job)
+		{
+			PrerequisiteJobs.Emplace(Prerequisite.Job);
+			PrerequisiteEvents.Emplace(Prerequisite.Job->Completed);
+		}
+	}
+
+	UE::Tasks::Launch(Name, [Job, Work = MoveTemp(Work), PrerequisiteJobs = MoveTemp(PrerequisiteJobs), bGameThread]() mutable
+	{
+		if (!bGameThread)
+		{
+			Execute(*Job, Work, PrerequisiteJobs);
+			return;
+		}
+
+		AsyncTask(ENamedThreads::GameThread, [Job, Work = MoveTemp(Work), PrerequisiteJobs = MoveTemp(PrerequisiteJobs)]() mutable
+		{
+			Execute(*Job, Work, PrerequisiteJobs);
+		});
+	}, PrerequisiteEvents);
+
+	return FGridJobHandle(Job);
+}
+
+void FGridJobScheduler::Execute(FGridJob& Job, FGridJobFunction& Work, const TConstArrayView<TSharedPtr<FGridJob>> Prerequisites)
+{
+	bool bRun = !Job.IsCancelled();
+	for (const TSharedPtr<FGridJob>& Prerequisite : Prerequisites)
+	{
+		bRun &= Prerequisite->GetStatus() == EGridJobStatus::Succeeded;
+	}
+
+	EGridJobStatus Status = EGridJobStatus::Cancelled;
+	if (bRun)
+	{
+		Job.Status.store(EGridJobStatus::Running, std::memory_order_release);
+
+		const bool bSucceeded = Work(Job);
+		if (Job.IsCancelled())
+		{
+			Status = EGridJobStatus::Cancelled;
+		}
+		else if (bSucceeded)
+		{
+			Job.SetProgress(1.0f);
+			Status = EGridJobStatus::Succeeded;
+		}
+		else
+		{
+			Status = EGridJobStatus::Failed;
+		}
+	}
+
+	// Captures hold on to the work's state, release it before anyone waiting wakes up
+	Work = nullptr;
+
+	Job.Status.store(Status, std::memory_order_release);
+	Job.Completed.Trigger();
+}
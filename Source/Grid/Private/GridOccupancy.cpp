@@ -0,0 +1,204 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridOccupancy.h"
+#include "GameFramework/Actor.h"
+
+bool FGridOccupancy::Place(AActor* Unit, const FIntVector Index)
+{
+	if (!Unit)
+	{
+		return false;
+	}
+
+	if (UnitToTile.Contains(Unit))
+	{
+		return Move(Unit, Index);
+	}
+
+	if (IsOccupied(Index))
+	{
+		return false;
+	}
+
+	Link(Unit, Index);
+	OnOccupancyChanged.Broadcast(Index, Unit);
+	return true;
+}
+
+bool FGridOccupancy::Move(AActor* Unit, const FIntVector To)
+{
+	const FIntVector* From = UnitToTile.Find(Unit);
+	if (!From)
+	{
+		return false;
+	}
+
+	const FIntVector Previous = *From;
+	if (Previous == To)
+	{
+		return true;
+	}
+
+	if (IsOccupied(To))
+	{
+		return false;
+	}
+
+	Unlink(Previous);
+	Link(Unit, To);
+
+	OnOccupancyChanged.Broadcast(Previous, nullptr);
+	OnOccupancyChanged.Broadcast(To, Unit);
+	return true;
+}
+
+AActor* FGridOccupancy::RemoveAt(const FIntVector Index)
+{
+	const FOccupant* Found = TileToUnit.Find(Index);
+	if (!Found)
+	{
+		return nullptr;
+	}
+
+	AActor* Unit = Found->Unit.Get();
+	Unlink(Index);
+
+	OnOccupancyChanged.Broadcast(Index, nullptr);
+	return Unit;
+}
+
+bool FGridOccupancy::RemoveUnit(const AActor* Unit)
+{
+	const FIntVector* Index = UnitToTile.Find(Unit);
+	if (!Index)
+	{
+		return false;
+	}
+
+	RemoveAt(*Index);
+	return true;
+}
+
+void FGridOccupancy::Reset()
+{
+	TileToUnit.Empty();
+	UnitToTile.Empty();
+	ChunkBits.Empty();
+	ColumnUnitCounts.Empty();
+}
+
+AActor* FGridOccupancy::GetUnitAt(const FIntVector Index) const
+{
+	if (!IsColumnOccupied(FIntPoint(Index.X, Index.Y)))
+	{
+		return nullptr;
+	}
+
+	const FOccupant* Found = TileToUnit.Find(Index);
+	return Found ? Found->Unit.Get() : nullptr;
+}
+
+bool FGridOccupancy::FindUnitTile(const AActor* Unit, FIntVector& OutIndex) const
+{
+	if (const FIntVector* Index = UnitToTile.Find(Unit))
+	{
+		OutIndex = *Index;
+		return true;
+	}
+
+	return false;
+}
+
+bool FGridOccupancy::IsOccupied(const FIntVector Index) const
+{
+	// Units destroyed without being removed don't hold their Tile
+	return GetUnitAt(Index) != nullptr;
+}
+
+bool FGridOccupancy::IsColumnOccupied(const FIntPoint Column) const
+{
+	const FChunkBits* Bits = ChunkBits.Find(FGridChunk::GetChunkCoord(Column));
+	if (!Bits)
+	{
+		return false;
+	}
+
+	const int32 Offset = FGridChunk::GetColumnOffset(Column);
+	return (Bits->Columns[Offset >> 6] & (1ull << (Offset & 63))) != 0;
+}
+
+int32 FGridOccupancy::GetAdjacentUnits(const FIntVector Index, const bool bIncludeDiagonals, const int32 MaxHeightDifference, TArray<AActor*>& OutUnits) const
+{
+	OutUnits.Reset();
+
+	static const FIntPoint Offsets[] = {
+		{1, 0}, {0, 1}, {-1, 0}, {0, -1},
+		{1, 1}, {-1, 1}, {-1, -1}, {1, -1}
+	};
+	const int32 OffsetCount = bIncludeDiagonals ? 8 : 4;
+
+	for (int32 i = 0; i < OffsetCount; ++i)
+	{
+		const FIntPoint Column = FIntPoint(Index.X, Index.Y) + Offsets[i];
+		if (!IsColumnOccupied(Column))
+		{
+			continue;
+		}
+
+		for (int32 z = Index.Z - MaxHeightDifference; z <= Index.Z + MaxHeightDifference; ++z)
+		{
+			if (const FOccupant* Found = TileToUnit.Find(FIntVector(Column.X, Column.Y, z)))
+			{
+				if (AActor* Unit = Found->Unit.Get())
+				{
+					OutUnits.Emplace(Unit);
+				}
+			}
+		}
+	}
+
+	return OutUnits.Num();
+}
+
+void FGridOccupancy::Link(AActor* Unit, const FIntVector Index)
+{
+	// A destroyed unit may still sit in the maps
+	if (TileToUnit.Contains(Index))
+	{
+		Unlink(Index);
+	}
+
+	TileToUnit.Emplace(Index, FOccupant(Unit, Unit));
+	UnitToTile.Emplace(Unit, Index);
+
+	const FIntPoint Column(Index.X, Index.Y);
+	if (ColumnUnitCounts.FindOrAdd(Column)++ == 0)
+	{
+		const int32 Offset = FGridChunk::GetColumnOffset(Column);
+		ChunkBits.FindOrAdd(FGridChunk::GetChunkCoord(Column)).Columns[Offset >> 6] |= 1ull << (Offset & 63);
+	}
+}
+
+void FGridOccupancy::Unlink(const FIntVector Index)
+{
+	FOccupant Occupant;
+	if (!TileToUnit.RemoveAndCopyValue(Index, Occupant))
+	{
+		return;
+	}
+
+	UnitToTile.Remove(Occupant.Key);
+
+	const FIntPoint Column(Index.X, Index.Y);
+	int32* Count = ColumnUnitCounts.Find(Column);
+	if (Count && --(*Count) <= 0)
+	{
+		ColumnUnitCounts.Remove(Column);
+
+		const FIntPoint Chunk = FGridChunk::GetChunkCoord(Column);
+		const int32 Offset = FGridChunk::GetColumnOffset(Column);
+		FChunkBits& Bits = ChunkBits.FindChecked(Chunk);
+		Bits.Columns[Offset >> 6] &= ~(1ull << (Offset & 63));
+	}
+}
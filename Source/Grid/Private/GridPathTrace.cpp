@@ -0,0 +1,42 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridPathTrace.h"
+
+void FGridPathTraceRecorder::SetCapacity(const int32 InCapacity)
+{
+	Capacity = FMath::Max(InCapacity, 1);
+	Records.Empty(Capacity);
+	Next = 0;
+	TotalRecorded = 0;
+}
+
+void FGridPathTraceRecorder::Record(const FIntVector Index, const EGridPathTraceEvent Event, const int32 Cost)
+{
+	if (Records.Num() < Capacity)
+	{
+		Records.Emplace(Index, Event, Cost);
+	}
+	else
+	{
+		Records[Next] = FGridPathTraceRecord(Index, Event, Cost);
+		Next = (Next + 1) % Capacity;
+	}
+
+	++TotalRecorded;
+}
+
+void FGridPathTraceRecorder::Reset()
+{
+	// Keeps the allocation for the next search
+	Records.Reset();
+	Next = 0;
+	TotalRecorded = 0;
+}
+
+void FGridPathTraceRecorder::GetRecords(TArray<FGridPathTraceRecord>& OutRecords) const
+{
+	OutRecords.Reset(Records.Num());
+	OutRecords.Append(MakeArrayView(Records).Slice(Next, Records.Num() - Next));
+	OutRecords.Append(MakeArrayView(Records).Left(Next));
+}
@@ -0,0 +1,104 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridPathTraceVisualizer.h"
+#include "GridActor.h"
+#include "GridPathfinding.h"
+
+
+// Sets default values
+AGridPathTraceVisualizer::AGridPathTraceVisualizer()
+{
+	PrimaryActorTick.bCanEverTick = true;
+	PrimaryActorTick.bStartWithTickEnabled = false;
+
+	RootComponent = CreateDefaultSubobject<USceneComponent>(TEXT("RootComponent"));
+}
+
+// Called every frame
+void AGridPathTraceVisualizer::Tick(float DeltaTime)
+{
+	Super::Tick(DeltaTime);
+
+	AGridActor* Grid = Pathfinding ? Pathfinding->Grid.Get() : nullptr;
+	if (!bReplaying || !Grid)
+	{
+		Stop();
+		return;
+	}
+
+	Elapsed += DeltaTime;
+	const int32 End = FMath::Min(FMath::FloorToInt32(Elapsed * StepsPerSecond), Records.Num());
+
+	// The steps of this frame go to the Grid in one call per event
+	TArray<FIntVector> Steps[3];
+	for (; Position < End; ++Position)
+	{
+		Steps[static_cast<uint8>(Records[Position].Event)].Emplace(Records[Position].Index);
+	}
+
+	Grid->SetTilesOverlay(Steps[static_cast<uint8>(EGridPathTraceEvent::Discovered)], static_cast<float>(ETileState::Discovered));
+	Grid->SetTilesOverlay(Steps[static_cast<uint8>(EGridPathTraceEvent::Analyzed)], static_cast<float>(ETileState::Analyzed));
+	Grid->SetTilesOverlay(Steps[static_cast<uint8>(EGridPathTraceEvent::Path)], static_cast<float>(ETileState::Path));
+
+	if (Position >= Records.Num())
+	{
+		if (bLoop)
+		{
+			ClearOverlay();
+			Position = 0;
+			Elapsed = 0.0f;
+		}
+		else
+		{
+			bReplaying = false;
+			SetActorTickEnabled(false);
+		}
+	}
+}
+
+bool AGridPathTraceVisualizer::ShouldTickIfViewportsOnly() const
+{
+	return bReplaying;
+}
+
+void AGridPathTraceVisualizer::Replay()
+{
+	if (!Pathfinding || !Pathfinding->Grid)
+	{
+		return;
+	}
+
+	ClearOverlay();
+
+	Pathfinding->GetTraceRecords(Records);
+	Position = 0;
+	Elapsed = 0.0f;
+	bReplaying = !Records.IsEmpty();
+	SetActorTickEnabled(bReplaying);
+}
+
+void AGridPathTraceVisualizer::Stop()
+{
+	if (bReplaying || Position > 0)
+	{
+		ClearOverlay();
+	}
+
+	Records.Empty();
+	Position = 0;
+	Elapsed = 0.0f;
+	bReplaying = false;
+	SetActorTickEnabled(false);
+}
+
+void AGridPathTraceVisualizer::ClearOverlay() const
+{
+	AGridActor* Grid = Pathfinding ? Pathfinding->Grid.Get() : nullptr;
+	if (!Grid)
+	{
+		return;
+	}
+
+	Grid->ClearTilesOverlay();
+}
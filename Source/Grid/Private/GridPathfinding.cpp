@@ -3,6 +3,7 @@
 
 #include "GridPathfinding.h"
 #include "GridActor.h"
+#include "GridSnapshot.h"
 #include "Algo/Reverse.h"
 
 
@@ -51,12 +52,22 @@ TArray<FIntVector> AGridPathfinding::FindPath(const FIntVector Start, const FInt
 			GetMinimumCostBetweenTwoTiles(StartIndex, TargetIndex, bIncludeDiagonals)));
 
 	TArray<FIntVector> Path;
-	while (DiscoveredTilesIndexes.Num() > 0)
+	while (DiscoveredTiles.Num() > 0)
 	{
 		// Path found
 		if (AnalyzeNextDiscoveredTile())
 		{
 			Path = GeneratePath();
+
+#if WITH_GRID_PATH_TRACE
+			if (bRecordTrace)
+			{
+				for (const FIntVector Index : Path)
+				{
+					Trace.Record(Index, EGridPathTraceEvent::Path, PathfindingData.FindRef(Index).CostFromStart);
+				}
+			}
+#endif
 			
 			OnPathfindingCompleted.Broadcast(Path);
 			return Path;
@@ -90,43 +101,34 @@ TArray<FIntVector> AGridPathfinding::GeneratePath()
 void AGridPathfinding::ClearGeneratedData()
 {
 	PathfindingData.Empty();
-	DiscoveredTileSortingCosts.Empty();
-	DiscoveredTilesIndexes.Empty();
+	DiscoveredTiles.Empty();
+	DiscoveredCount = 0;
 	AnalyzedTileIndexes.Empty();
+	AnalyzedTiles.Empty();
+
+#if WITH_GRID_PATH_TRACE
+	if (Trace.GetCapacity() != TraceCapacity)
+	{
+		Trace.SetCapacity(TraceCapacity);
+	}
+	Trace.Reset();
+#endif
 
 	OnPathfindingDataCleared.Broadcast();
 }
 
-void AGridPathfinding::InsertTileInDiscoveredArray(FPathfindingData TileData)
+namespace
 {
-	int32 SortingCost = GetTileSortingCost(TileData);
-
-	if (DiscoveredTileSortingCosts.Num() == 0)
-	{
-		DiscoveredTileSortingCosts.Emplace(SortingCost);
-		DiscoveredTilesIndexes.Emplace(TileData.Index);
-	}
-	else
+	// Cheapest first, most recently discovered first on ties, like the sorted discovered list was
+	const auto DiscoveredTilePredicate = [](const auto& A, const auto& B)
 	{
-		if (SortingCost >= DiscoveredTileSortingCosts.Last())
-		{
-			DiscoveredTileSortingCosts.Emplace(SortingCost);
-			DiscoveredTilesIndexes.Emplace(TileData.Index);
-		}
-		else
-		{
-			for (int32 i = 0; i < DiscoveredTileSortingCosts.Num(); ++i)
-			{
-				if (DiscoveredTileSortingCosts[i] >= SortingCost)
-				{
-					DiscoveredTileSortingCosts.Insert(SortingCost, i);
-					DiscoveredTilesIndexes.Insert(TileData.Index, i);
+		return A.SortingCost != B.SortingCost ? A.SortingCost < B.SortingCost : A.Order > B.Order;
+	};
+}
 
-					return;
-				}
-			}
-		}
-	}
+void AGridPathfinding::InsertTileInDiscoveredArray(FPathfindingData TileData)
+{
+	DiscoveredTiles.HeapPush(FDiscoveredTile{GetTileSortingCost(TileData), DiscoveredCount++, TileData.Index}, DiscoveredTilePredicate);
 }
 
 void AGridPathfinding::DiscoverTile(FPathfindingData TilePathData)
@@ -135,7 +137,7 @@ void AGridPathfinding::DiscoverTile(FPathfindingData TilePathData)
 	
 	InsertTileInDiscoveredArray(TilePathData);
 
-	OnPathfindingDataUpdated.Broadcast(TilePathData.Index);
+	RecordTrace(TilePathData.Index, EGridPathTraceEvent::Discovered, TilePathData.CostFromStart);
 }
 
 bool AGridPathfinding::DiscoverNextNeighbour()
@@ -143,7 +145,7 @@ bool AGridPathfinding::DiscoverNextNeighbour()
 	CurrentNeighbour = CurrentNeighbours[0];
 	CurrentNeighbours.RemoveAt(0);
 
-	if (AnalyzedTileIndexes.Contains(CurrentNeighbour.Index))
+	if (AnalyzedTiles.Contains(CurrentNeighbour.Index))
 	{
 		return false;
 	}
@@ -154,18 +156,15 @@ bool AGridPathfinding::DiscoverNextNeighbour()
 		return false;
 	}
 
-	const int32 IndexInDiscovered = DiscoveredTilesIndexes.Find(CurrentNeighbour.Index);
-	// not new neighbour?
-	if (IndexInDiscovered != -1)
+	// not new neighbour? Its old entry stays in the heap and is skipped
+	if (const FPathfindingData* Discovered = PathfindingData.Find(CurrentNeighbour.Index))
 	{
-		CurrentNeighbour = PathfindingData.FindRef(CurrentNeighbour.Index);
-		if (CostFromStart >= CurrentNeighbour.CostFromStart)
+		if (CostFromStart >= Discovered->CostFromStart)
 		{
 			return false;
 		}
 
-		DiscoveredTilesIndexes.RemoveAt(IndexInDiscovered);
-		DiscoveredTileSortingCosts.RemoveAt(IndexInDiscovered);
+		CurrentNeighbour = *Discovered;
 	}
 
 	DiscoverTile(
@@ -183,7 +182,7 @@ bool AGridPathfinding::AnalyzeNextDiscoveredTile()
 {
 	CurrentDiscoveredTile = GetCheapestTileFromDiscoveredList();
 
-	OnPathfindingDataUpdated.Broadcast(CurrentDiscoveredTile.Index);
+	RecordTrace(CurrentDiscoveredTile.Index, EGridPathTraceEvent::Analyzed, CurrentDiscoveredTile.CostFromStart);
 
 	CurrentNeighbours = GetValidTileNeighbours(CurrentDiscoveredTile.Index, bIncludeDiagonals, ValidTileTypes);
 
@@ -201,26 +200,70 @@ bool AGridPathfinding::AnalyzeNextDiscoveredTile()
 
 FPathfindingData AGridPathfinding::GetCheapestTileFromDiscoveredList()
 {
-	const FIntVector TileIndex = DiscoveredTilesIndexes[0];
+	FDiscoveredTile Cheapest;
+	DiscoveredTiles.HeapPop(Cheapest, DiscoveredTilePredicate);
+
+	AnalyzedTiles.Add(Cheapest.Index);
+	AnalyzedTileIndexes.Emplace(Cheapest.Index);
+
+	// Drop entries of Tiles analyzed or rediscovered cheaper since, so the top of the heap is always a live one
+	while (DiscoveredTiles.Num() > 0)
+	{
+		const FDiscoveredTile& Top = DiscoveredTiles.HeapTop();
+		if (!AnalyzedTiles.Contains(Top.Index) && Top.SortingCost == GetTileSortingCost(PathfindingData.FindRef(Top.Index)))
+		{
+			break;
+		}
 
-	DiscoveredTileSortingCosts.RemoveAt(0);
-	DiscoveredTilesIndexes.RemoveAt(0);
+		DiscoveredTiles.HeapPopDiscard(DiscoveredTilePredicate);
+	}
 
-	return PathfindingData.FindRef(TileIndex);
+	return PathfindingData.FindRef(Cheapest.Index);
 }
 
 TArray<FPathfindingData> AGridPathfinding::GetValidTileNeighbours(const FIntVector Index, const bool IncludeDiagonals, const TArray<ETileType> ValidTypes)
 {
 	const FGridTileData* InputData = Grid->GetGridTiles().Find(Index);
+	const double InputHeight = InputData ? InputData->Transform.GetLocation().Z : Grid->GetTileLocationFromGridIndex(Index).Z;
 	TArray<FPathfindingData> ValidTileNeighbours;
 
 	TArray<FIntVector> Neighbours = GetNeighbourIndexes(Index, IncludeDiagonals);
 	for (FIntVector Neighbour : Neighbours)
 	{
+		// Streamed out chunks only have a coarse summary, walkable columns count as Normal Tiles at the current height.
+		// The search never blocks on the store, the path through them is refined once they stream in
+		if (Grid->IsTileInUnloadedChunk(Neighbour))
+		{
+			if (Grid->IsUnloadedTileWalkable(Neighbour) && ValidTypes.Contains(ETileType::Normal) && !Grid->IsTileOccupied(Neighbour))
+			{
+				ValidTileNeighbours.Add(
+					FPathfindingData(
+							Neighbour,
+							UGridTilesData::GetTileTypeCost(ETileType::Normal),
+							999999,
+							999999,
+							Index));
+			}
+			continue;
+		}
+
 		FGridTileData* Data = Grid->GetGridTiles().Find(Neighbour);
 
+		// Default Tiles of implicit Grids aren't stored
+		FGridTileData ImplicitData;
+		if (!Data && Grid->IsImplicitTile(Neighbour))
+		{
+			ImplicitData = Grid->MakeImplicitTile(Neighbour);
+			Data = &ImplicitData;
+		}
+
+		if (!Data)
+		{
+			continue;
+		}
+
 		// if tile is a valid type and there's no unit on the tile and if the height is within height reach
-		if (ValidTypes.Contains(Data->Type) && !Data->UnitOnTile && abs(Data->Transform.GetLocation().Z - InputData->Transform.GetLocation().Z) <= Grid->GridTileSize.Z * HeightReachMult )
+		if (ValidTypes.Contains(Data->Type) && !Data->UnitOnTile && abs(Data->Transform.GetLocation().Z - InputHeight) <= Grid->GridTileSize.Z * HeightReachMult )
 		{
 			ValidTileNeighbours.Add(
 				FPathfindingData(
@@ -301,12 +344,19 @@ bool AGridPathfinding::IsInputDataValid()
 		return false;
 	}
 
-	if (!ValidTileTypes.Contains(Grid->GetGridTiles().Find(TargetIndex)->Type))
+	const FGridTileData* TargetData = Grid->GetGridTiles().Find(TargetIndex);
+	if (!TargetData)
+	{
+		// Implicit Tile or one in a streamed out chunk, IsTileWalkable already checked it counts as Normal
+		return ValidTileTypes.Contains(ETileType::Normal) && Grid->IsTileOccupied(TargetIndex);
+	}
+
+	if (!ValidTileTypes.Contains(TargetData->Type))
 	{
 		return false;
 	}
 
-	return IsValid(Grid->GetGridTiles().Find(TargetIndex)->UnitOnTile);
+	return IsValid(TargetData->UnitOnTile);
 }
 
 bool AGridPathfinding::IsDiagonal(const FIntVector Index1, const FIntVector Index2)
@@ -325,7 +375,168 @@ int32 AGridPathfinding::GetPathCost(TArray<FIntVector> Path)
 
 	for (FIntVector Tile : Path)
 	{
-		PathCost += UGridTilesData::GetTileTypeCost(Grid->GetGridTiles().Find(Tile)->Type);
+		const FGridTileData* Data = Grid->GetGridTiles().Find(Tile);
+		PathCost += UGridTilesData::GetTileTypeCost(Data ? Data->Type : ETileType::Normal);
+	}
+
+	return PathCost;
+}
+
+void AGridPathfinding::GetTraceRecords(TArray<FGridPathTraceRecord>& OutRecords) const
+{
+#if WITH_GRID_PATH_TRACE
+	Trace.GetRecords(OutRecords);
+#else
+	OutRecords.Reset();
+#endif
+}
+
+
+// ***
+// Snapshots
+// ***
+
+TArray<FIntVector> AGridPathfinding::FindPathInSnapshot(const FGridSnapshot& Snapshot, const FGridPathQuery& Query)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(AGridPathfinding::FindPathInSnapshot);
+
+	auto GetMinimumCost = [&Query](const FIntVector Index1, const FIntVector Index2)
+	{
+		const FIntVector LocalIndex = Index1 - Index2;
+		return Query.bIncludeDiagonals ? FMath::Max(abs(LocalIndex.X), abs(LocalIndex.Y)) : abs(LocalIndex.X) + abs(LocalIndex.Y);
+	};
+
+	auto GetSortingCost = [](const FPathfindingData& TileData)
+	{
+		const bool bDiagonal = TileData.Index.X != TileData.PreviousIndex.X && TileData.Index.Y != TileData.PreviousIndex.Y;
+		return 2 * (TileData.CostFromStart + TileData.MinimumCostToTarget) + bDiagonal;
+	};
+
+	// Same checks as IsInputDataValid, except an occupied target is turned down: neighbours holding a unit are never discovered
+	if (Query.Start == Query.Target || !Snapshot.IsTileWalkable(Query.Start))
+	{
+		return TArray<FIntVector>();
+	}
+
+	if (!Query.bReturnReachableTiles)
+	{
+		const FGridTileData* TargetData = Snapshot.FindTile(Query.Target);
+		if (!TargetData || !UGridTilesData::IsTileTypeWalkable(TargetData->Type) || !Query.ValidTileTypes.Contains(TargetData->Type)
+			|| TargetData->UnitOnTile || GetMinimumCost(Query.Start, Query.Target) > Query.MaxPathLength)
+		{
+			return TArray<FIntVector>();
+		}
+	}
+
+	struct FOpenTile
+	{
+		int32 SortingCost;
+		int32 Order;
+		FIntVector Index;
+	};
+
+	// Cheapest first, most recently discovered first on ties, like the sorted discovered list
+	auto OpenPredicate = [](const FOpenTile& A, const FOpenTile& B)
+	{
+		return A.SortingCost != B.SortingCost ? A.SortingCost < B.SortingCost : A.Order > B.Order;
+	};
+
+	TMap<FGridTileKey, FPathfindingData> PathData;
+	TSet<FGridTileKey> Analyzed;
+	TArray<FIntVector> AnalyzedOrder;
+	TArray<FOpenTile> Open;
+	int32 Order = 0;
+
+	const FPathfindingData& StartData = PathData.Emplace(Query.Start, FPathfindingData(Query.Start, 1, 0, GetMinimumCost(Query.Start, Query.Target)));
+	Open.HeapPush(FOpenTile{GetSortingCost(StartData), Order++, Query.Start}, OpenPredicate);
+
+	const double HeightReach = Snapshot.GetTileSize().Z * Query.HeightReachMult;
+
+	static const FIntVector Offsets[] = {
+		{1, 0, 0}, {0, 1, 0}, {-1, 0, 0}, {0, -1, 0},
+		{1, 1, 0}, {-1, 1, 0}, {-1, -1, 0}, {1, -1, 0}
+	};
+	const int32 OffsetCount = Query.bIncludeDiagonals ? 8 : 4;
+
+	while (Open.Num() > 0)
+	{
+		FOpenTile Current;
+		Open.HeapPop(Current, OpenPredicate);
+
+		// Stale entry, the Tile got analyzed or rediscovered cheaper since
+		const FPathfindingData CurrentData = PathData.FindChecked(Current.Index);
+		if (Analyzed.Contains(Current.Index) || Current.SortingCost != GetSortingCost(CurrentData))
+		{
+			continue;
+		}
+
+		Analyzed.Add(Current.Index);
+		AnalyzedOrder.Emplace(Current.Index);
+
+		const FGridTileData* CurrentTile = Snapshot.FindTile(Current.Index);
+		const double CurrentHeight = CurrentTile ? CurrentTile->Transform.GetLocation().Z : Snapshot.GetTileLocationFromGridIndex(Current.Index).Z;
+
+		for (int32 i = 0; i < OffsetCount; ++i)
+		{
+			const FIntVector Neighbour = Current.Index + Offsets[i];
+			const FGridTileData* Tile = Snapshot.FindTile(Neighbour);
+
+			// if tile is a valid type and there's no unit on the tile and if the height is within height reach
+			if (!Tile || !Query.ValidTileTypes.Contains(Tile->Type) || Tile->UnitOnTile || abs(Tile->Transform.GetLocation().Z - CurrentHeight) > HeightReach)
+			{
+				continue;
+			}
+
+			if (Analyzed.Contains(Neighbour))
+			{
+				continue;
+			}
+
+			const int32 CostToEnterTile = UGridTilesData::GetTileTypeCost(Tile->Type);
+			const int32 CostFromStart = CurrentData.CostFromStart + CostToEnterTile;
+			if (CostFromStart > Query.MaxPathLength)
+			{
+				continue;
+			}
+
+			const FPathfindingData* Existing = PathData.Find(Neighbour);
+			if (Existing && CostFromStart >= Existing->CostFromStart)
+			{
+				continue;
+			}
+
+			const FPathfindingData& NeighbourData = PathData.Emplace(Neighbour,
+				FPathfindingData(Neighbour, CostToEnterTile, CostFromStart, GetMinimumCost(Neighbour, Query.Target), Current.Index));
+
+			// Path found
+			if (Neighbour == Query.Target)
+			{
+				TArray<FIntVector> Path;
+				for (FIntVector Index = Query.Target; Index != Query.Start; Index = PathData.FindChecked(Index).PreviousIndex)
+				{
+					Path.Emplace(Index);
+				}
+
+				Algo::Reverse(Path);
+				return Path;
+			}
+
+			Open.HeapPush(FOpenTile{GetSortingCost(NeighbourData), Order++, Neighbour}, OpenPredicate);
+		}
+	}
+
+	// No Path found
+	return Query.bReturnReachableTiles ? AnalyzedOrder : TArray<FIntVector>();
+}
+
+int32 AGridPathfinding::GetPathCostInSnapshot(const FGridSnapshot& Snapshot, const TArray<FIntVector>& Path)
+{
+	int32 PathCost = 0;
+
+	for (const FIntVector Tile : Path)
+	{
+		const FGridTileData* Data = Snapshot.FindTile(Tile);
+		PathCost += UGridTilesData::GetTileTypeCost(Data ? Data->Type : ETileType::None);
 	}
 
 	return PathCost;
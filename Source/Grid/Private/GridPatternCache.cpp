@@ -0,0 +1,312 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridPatternCache.h"
+#include "Containers/LruCache.h"
+#include "Misc/ScopeLock.h"
+
+namespace GridPatternCache
+{
+	struct FStencilKey
+	{
+		EGridPattern Pattern;
+		FIntPoint Range;
+		FIntPoint Direction;
+
+		bool operator==(const FStencilKey& Other) const
+		{
+			return Pattern == Other.Pattern && Range == Other.Range && Direction == Other.Direction;
+		}
+
+		friend uint32 GetTypeHash(const FStencilKey& Key)
+		{
+			return HashCombine(HashCombine(GetTypeHash(static_cast<uint8>(Key.Pattern)), GetTypeHash(Key.Range)), GetTypeHash(Key.Direction));
+		}
+	};
+
+	/** Least recently used stencils go first once it's full */
+	static TLruCache<FStencilKey, TSharedRef<const TArray<FIntVector>>> Stencils(FGridPatternCache::MaxStencils);
+
+	static FCriticalSection StencilsLock;
+
+	/** Keeps the offsets in the order they come, dropping the ones already there */
+	struct FStencilBuilder
+	{
+		TArray<FIntVector> Offsets;
+
+		TSet<FIntPoint> Seen;
+
+		void Add(const int32 X, const int32 Y)
+		{
+			bool bAlreadySeen = false;
+			Seen.Add(FIntPoint(X, Y), &bAlreadySeen);
+			if (!bAlreadySeen)
+			{
+				Offsets.Emplace(X, Y, 0);
+			}
+		}
+	};
+
+	static void AddLine(FStencilBuilder& Builder, const FIntPoint Range)
+	{
+		for (int32 i = Range.X; i <= Range.Y; ++i)
+		{
+			// Y = Right, Y = Left, X = Up, X = Down
+			Builder.Add(0, i);
+			Builder.Add(0, -i);
+			Builder.Add(i, 0);
+			Builder.Add(-i, 0);
+		}
+	}
+
+	static void AddDiagonal(FStencilBuilder& Builder, const FIntPoint Range)
+	{
+		for (int32 i = Range.X; i <= Range.Y; ++i)
+		{
+			Builder.Add(i, i);
+			Builder.Add(-i, -i);
+			Builder.Add(i, -i);
+			Builder.Add(-i, i);
+		}
+	}
+
+	static void AddDiamond(FStencilBuilder& Builder, const FIntPoint Range)
+	{
+		for (int32 i = Range.X; i <= Range.Y; ++i)
+		{
+			for (int32 j = 0; j <= i; ++j)
+			{
+				Builder.Add(j, -(i - j));
+				Builder.Add(i - j, j);
+				Builder.Add(-j, i - j);
+				Builder.Add(-(i - j), -j);
+			}
+		}
+	}
+
+	static void AddSquare(FStencilBuilder& Builder, const FIntPoint Range)
+	{
+		for (int32 i = Range.X; i <= Range.Y; ++i)
+		{
+			for (int32 j = -i; j <= i; ++j)
+			{
+				Builder.Add(j, -i);
+				Builder.Add(i, j);
+				Builder.Add(-j, i);
+				Builder.Add(-i, -j);
+			}
+		}
+	}
+
+	/** Columns whose rounded distance falls in the range and, with a direction, at most 45 degrees off it */
+	static void AddDisc(FStencilBuilder& Builder, const FIntPoint Range, const FIntPoint Direction)
+	{
+		const FVector2D Axis = FVector2D(Direction).GetSafeNormal();
+		const bool bCone = !Axis.IsZero();
+
+		for (int32 y = -Range.Y; y <= Range.Y; ++y)
+		{
+			for (int32 x = -Range.Y; x <= Range.Y; ++x)
+			{
+				const double Distance = FMath::Sqrt(static_cast<double>(x * x + y * y));
+				const int32 Ring = FMath::RoundToInt32(Distance);
+				if (Ring < Range.X || Ring > Range.Y)
+				{
+					continue;
+				}
+
+				if (bCone && Ring > 0 && FVector2D::DotProduct(FVector2D(x, y), Axis) < Distance * UE_HALF_SQRT_2 - UE_KINDA_SMALL_NUMBER)
+				{
+					continue;
+				}
+
+				Builder.Add(x, y);
+			}
+		}
+	}
+
+	/** One Tile wide outline for each radius of the range, midpoint circles */
+	static void AddRing(FStencilBuilder& Builder, const FIntPoint Range)
+	{
+		if (Range.X == 0)
+		{
+			Builder.Add(0, 0);
+		}
+
+		for (int32 Radius = FMath::Max(Range.X, 1); Radius <= Range.Y; ++Radius)
+		{
+			int32 x = Radius;
+			int32 y = 0;
+			int32 Error = 1 - Radius;
+
+			while (x >= y)
+			{
+				Builder.Add(x, y);
+				Builder.Add(y, x);
+				Builder.Add(-y, x);
+				Builder.Add(-x, y);
+				Builder.Add(-x, -y);
+				Builder.Add(-y, -x);
+				Builder.Add(y, -x);
+				Builder.Add(x, -y);
+
+				++y;
+				if (Error < 0)
+				{
+					Error += 2 * y + 1;
+				}
+				else
+				{
+					--x;
+					Error += 2 * (y - x) + 1;
+				}
+			}
+		}
+	}
+
+	/** Bresenham steps from the zero Index towards End, the steps of the range are kept */
+	static void AddLineTo(FStencilBuilder& Builder, const FIntPoint Range, const FIntPoint End)
+	{
+		const int32 DeltaX = FMath::Abs(End.X);
+		const int32 DeltaY = -FMath::Abs(End.Y);
+		const int32 StepX = End.X >= 0 ? 1 : -1;
+		const int32 StepY = End.Y >= 0 ? 1 : -1;
+		int32 Error = DeltaX + DeltaY;
+
+		FIntPoint Point(0, 0);
+		for (int32 Step = 0; Step <= Range.Y; ++Step)
+		{
+			if (Step >= Range.X)
+			{
+				Builder.Add(Point.X, Point.Y);
+			}
+
+			if (Point == End)
+			{
+				break;
+			}
+
+			const int32 Error2 = 2 * Error;
+			if (Error2 >= DeltaY)
+			{
+				Error += DeltaY;
+				Point.X += StepX;
+			}
+			if (Error2 <= DeltaX)
+			{
+				Error += DeltaX;
+				Point.Y += StepY;
+			}
+		}
+	}
+
+	/** Direction as the stencil is keyed on, so directions giving the same Tiles share a stencil */
+	static FIntPoint GetKeyDirection(const EGridPattern Pattern, const FIntPoint Range, const FIntPoint Direction)
+	{
+		const FIntPoint NonZero = Direction == FIntPoint::ZeroValue ? FIntPoint(1, 0) : Direction;
+
+		switch (Pattern)
+		{
+		case EGridPattern::Cone:
+			{
+				const double Octant = FMath::RoundToDouble(FMath::Atan2(static_cast<double>(NonZero.Y), static_cast<double>(NonZero.X)) / (UE_DOUBLE_PI / 4.0));
+				const double Angle = Octant * (UE_DOUBLE_PI / 4.0);
+				return FIntPoint(FMath::RoundToInt32(FMath::Cos(Angle)), FMath::RoundToInt32(FMath::Sin(Angle)));
+			}
+
+		case EGridPattern::LineToTarget:
+			{
+				// End of the line, Range.Y steps away towards the target
+				const double Scale = static_cast<double>(Range.Y) / FMath::Max(FMath::Abs(NonZero.X), FMath::Abs(NonZero.Y));
+				return FIntPoint(FMath::RoundToInt32(NonZero.X * Scale), FMath::RoundToInt32(NonZero.Y * Scale));
+			}
+
+		default:
+			return FIntPoint::ZeroValue;
+		}
+	}
+
+	static TArray<FIntVector> BuildStencil(const FStencilKey& Key)
+	{
+		FStencilBuilder Builder;
+
+		switch (Key.Pattern)
+		{
+		case EGridPattern::None:
+			Builder.Add(0, 0);
+			break;
+
+		case EGridPattern::Line:
+			AddLine(Builder, Key.Range);
+			break;
+
+		case EGridPattern::Diagonal:
+			AddDiagonal(Builder, Key.Range);
+			break;
+
+		case EGridPattern::HalfDiagonal:
+			AddDiagonal(Builder, FIntPoint(Key.Range.X, Key.Range.Y / 2));
+			break;
+
+		case EGridPattern::Star:
+			AddLine(Builder, Key.Range);
+			AddDiagonal(Builder, Key.Range);
+			break;
+
+		case EGridPattern::Diamond:
+			AddDiamond(Builder, Key.Range);
+			break;
+
+		case EGridPattern::Square:
+			AddSquare(Builder, Key.Range);
+			break;
+
+		case EGridPattern::Circle:
+			AddDisc(Builder, Key.Range, FIntPoint::ZeroValue);
+			break;
+
+		case EGridPattern::Ring:
+			AddRing(Builder, Key.Range);
+			break;
+
+		case EGridPattern::Cone:
+			AddDisc(Builder, Key.Range, Key.Direction);
+			break;
+
+		case EGridPattern::LineToTarget:
+			AddLineTo(Builder, Key.Range, Key.Direction);
+			break;
+		}
+
+		Builder.Offsets.Shrink();
+		return MoveTemp(Builder.Offsets);
+	}
+}
+
+TSharedRef<const TArray<FIntVector>> FGridPatternCache::GetStencil(const EGridPattern Pattern, const FIntPoint Range, const FIntPoint Direction)
+{
+	using namespace GridPatternCache;
+
+	// A single Tile whatever the range
+	const FIntPoint ClampedRange = Pattern == EGridPattern::None
+		? FIntPoint::ZeroValue
+		: FIntPoint(FMath::Clamp(Range.X, 0, MaxRange), FMath::Min(Range.Y, MaxRange));
+	const FStencilKey Key{Pattern, ClampedRange, GetKeyDirection(Pattern, ClampedRange, Direction)};
+
+	FScopeLock Lock(&StencilsLock);
+
+	if (const TSharedRef<const TArray<FIntVector>>* Stencil = Stencils.FindAndTouch(Key))
+	{
+		return *Stencil;
+	}
+
+	const TSharedRef<const TArray<FIntVector>> Stencil = MakeShared<const TArray<FIntVector>>(BuildStencil(Key));
+	Stencils.Add(Key, Stencil);
+	return Stencil;
+}
+
+int32 FGridPatternCache::Num()
+{
+	FScopeLock Lock(&GridPatternCache::StencilsLock);
+	return GridPatternCache::Stencils.Num();
+}
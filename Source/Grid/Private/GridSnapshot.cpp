@@ -0,0 +1,370 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridSnapshot.h"
+#include "GridActor.h"
+
+FGridSnapshot FGridSnapshot::Capture(const AGridActor& Grid)
+{
+	check(IsInGameThread());
+
+	FGridSnapshot Snapshot;
+	Snapshot.GridTileSize = Grid.GridTileSize;
+	Snapshot.GridTileCount = Grid.GridTileCount;
+	Snapshot.GridBottomLeftCorner = Grid.GridBottomLeftCorner;
+
+	const auto FindOrAddChunk = [&Snapshot](const FIntPoint Chunk) -> FGridSnapshotChunk&
+	{
+		TSharedPtr<FGridSnapshotChunk>& Data = Snapshot.Chunks.FindOrAdd(Chunk);
+		if (!Data)
+		{
+			Data = MakeShared<FGridSnapshotChunk>();
+		}
+		return *Data;
+	};
+
+	// Default Tiles are a bit per column, every column inside the Grid starts out with one
+	const FIntPoint Count = Grid.GridTileCount;
+	if (Grid.bImplicitTiles && Count.X > 0 && Count.Y > 0)
+	{
+		const FIntPoint MaxChunk = FGridChunk::GetChunkCoord(Count - FIntPoint(1));
+		for (int32 ChunkY = 0; ChunkY <= MaxChunk.Y; ++ChunkY)
+		{
+			for (int32 ChunkX = 0; ChunkX <= MaxChunk.X; ++ChunkX)
+			{
+				FGridSnapshotChunk& Chunk = FindOrAddChunk(FIntPoint(ChunkX, ChunkY));
+				const FIntPoint Origin = FGridChunk::GetChunkOrigin(FIntPoint(ChunkX, ChunkY));
+
+				for (int32 y = 0; y < FGridChunk::Size && Origin.Y + y < Count.Y; ++y)
+				{
+					for (int32 x = 0; x < FGridChunk::Size && Origin.X + x < Count.X; ++x)
+					{
+						Chunk.SetColumnImplicit(Origin + FIntPoint(x, y), true);
+					}
+				}
+			}
+		}
+
+		for (const FIntPoint Column : Grid.GridTilesData->RemovedImplicitTiles)
+		{
+			if (const TSharedPtr<FGridSnapshotChunk>* Chunk = Snapshot.Chunks.Find(FGridChunk::GetChunkCoord(Column)))
+			{
+				(*Chunk)->SetColumnImplicit(Column, false);
+			}
+		}
+	}
+
+	for (const TPair<FIntVector, FGridTileData>& Pair : Grid.GetGridTiles())
+	{
+		const FIntPoint Column(Pair.Key.X, Pair.Key.Y);
+		FGridSnapshotChunk& Chunk = FindOrAddChunk(FGridChunk::GetChunkCoord(Pair.Key));
+
+		Chunk.Tiles.Emplace(Pair.Key, Pair.Value);
+		Chunk.TileHeightTranslator.FindOrAdd(Column).AddTile(Pair.Key);
+
+		// A stored Tile replaces the default of its column
+		if (Pair.Key.Z == 0)
+		{
+			Chunk.SetColumnImplicit(Column, false);
+		}
+	}
+
+	// Defaults holding a unit or states are kept like stored Tiles
+	TArray<FIntVector> ImplicitWithData;
+	Grid.GetImplicitTilesWithData(ImplicitWithData);
+
+	for (const FIntVector Index : ImplicitWithData)
+	{
+		const FIntPoint Column(Index.X, Index.Y);
+		FGridSnapshotChunk& Chunk = FindOrAddChunk(FGridChunk::GetChunkCoord(Index));
+
+		Chunk.Tiles.Emplace(Index, Grid.MakeImplicitTile(Index));
+		Chunk.TileHeightTranslator.FindOrAdd(Column).AddTile(Index);
+		Chunk.SetColumnImplicit(Column, false);
+	}
+
+	for (auto It = Snapshot.Chunks.CreateIterator(); It; ++It)
+	{
+		const int32 ChunkNum = It.Value()->Num();
+		if (ChunkNum == 0)
+		{
+			It.RemoveCurrent();
+			continue;
+		}
+
+		Snapshot.TileCount += ChunkNum;
+	}
+
+	return Snapshot;
+}
+
+TSharedPtr<FGridSnapshotChunk> FGridSnapshot::CaptureChunk(const AGridActor& Grid, const FIntPoint Chunk)
+{
+	check(IsInGameThread());
+
+	TSharedPtr<FGridSnapshotChunk> Data = MakeShared<FGridSnapshotChunk>();
+	const FIntPoint Origin = FGridChunk::GetChunkOrigin(Chunk);
+
+	for (int32 x = 0; x < FGridChunk::Size; ++x)
+	{
+		for (int32 y = 0; y < FGridChunk::Size; ++y)
+		{
+			const FIntPoint Column = Origin + FIntPoint(x, y);
+			for (const FIntVector Index : Grid.GetGridTilesAtIndex(Column))
+			{
+				if (const FGridTileData* Tile = Grid.GetGridTiles().Find(Index))
+				{
+					Data->Tiles.Emplace(Index, *Tile);
+					Data->TileHeightTranslator.FindOrAdd(Column).AddTile(Index);
+					continue;
+				}
+
+				// The column's default, only kept as a Tile when it differs from the bare one
+				FGridTileData Implicit = Grid.MakeImplicitTile(Index);
+				if (Implicit.UnitOnTile || !Implicit.States.IsEmpty())
+				{
+					Data->Tiles.Emplace(Index, MoveTemp(Implicit));
+					Data->TileHeightTranslator.FindOrAdd(Column).AddTile(Index);
+				}
+				else
+				{
+					Data->SetColumnImplicit(Column, true);
+				}
+			}
+		}
+	}
+
+	return Data;
+}
+
+int32 FGridSnapshotChunk::Num() const
+{
+	int32 ImplicitNum = 0;
+	for (const uint64 Bits : ImplicitColumns)
+	{
+		ImplicitNum += FMath::CountBits(Bits);
+	}
+
+	return Tiles.Num() + ImplicitNum;
+}
+
+// ***
+// Queries
+// ***
+
+const FGridTileData* FGridSnapshot::FindTile(const FIntVector Index) const
+{
+	const TSharedPtr<FGridSnapshotChunk>* Chunk = Chunks.Find(FGridChunk::GetChunkCoord(Index));
+	if (!Chunk)
+	{
+		return nullptr;
+	}
+
+	if (const FGridTileData* Tile = (*Chunk)->Tiles.Find(Index))
+	{
+		return Tile;
+	}
+
+	if (Index.Z != 0 || !(*Chunk)->IsColumnImplicit(FIntPoint(Index.X, Index.Y)))
+	{
+		return nullptr;
+	}
+
+	// Each reading thread synthesizes into its own
+	static thread_local FGridTileData ImplicitTile;
+	ImplicitTile = MakeImplicitTile(Index);
+	return &ImplicitTile;
+}
+
+bool FGridSnapshot::IsWithinBounds(const FIntVector Index) const
+{
+	return (Index.X >= 0 && Index.X <= GridTileCount.X) && (Index.Y >= 0 && Index.Y <= GridTileCount.Y);
+}
+
+bool FGridSnapshot::IsTileWalkable(const FIntVector Index) const
+{
+	const FGridTileData* Data = FindTile(Index);
+	return Data && UGridTilesData::IsTileTypeWalkable(Data->Type);
+}
+
+TArrayView<const FIntVector> FGridSnapshot::GetGridTilesAtIndex(const FIntPoint Index) const
+{
+	const TSharedPtr<FGridSnapshotChunk>* Chunk = Chunks.Find(FGridChunk::GetChunkCoord(Index));
+	if (!Chunk)
+	{
+		return TArrayView<const FIntVector>();
+	}
+
+	const FTileHeightTranslator* Translator = (*Chunk)->TileHeightTranslator.Find(Index);
+	const TArrayView<const FIntVector> Stored = Translator ? TArrayView<const FIntVector>(Translator->Translator) : TArrayView<const FIntVector>();
+
+	if (!(*Chunk)->IsColumnImplicit(Index))
+	{
+		return Stored;
+	}
+
+	// The default Tile sorts in with the stored ones of its column
+	static thread_local FTileHeightTranslator ImplicitColumn;
+	ImplicitColumn.Translator.Reset();
+	ImplicitColumn.Translator.Append(Stored);
+	ImplicitColumn.AddTile(FIntVector(Index.X, Index.Y, 0));
+
+	return ImplicitColumn.Translator;
+}
+
+FGridTileData FGridSnapshot::MakeImplicitTile(const FIntVector Index) const
+{
+	return FGridTileData(
+		Index,
+		ETileType::Normal,
+		FTransform(FRotator(0,0,0), GetTileLocationFromGridIndex(Index), GetTileScale()));
+}
+
+FVector FGridSnapshot::GetTileLocationFromGridIndex(const FIntVector Index) const
+{
+	return GridBottomLeftCorner + (GridTileSize * FVector(Index));
+}
+
+
+// ***
+// Edits
+// ***
+
+void FGridSnapshot::SetTile(const FGridTileData& Data)
+{
+	FGridSnapshotChunk& Chunk = GetMutableChunk(FGridChunk::GetChunkCoord(Data.Index));
+	const FIntPoint Column(Data.Index.X, Data.Index.Y);
+
+	const int32 PreviousNum = Chunk.Num();
+	Chunk.Tiles.Emplace(Data.Index, Data);
+	Chunk.TileHeightTranslator.FindOrAdd(Column).AddTile(Data.Index);
+
+	// A stored Tile replaces the default of its column
+	if (Data.Index.Z == 0)
+	{
+		Chunk.SetColumnImplicit(Column, false);
+	}
+
+	TileCount += Chunk.Num() - PreviousNum;
+}
+
+bool FGridSnapshot::RemoveTile(const FIntVector Index)
+{
+	if (!FindTile(Index))
+	{
+		return false;
+	}
+
+	FGridSnapshotChunk& Chunk = GetMutableChunk(FGridChunk::GetChunkCoord(Index));
+	const FIntPoint Column(Index.X, Index.Y);
+
+	// Not stored, it was the column's default
+	if (Chunk.Tiles.Remove(Index) == 0)
+	{
+		Chunk.SetColumnImplicit(Column, false);
+	}
+
+	FTileHeightTranslator* Translator = Chunk.TileHeightTranslator.Find(Column);
+	if (Translator && Translator->RemoveTile(Index) && Translator->Translator.IsEmpty())
+	{
+		Chunk.TileHeightTranslator.Remove(Column);
+	}
+
+	--TileCount;
+	return true;
+}
+
+bool FGridSnapshot::MoveTile(const FIntVector Index, const int32 MoveAmount)
+{
+	const FGridTileData* Data = FindTile(Index);
+	if (!Data)
+	{
+		return false;
+	}
+
+	FGridTileData Moved = *Data;
+	Moved.Index.Z += MoveAmount;
+	Moved.Transform.AddToTranslation(FVector(0.0f, 0.0f, GridTileSize.Z * MoveAmount));
+
+	RemoveTile(Index);
+	SetTile(Moved);
+	return true;
+}
+
+bool FGridSnapshot::MoveUnit(const FIntVector From, const FIntVector To)
+{
+	const FGridTileData* FromData = FindTile(From);
+	const FGridTileData* ToData = FindTile(To);
+
+	if (!FromData || !ToData || !FromData->UnitOnTile || ToData->UnitOnTile)
+	{
+		return false;
+	}
+
+	const TObjectPtr<AActor> Unit = FromData->UnitOnTile;
+	FindTileMutable(From)->UnitOnTile = nullptr;
+	FindTileMutable(To)->UnitOnTile = Unit;
+	return true;
+}
+
+FGridTileData* FGridSnapshot::FindTileMutable(const FIntVector Index)
+{
+	const FGridTileData* Data = FindTile(Index);
+	if (!Data)
+	{
+		return nullptr;
+	}
+
+	FGridSnapshotChunk& Chunk = GetMutableChunk(FGridChunk::GetChunkCoord(Index));
+	if (FGridTileData* Stored = Chunk.Tiles.Find(Index))
+	{
+		return Stored;
+	}
+
+	// A default Tile gets stored in this snapshot before it's edited
+	SetTile(FGridTileData(*Data));
+	return Chunk.Tiles.Find(Index);
+}
+
+void FGridSnapshot::SetChunk(const FIntPoint Chunk, TSharedPtr<FGridSnapshotChunk> Data)
+{
+	if (const TSharedPtr<FGridSnapshotChunk>* Previous = Chunks.Find(Chunk))
+	{
+		TileCount -= (*Previous)->Num();
+	}
+
+	const int32 DataNum = Data ? Data->Num() : 0;
+	if (DataNum == 0)
+	{
+		Chunks.Remove(Chunk);
+		return;
+	}
+
+	TileCount += DataNum;
+	Chunks.Emplace(Chunk, MoveTemp(Data));
+}
+
+bool FGridSnapshot::SharesChunkWith(const FGridSnapshot& Other, const FIntPoint Chunk) const
+{
+	const TSharedPtr<FGridSnapshotChunk>* Mine = Chunks.Find(Chunk);
+	const TSharedPtr<FGridSnapshotChunk>* Theirs = Other.Chunks.Find(Chunk);
+
+	return Mine && Theirs && *Mine == *Theirs;
+}
+
+FGridSnapshotChunk& FGridSnapshot::GetMutableChunk(const FIntPoint Chunk)
+{
+	TSharedPtr<FGridSnapshotChunk>& Data = Chunks.FindOrAdd(Chunk);
+
+	if (!Data)
+	{
+		Data = MakeShared<FGridSnapshotChunk>();
+	}
+	// Someone else still sees this chunk, copy it before editing
+	else if (!Data.IsUnique())
+	{
+		Data = MakeShared<FGridSnapshotChunk>(*Data);
+	}
+
+	return *Data;
+}
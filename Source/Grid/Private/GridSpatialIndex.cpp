@@ -0,0 +1,477 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridSpatialIndex.h"
+#include "GridActor.h"
+#include "GridSnapshot.h"
+#include "Algo/BinarySearch.h"
+
+// ***
+// Filter
+// ***
+
+FGridTileFilterMask FGridTileFilterMask::Make(const FGridTileQueryFilter& Filter)
+{
+	FGridTileFilterMask Mask;
+
+	if (!Filter.Types.IsEmpty())
+	{
+		Mask.Types = 0;
+		for (const ETileType Type : Filter.Types)
+		{
+			Mask.Types |= GetTypeBit(Type);
+		}
+	}
+
+	if (Filter.bWalkableOnly)
+	{
+		Mask.Types &= GetTypeBit(ETileType::Normal) | GetTypeBit(ETileType::FlyingOnly);
+	}
+
+	for (const ETileState State : Filter.RequiredStates)
+	{
+		Mask.RequiredStates |= GetStateBit(State);
+	}
+
+	for (const ETileState State : Filter.ExcludedStates)
+	{
+		Mask.ExcludedStates |= GetStateBit(State);
+	}
+
+	Mask.bExcludeOccupied = Filter.bExcludeOccupied;
+
+	return Mask;
+}
+
+bool FGridTileFilterMask::Matches(const FGridTileData& Tile) const
+{
+	if (!(Types & GetTypeBit(Tile.Type)) || (bExcludeOccupied && Tile.UnitOnTile))
+	{
+		return false;
+	}
+
+	if (RequiredStates | ExcludedStates)
+	{
+		uint32 States = 0;
+		for (const ETileState State : Tile.States)
+		{
+			States |= GetStateBit(State);
+		}
+
+		return (States & RequiredStates) == RequiredStates && !(States & ExcludedStates);
+	}
+
+	return true;
+}
+
+bool FGridChunkTileIndex::HasAnyType(const uint8 TypeMask) const
+{
+	for (int32 i = 0; i < TypeCount; ++i)
+	{
+		if (TypeCounts[i] > 0 && (TypeMask & (1 << i)))
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+
+// ***
+// Index
+// ***
+
+const FGridChunkTileIndex& FGridSpatialIndex::GetChunk(const AGridActor& Grid, const FIntPoint Chunk)
+{
+	FGridChunkTileIndex& Index = Chunks.FindOrAdd(Chunk);
+
+	const int64 Version = Grid.GetChunkVersion(Chunk);
+	if (Index.Version != Version)
+	{
+		BuildChunk(Grid, Chunk, Index);
+		Index.Version = Version;
+	}
+
+	return Index;
+}
+
+void FGridSpatialIndex::BuildChunk(const AGridActor& Grid, const FIntPoint Chunk, FGridChunkTileIndex& OutIndex) const
+{
+	OutIndex = FGridChunkTileIndex();
+
+	const FIntPoint Origin = FGridChunk::GetChunkOrigin(Chunk);
+	const TMap<FIntVector, FGridTileData>& Tiles = Grid.GetGridTiles();
+
+	for (int32 y = 0; y < FGridChunk::Size; ++y)
+	{
+		for (int32 x = 0; x < FGridChunk::Size; ++x)
+		{
+			const FIntPoint ColumnIndex = Origin + FIntPoint(x, y);
+			const TArrayView<const FIntVector> Column = Grid.GetGridTilesAtIndex(ColumnIndex);
+			if (Column.IsEmpty())
+			{
+				continue;
+			}
+
+			const int32 Offset = FGridChunk::GetColumnOffset(ColumnIndex);
+			OutIndex.OccupiedColumns[Offset >> 6] |= 1ull << (Offset & 63);
+
+			for (const FIntVector Index : Column)
+			{
+				// The only Tile of a column that isn't stored is the implicit one, always Normal
+				const FGridTileData* Tile = Tiles.Find(Index);
+				const ETileType Type = Tile ? Tile->Type : ETileType::Normal;
+
+				++OutIndex.TypeCounts[FMath::Min(static_cast<int32>(Type), FGridChunkTileIndex::TypeCount - 1)];
+				++OutIndex.TileCount;
+			}
+		}
+	}
+}
+
+
+// ***
+// Query sources
+// ***
+
+namespace GridSpatialIndex
+{
+	/** Tiles of the Grid Actor, chunks are skipped through the cached chunk index */
+	struct FGridSource
+	{
+		FGridSpatialIndex& Index;
+		const AGridActor& Grid;
+
+		/** Default Tile FindTile last synthesized, read before the next call */
+		mutable FGridTileData ImplicitTile;
+
+		FIntPoint GetTileCount() const { return Grid.GridTileCount; }
+
+		TArrayView<const FIntVector> GetTilesAtColumn(const FIntPoint Column) const { return Grid.GetGridTilesAtIndex(Column); }
+
+		const FGridTileData* FindTile(const FIntVector TileIndex) const
+		{
+			if (const FGridTileData* Tile = Grid.GetGridTiles().Find(TileIndex))
+			{
+				return Tile;
+			}
+
+			if (Grid.IsImplicitTile(TileIndex))
+			{
+				ImplicitTile = Grid.MakeImplicitTile(TileIndex);
+				return &ImplicitTile;
+			}
+
+			return nullptr;
+		}
+
+		/** Calls Function(Column) for the occupied columns of the chunk between From and To included */
+		template <typename FunctionType>
+		void ForEachOccupiedColumn(const FIntPoint Chunk, const FIntPoint From, const FIntPoint To, const FGridTileFilterMask& Filter, FunctionType&& Function) const
+		{
+			const FGridChunkTileIndex& ChunkIndex = Index.GetChunk(Grid, Chunk);
+			if (ChunkIndex.TileCount == 0 || !ChunkIndex.HasAnyType(Filter.Types))
+			{
+				return;
+			}
+
+			for (int32 y = From.Y; y <= To.Y; ++y)
+			{
+				for (int32 x = From.X; x <= To.X; ++x)
+				{
+					const FIntPoint Column(x, y);
+					if (ChunkIndex.IsColumnOccupied(FGridChunk::GetColumnOffset(Column)))
+					{
+						Function(Column);
+					}
+				}
+			}
+		}
+	};
+
+	/** Tiles of a snapshot, chunks missing from its chunk table are empty */
+	struct FSnapshotSource
+	{
+		const FGridSnapshot& Snapshot;
+
+		FIntPoint GetTileCount() const { return Snapshot.GetGridTileCount(); }
+
+		TArrayView<const FIntVector> GetTilesAtColumn(const FIntPoint Column) const { return Snapshot.GetGridTilesAtIndex(Column); }
+
+		const FGridTileData* FindTile(const FIntVector TileIndex) const { return Snapshot.FindTile(TileIndex); }
+
+		template <typename FunctionType>
+		void ForEachOccupiedColumn(const FIntPoint Chunk, const FIntPoint From, const FIntPoint To, const FGridTileFilterMask& Filter, FunctionType&& Function) const
+		{
+			if (!Snapshot.HasChunk(Chunk))
+			{
+				return;
+			}
+
+			for (int32 y = From.Y; y <= To.Y; ++y)
+			{
+				for (int32 x = From.X; x <= To.X; ++x)
+				{
+					const FIntPoint Column(x, y);
+					if (!Snapshot.GetGridTilesAtIndex(Column).IsEmpty())
+					{
+						Function(Column);
+					}
+				}
+			}
+		}
+	};
+
+	/** Calls Function(Column) for every occupied column inside the rect, skipping chunks without a matching type or rejected by ChunkPredicate */
+	template <typename SourceType, typename ChunkPredicateType, typename FunctionType>
+	static void ForEachColumnInRect(const SourceType& Source, FIntPoint Min, FIntPoint Max, const FGridTileFilterMask& Filter, ChunkPredicateType&& ChunkPredicate, FunctionType&& Function)
+	{
+		// Same bounds as IsWithinBounds, nothing can be added outside of them
+		const FIntPoint TileCount = Source.GetTileCount();
+		Min = FIntPoint(FMath::Max(Min.X, 0), FMath::Max(Min.Y, 0));
+		Max = FIntPoint(FMath::Min(Max.X, TileCount.X), FMath::Min(Max.Y, TileCount.Y));
+
+		if (Min.X > Max.X || Min.Y > Max.Y)
+		{
+			return;
+		}
+
+		const FIntPoint MinChunk = FGridChunk::GetChunkCoord(Min);
+		const FIntPoint MaxChunk = FGridChunk::GetChunkCoord(Max);
+
+		for (int32 ChunkY = MinChunk.Y; ChunkY <= MaxChunk.Y; ++ChunkY)
+		{
+			for (int32 ChunkX = MinChunk.X; ChunkX <= MaxChunk.X; ++ChunkX)
+			{
+				const FIntPoint Chunk(ChunkX, ChunkY);
+				if (!ChunkPredicate(Chunk))
+				{
+					continue;
+				}
+
+				// Part of the rect inside this chunk
+				const FIntPoint Origin = FGridChunk::GetChunkOrigin(Chunk);
+				const FIntPoint From(FMath::Max(Min.X, Origin.X), FMath::Max(Min.Y, Origin.Y));
+				const FIntPoint To(FMath::Min(Max.X, Origin.X + FGridChunk::Size - 1), FMath::Min(Max.Y, Origin.Y + FGridChunk::Size - 1));
+
+				Source.ForEachOccupiedColumn(Chunk, From, To, Filter, Function);
+			}
+		}
+	}
+
+	template <typename SourceType>
+	static void AddMatchingTiles(const SourceType& Source, const FIntPoint Column, const FGridTileFilterMask& Filter, TArray<FIntVector>& OutTiles)
+	{
+		for (const FIntVector Index : Source.GetTilesAtColumn(Column))
+		{
+			const FGridTileData* Tile = Source.FindTile(Index);
+			if (Tile && Filter.Matches(*Tile))
+			{
+				OutTiles.Emplace(Index);
+			}
+		}
+	}
+
+	static int64 GetChunkDistanceSquared(const FIntPoint Chunk, const FIntPoint Point)
+	{
+		const FIntPoint Origin = FGridChunk::GetChunkOrigin(Chunk);
+
+		const int64 DistanceX = FMath::Max3(Origin.X - Point.X, 0, Point.X - (Origin.X + FGridChunk::Size - 1));
+		const int64 DistanceY = FMath::Max3(Origin.Y - Point.Y, 0, Point.Y - (Origin.Y + FGridChunk::Size - 1));
+
+		return DistanceX * DistanceX + DistanceY * DistanceY;
+	}
+
+	static int64 GetColumnDistanceSquared(const FIntPoint Column, const FIntPoint Point)
+	{
+		const int64 DistanceX = Column.X - Point.X;
+		const int64 DistanceY = Column.Y - Point.Y;
+
+		return DistanceX * DistanceX + DistanceY * DistanceY;
+	}
+
+	template <typename SourceType>
+	static int32 QueryRect(const SourceType& Source, const FIntPoint Min, const FIntPoint Max, const FGridTileFilterMask& Filter, TArray<FIntVector>& OutTiles)
+	{
+		OutTiles.Reset();
+
+		ForEachColumnInRect(Source, Min, Max, Filter, [](const FIntPoint) { return true; }, [&](const FIntPoint Column)
+		{
+			AddMatchingTiles(Source, Column, Filter, OutTiles);
+		});
+
+		return OutTiles.Num();
+	}
+
+	template <typename SourceType>
+	static int32 QueryRadius(const SourceType& Source, const FIntPoint Center, const float Radius, const FGridTileFilterMask& Filter, TArray<FIntVector>& OutTiles)
+	{
+		OutTiles.Reset();
+
+		if (Radius < 0.0f)
+		{
+			return 0;
+		}
+
+		const int32 Extent = FMath::FloorToInt32(Radius);
+		const int64 RadiusSquared = FMath::FloorToInt64(static_cast<double>(Radius) * Radius);
+
+		auto ChunkInRange = [Center, RadiusSquared](const FIntPoint Chunk)
+		{
+			return GetChunkDistanceSquared(Chunk, Center) <= RadiusSquared;
+		};
+
+		ForEachColumnInRect(Source, Center - FIntPoint(Extent), Center + FIntPoint(Extent), Filter, ChunkInRange, [&](const FIntPoint Column)
+		{
+			if (GetColumnDistanceSquared(Column, Center) <= RadiusSquared)
+			{
+				AddMatchingTiles(Source, Column, Filter, OutTiles);
+			}
+		});
+
+		return OutTiles.Num();
+	}
+
+	template <typename SourceType>
+	static int32 QueryNearest(const SourceType& Source, const FIntVector Origin, const int32 Count, const int32 MaxRadius, const FGridTileFilterMask& Filter, TArray<FIntVector>& OutTiles)
+	{
+		OutTiles.Reset();
+
+		if (Count <= 0 || MaxRadius < 0)
+		{
+			return 0;
+		}
+
+		const FIntPoint Center(Origin.X, Origin.Y);
+		const FIntPoint TileCount = Source.GetTileCount();
+		const int64 MaxRadiusSquared = static_cast<int64>(MaxRadius) * MaxRadius;
+
+		// Chunks in range, nearest first
+		struct FCandidateChunk
+		{
+			int64 DistanceSquared;
+			FIntPoint Chunk;
+		};
+
+		TArray<FCandidateChunk, TInlineAllocator<64>> CandidateChunks;
+		const FIntPoint MinChunk = FGridChunk::GetChunkCoord(FIntPoint(FMath::Max(Center.X - MaxRadius, 0), FMath::Max(Center.Y - MaxRadius, 0)));
+		const FIntPoint MaxChunk = FGridChunk::GetChunkCoord(FIntPoint(FMath::Min(Center.X + MaxRadius, TileCount.X), FMath::Min(Center.Y + MaxRadius, TileCount.Y)));
+
+		for (int32 ChunkY = MinChunk.Y; ChunkY <= MaxChunk.Y; ++ChunkY)
+		{
+			for (int32 ChunkX = MinChunk.X; ChunkX <= MaxChunk.X; ++ChunkX)
+			{
+				const FIntPoint Chunk(ChunkX, ChunkY);
+				const int64 DistanceSquared = GetChunkDistanceSquared(Chunk, Center);
+				if (DistanceSquared <= MaxRadiusSquared)
+				{
+					CandidateChunks.Emplace(FCandidateChunk{DistanceSquared, Chunk});
+				}
+			}
+		}
+
+		CandidateChunks.Sort([](const FCandidateChunk& A, const FCandidateChunk& B)
+		{
+			return A.DistanceSquared < B.DistanceSquared;
+		});
+
+		// Best Tiles so far, kept sorted, the worst one is last
+		struct FCandidateTile
+		{
+			int64 DistanceSquared;
+			int32 Height;
+			FIntVector Index;
+
+			bool operator<(const FCandidateTile& Other) const
+			{
+				return DistanceSquared != Other.DistanceSquared ? DistanceSquared < Other.DistanceSquared : Height < Other.Height;
+			}
+		};
+
+		TArray<FCandidateTile, TInlineAllocator<16>> Best;
+
+		for (const FCandidateChunk& Candidate : CandidateChunks)
+		{
+			// Nothing in this chunk, or any further one, can beat what we have
+			if (Best.Num() == Count && Candidate.DistanceSquared > Best.Last().DistanceSquared)
+			{
+				break;
+			}
+
+			const FIntPoint ChunkOrigin = FGridChunk::GetChunkOrigin(Candidate.Chunk);
+			Source.ForEachOccupiedColumn(Candidate.Chunk, ChunkOrigin, ChunkOrigin + FIntPoint(FGridChunk::Size - 1), Filter, [&](const FIntPoint Column)
+			{
+				const int64 DistanceSquared = GetColumnDistanceSquared(Column, Center);
+				if (DistanceSquared > MaxRadiusSquared || (Best.Num() == Count && DistanceSquared > Best.Last().DistanceSquared))
+				{
+					return;
+				}
+
+				for (const FIntVector TileIndex : Source.GetTilesAtColumn(Column))
+				{
+					const FGridTileData* Tile = Source.FindTile(TileIndex);
+					if (!Tile || !Filter.Matches(*Tile))
+					{
+						continue;
+					}
+
+					const FCandidateTile NewTile{DistanceSquared, FMath::Abs(TileIndex.Z - Origin.Z), TileIndex};
+					if (Best.Num() == Count)
+					{
+						if (!(NewTile < Best.Last()))
+						{
+							continue;
+						}
+						Best.RemoveAt(Best.Num() - 1);
+					}
+
+					Best.Insert(NewTile, Algo::UpperBound(Best, NewTile));
+				}
+			});
+		}
+
+		OutTiles.Reserve(Best.Num());
+		for (const FCandidateTile& Tile : Best)
+		{
+			OutTiles.Emplace(Tile.Index);
+		}
+
+		return OutTiles.Num();
+	}
+}
+
+
+// ***
+// Queries
+// ***
+
+int32 FGridSpatialIndex::QueryRect(const AGridActor& Grid, const FIntPoint Min, const FIntPoint Max, const FGridTileFilterMask& Filter, TArray<FIntVector>& OutTiles)
+{
+	return GridSpatialIndex::QueryRect(GridSpatialIndex::FGridSource{*this, Grid}, Min, Max, Filter, OutTiles);
+}
+
+int32 FGridSpatialIndex::QueryRadius(const AGridActor& Grid, const FIntPoint Center, const float Radius, const FGridTileFilterMask& Filter, TArray<FIntVector>& OutTiles)
+{
+	return GridSpatialIndex::QueryRadius(GridSpatialIndex::FGridSource{*this, Grid}, Center, Radius, Filter, OutTiles);
+}
+
+int32 FGridSpatialIndex::QueryNearest(const AGridActor& Grid, const FIntVector Origin, const int32 Count, const int32 MaxRadius, const FGridTileFilterMask& Filter, TArray<FIntVector>& OutTiles)
+{
+	return GridSpatialIndex::QueryNearest(GridSpatialIndex::FGridSource{*this, Grid}, Origin, Count, MaxRadius, Filter, OutTiles);
+}
+
+int32 FGridSpatialIndex::QueryRect(const FGridSnapshot& Snapshot, const FIntPoint Min, const FIntPoint Max, const FGridTileFilterMask& Filter, TArray<FIntVector>& OutTiles)
+{
+	return GridSpatialIndex::QueryRect(GridSpatialIndex::FSnapshotSource{Snapshot}, Min, Max, Filter, OutTiles);
+}
+
+int32 FGridSpatialIndex::QueryRadius(const FGridSnapshot& Snapshot, const FIntPoint Center, const float Radius, const FGridTileFilterMask& Filter, TArray<FIntVector>& OutTiles)
+{
+	return GridSpatialIndex::QueryRadius(GridSpatialIndex::FSnapshotSource{Snapshot}, Center, Radius, Filter, OutTiles);
+}
+
+int32 FGridSpatialIndex::QueryNearest(const FGridSnapshot& Snapshot, const FIntVector Origin, const int32 Count, const int32 MaxRadius, const FGridTileFilterMask& Filter, TArray<FIntVector>& OutTiles)
+{
+	return GridSpatialIndex::QueryNearest(GridSpatialIndex::FSnapshotSource{Snapshot}, Origin, Count, MaxRadius, Filter, OutTiles);
+}
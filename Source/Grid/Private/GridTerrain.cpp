@@ -0,0 +1,144 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridTerrain.h"
+#include "GridChunk.h"
+
+namespace GridTerrain
+{
+	/** Integer only, the same on every platform */
+	FORCEINLINE uint32 Hash(const int32 X, const int32 Y, const uint32 Seed)
+	{
+		uint32 H = Seed ^ (static_cast<uint32>(X) * 0x27D4EB2Du) ^ (static_cast<uint32>(Y) * 0x165667B1u);
+		H ^= H >> 15;
+		H *= 0x2C1B3C6Du;
+		H ^= H >> 12;
+		H *= 0x297A2D39u;
+		H ^= H >> 15;
+		return H;
+	}
+
+	/** Noise value of a lattice point, in [0, 1] */
+	FORCEINLINE float Lattice(const int32 X, const int32 Y, const uint32 Seed)
+	{
+		return static_cast<float>(Hash(X, Y, Seed) & 0xFFFFFFu) * (1.0f / 16777215.0f);
+	}
+
+	/** Quintic fade, smooth up to the second derivative so slopes don't crease on lattice lines */
+	FORCEINLINE float Fade(const float T)
+	{
+		return T * T * T * (T * (T * 6.0f - 15.0f) + 10.0f);
+	}
+
+	/** Salt of the obstacle noise, so it doesn't follow the heights */
+	constexpr uint32 ObstacleSalt = 0x5BD1E995u;
+}
+
+void FGridTerrain::SampleRow(const FGridTerrainSettings& Settings, const uint32 Seed, const float Frequency, const int32 Octaves, const FIntPoint Start, const TArrayView<float> OutValues)
+{
+	const int32 Count = OutValues.Num();
+	float* RESTRICT Values = OutValues.GetData();
+
+	for (int32 i = 0; i < Count; ++i)
+	{
+		Values[i] = 0.0f;
+	}
+
+	float Amplitude = 1.0f;
+	float OctaveFrequency = Frequency;
+	float AmplitudeTotal = 0.0f;
+
+	for (int32 Octave = 0; Octave < Octaves; ++Octave)
+	{
+		const uint32 OctaveSeed = Seed + static_cast<uint32>(Octave) * 0x9E3779B9u;
+
+		// The whole row shares its lattice row
+		const float Fy = Start.Y * OctaveFrequency;
+		const float Y0 = FMath::FloorToFloat(Fy);
+		const int32 Iy = static_cast<int32>(Y0);
+		const float Ty = GridTerrain::Fade(Fy - Y0);
+
+		// One lane per Tile and no branches
+		for (int32 i = 0; i < Count; ++i)
+		{
+			const float Fx = (Start.X + i) * OctaveFrequency;
+			const float X0 = FMath::FloorToFloat(Fx);
+			const int32 Ix = static_cast<int32>(X0);
+			const float Tx = GridTerrain::Fade(Fx - X0);
+
+			const float A = GridTerrain::Lattice(Ix, Iy, OctaveSeed);
+			const float B = GridTerrain::Lattice(Ix + 1, Iy, OctaveSeed);
+			const float C = GridTerrain::Lattice(Ix, Iy + 1, OctaveSeed);
+			const float D = GridTerrain::Lattice(Ix + 1, Iy + 1, OctaveSeed);
+
+			const float Bottom = A + (B - A) * Tx;
+			const float Top = C + (D - C) * Tx;
+			Values[i] += (Bottom + (Top - Bottom) * Ty) * Amplitude;
+		}
+
+		AmplitudeTotal += Amplitude;
+		Amplitude *= Settings.Persistence;
+		OctaveFrequency *= Settings.Lacunarity;
+	}
+
+	const float Normalize = AmplitudeTotal > 0.0f ? 1.0f / AmplitudeTotal : 0.0f;
+	for (int32 i = 0; i < Count; ++i)
+	{
+		Values[i] *= Normalize;
+	}
+}
+
+void FGridTerrain::BuildChunk(const FGridTerrainSettings& Settings, const FIntPoint Chunk, TArray<FGridTerrainColumn>& OutColumns)
+{
+	constexpr int32 Size = FGridChunk::Size;
+
+	// Heights carry a one Tile ring around the chunk, so slopes on chunk borders don't need the neighbours built
+	constexpr int32 Span = Size + 2;
+
+	const FIntPoint Origin = FGridChunk::GetChunkOrigin(Chunk);
+	const uint32 Seed = static_cast<uint32>(Settings.Seed);
+
+	TArray<float, TInlineAllocator<Span>> Row;
+	Row.SetNumUninitialized(Span);
+
+	TArray<int32, TInlineAllocator<Span * Span>> Heights;
+	Heights.SetNumUninitialized(Span * Span);
+
+	for (int32 y = 0; y < Span; ++y)
+	{
+		SampleRow(Settings, Seed, Settings.Frequency, Settings.Octaves, FIntPoint(Origin.X - 1, Origin.Y - 1 + y), Row);
+
+		for (int32 x = 0; x < Span; ++x)
+		{
+			Heights[y * Span + x] = FMath::RoundToInt(Row[x] * Settings.MaxHeight);
+		}
+	}
+
+	OutColumns.SetNum(FGridChunk::ColumnCount);
+
+	const bool bObstacleNoise = Settings.ObstacleThreshold < 1.0f;
+
+	for (int32 y = 0; y < Size; ++y)
+	{
+		if (bObstacleNoise)
+		{
+			SampleRow(Settings, Seed ^ GridTerrain::ObstacleSalt, Settings.ObstacleFrequency, 2, FIntPoint(Origin.X, Origin.Y + y), MakeArrayView(Row.GetData(), Size));
+		}
+
+		for (int32 x = 0; x < Size; ++x)
+		{
+			const int32 Center = (y + 1) * Span + x + 1;
+			const int32 Height = Heights[Center];
+
+			const int32 Step = FMath::Max(
+				FMath::Max(FMath::Abs(Heights[Center - 1] - Height), FMath::Abs(Heights[Center + 1] - Height)),
+				FMath::Max(FMath::Abs(Heights[Center - Span] - Height), FMath::Abs(Heights[Center + Span] - Height)));
+
+			const bool bObstacle = Step > Settings.MaxWalkableStep || (bObstacleNoise && Row[x] > Settings.ObstacleThreshold);
+
+			FGridTerrainColumn& Column = OutColumns[FGridChunk::GetColumnOffset(FIntPoint(Origin.X + x, Origin.Y + y))];
+			Column.Height = Height;
+			Column.Type = bObstacle ? ETileType::Obstacle : ETileType::Normal;
+		}
+	}
+}
@@ -0,0 +1,202 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridTerrainTracer.h"
+#include "Engine/World.h"
+#include "GridChunk.h"
+#include "GridGenerateInstancesWorker.h"
+#include "GridTileKey.h"
+
+FGridTerrainTracer::FGridTerrainTracer(const FGridTraceSettings& InSettings, const FVector& InBottomLeftCorner, const FVector& InTileSize, const FIntPoint InTileCount, const TSharedRef<FGridGenerationQueue>& InQueue)
+	: Settings(InSettings)
+	, BottomLeftCorner(InBottomLeftCorner)
+	, TileSize(InTileSize)
+	, TileCount(InTileCount)
+	, Queue(InQueue)
+{
+	if (TileCount.X > 0 && TileCount.Y > 0)
+	{
+		const FIntPoint LastChunk = FGridChunk::GetChunkCoord(TileCount - FIntPoint(1, 1));
+		for (int32 ChunkX = 0; ChunkX <= LastChunk.X; ++ChunkX)
+		{
+			for (int32 ChunkY = 0; ChunkY <= LastChunk.Y; ++ChunkY)
+			{
+				Chunks.Emplace(ChunkX, ChunkY);
+			}
+		}
+
+		Chunks.Sort([](const FIntPoint A, const FIntPoint B)
+		{
+			return FGridTileKey::GetColumnCode(A) < FGridTileKey::GetColumnCode(B);
+		});
+	}
+
+	Slots.SetNum(FMath::Max(Settings.ChunksInFlight, 1));
+	for (int32 Slot = Slots.Num() - 1; Slot >= 0; --Slot)
+	{
+		FreeSlots.Emplace(Slot);
+	}
+
+	if (Chunks.IsEmpty())
+	{
+		Queue->bComplete = true;
+	}
+}
+
+void FGridTerrainTracer::Tick(UWorld* World, const AActor* IgnoredActor)
+{
+	if (!World || FreeSlots.IsEmpty() || NextChunk >= Chunks.Num())
+	{
+		return;
+	}
+
+	if (!TraceDelegate.IsBound())
+	{
+		TraceDelegate.BindSP(AsShared(), &FGridTerrainTracer::HandleTrace);
+	}
+
+	FCollisionQueryParams Params(SCENE_QUERY_STAT(GridConformTrace), Settings.bTraceComplex, IgnoredActor);
+
+	while (!FreeSlots.IsEmpty() && NextChunk < Chunks.Num())
+	{
+		TraceChunk(World, Params, FreeSlots.Pop());
+	}
+}
+
+float FGridTerrainTracer::GetProgress() const
+{
+	return Chunks.IsEmpty() ? 1.0f : static_cast<float>(NextChunkToQueue) / Chunks.Num();
+}
+
+void FGridTerrainTracer::TraceChunk(UWorld* World, const FCollisionQueryParams& Params, const int32 Slot)
+{
+	FTracedChunk& Traced = Slots[Slot];
+	Traced.Chunk = Chunks[NextChunk];
+	Traced.RemainingTraces = 0;
+	Traced.Columns.Reset();
+	Traced.Columns.SetNum(FGridChunk::ColumnCount);
+
+	ChunkOrder.Emplace(Traced.Chunk, NextChunk);
+	++NextChunk;
+	++PendingChunks;
+
+	const FIntPoint Origin = FGridChunk::GetChunkOrigin(Traced.Chunk);
+	const int32 LastX = FMath::Min(Origin.X + FGridChunk::Size, TileCount.X) - 1;
+	const int32 LastY = FMath::Min(Origin.Y + FGridChunk::Size, TileCount.Y) - 1;
+
+	for (int32 y = Origin.Y; y <= LastY; ++y)
+	{
+		for (int32 x = Origin.X; x <= LastX; ++x)
+		{
+			const FVector Location = BottomLeftCorner + TileSize * FVector(x, y, 0);
+			const int32 Offset = FGridChunk::GetColumnOffset(FIntPoint(x, y));
+
+			// Columns nothing is hit under stay None
+			Traced.Columns[Offset].Type = ETileType::None;
+			++Traced.RemainingTraces;
+
+			// Slot in the high bits, column of the chunk in the low ones
+			const uint32 UserData = (static_cast<uint32>(Slot) << FGridChunk::SizeLog2 * 2) | static_cast<uint32>(Offset);
+
+			World->AsyncLineTraceByChannel(
+				EAsyncTraceType::Single,
+				FVector(Location.X, Location.Y, BottomLeftCorner.Z + Settings.TraceHeight),
+				FVector(Location.X, Location.Y, BottomLeftCorner.Z - Settings.TraceDepth),
+				Settings.TraceChannel,
+				Params,
+				FCollisionResponseParams::DefaultResponseParam,
+				&TraceDelegate,
+				UserData);
+		}
+	}
+}
+
+void FGridTerrainTracer::HandleTrace(const FTraceHandle& Handle, FTraceDatum& Datum)
+{
+	const int32 Slot = static_cast<int32>(Datum.UserData >> FGridChunk::SizeLog2 * 2);
+	const int32 Offset = static_cast<int32>(Datum.UserData & (FGridChunk::ColumnCount - 1));
+
+	if (!Slots.IsValidIndex(Slot))
+	{
+		return;
+	}
+
+	FTracedChunk& Traced = Slots[Slot];
+
+	const FHitResult* Hit = Datum.OutHits.FindByPredicate([](const FHitResult& Result)
+	{
+		return Result.bBlockingHit;
+	});
+
+	if (Hit)
+	{
+		FGridTerrainColumn& Column = Traced.Columns[Offset];
+		Column.Height = FMath::RoundToInt((Hit->ImpactPoint.Z - BottomLeftCorner.Z) / TileSize.Z);
+
+		// Steeper than the walkable slope is a normal pointing further away from up
+		const float MinNormalZ = FMath::Cos(FMath::DegreesToRadians(Settings.MaxWalkableSlope));
+		Column.Type = Hit->ImpactNormal.Z < MinNormalZ ? ETileType::Obstacle : ETileType::Normal;
+	}
+
+	if (--Traced.RemainingTraces == 0)
+	{
+		FinishChunk(Traced);
+		FreeSlots.Emplace(Slot);
+	}
+}
+
+void FGridTerrainTracer::FinishChunk(FTracedChunk& Traced)
+{
+	const FIntPoint Origin = FGridChunk::GetChunkOrigin(Traced.Chunk);
+
+	TArray<FGridTileData> Tiles;
+
+	// Local Morton order, like generated chunks
+	for (uint64 Code = 0; Code < FGridChunk::ColumnCount; ++Code)
+	{
+		uint32 LocalX, LocalY;
+		FGridMorton::Decode(Code, LocalX, LocalY);
+
+		const FIntPoint Column2D(Origin.X + LocalX, Origin.Y + LocalY);
+		if (Column2D.X >= TileCount.X || Column2D.Y >= TileCount.Y)
+		{
+			continue;
+		}
+
+		const FGridTerrainColumn& Column = Traced.Columns[FGridChunk::GetColumnOffset(Column2D)];
+		if (Column.Type == ETileType::None)
+		{
+			continue;
+		}
+
+		const FIntVector Index(Column2D.X, Column2D.Y, Column.Height);
+		Tiles.Emplace(
+			Index,
+			Column.Type,
+			FTransform(FRotator(0.0f, 0.0f, 0.0f),
+						BottomLeftCorner + TileSize * FVector(Index),
+						TileSize / 100.0f));
+	}
+
+	--PendingChunks;
+
+	int32 Order = INDEX_NONE;
+	ChunkOrder.RemoveAndCopyValue(Traced.Chunk, Order);
+	FinishedChunks.Emplace(Order, MoveTemp(Tiles));
+
+	// Hand over every chunk that's next in line
+	TArray<FGridTileData> Ready;
+	while (FinishedChunks.RemoveAndCopyValue(NextChunkToQueue, Ready))
+	{
+		if (!Ready.IsEmpty())
+		{
+			Queue->Chunks.Enqueue(FGridGeneratedChunk(Chunks[NextChunkToQueue], MoveTemp(Ready)));
+		}
+		++NextChunkToQueue;
+	}
+
+	if (NextChunkToQueue >= Chunks.Num())
+	{
+		Queue->bComplete = true;
+	}
+}
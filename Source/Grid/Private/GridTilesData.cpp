@@ -0,0 +1,935 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridTilesData.h"
+#include "GridChunk.h"
+#include "GridTileKey.h"
+#include "Algo/Sort.h"
+#include "Async/Async.h"
+#include "HAL/IConsoleManager.h"
+#include "ProfilingDebugging/ScopedTimers.h"
+#include "Serialization/CustomVersion.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+#include "Serialization/ObjectReader.h"
+#include "Serialization/ObjectWriter.h"
+#include "UObject/ObjectSaveContext.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogGridTilesData, Log, All);
+
+struct FGridTilesDataCustomVersion
+{
+	enum Type
+	{
+		// Tiles were tagged UPROPERTY maps
+		BeforeCustomVersionWasAdded = 0,
+		// Tiles live in the compact chunked payload
+		CompactTilePayload,
+
+		VersionPlusOne,
+		LatestVersion = VersionPlusOne - 1
+	};
+
+	static const FGuid GUID;
+};
+
+const FGuid FGridTilesDataCustomVersion::GUID(0x3A1F6C2D, 0x8B4E4F17, 0x9C0D2E55, 0x61B7A90E);
+
+static FCustomVersionRegistration GRegisterGridTilesDataCustomVersion(FGridTilesDataCustomVersion::GUID, FGridTilesDataCustomVersion::LatestVersion, TEXT("GridTilesDataVer"));
+
+namespace GridTilesPayload
+{
+	// Layout version inside the payload itself
+	static constexpr uint8 Version = 1;
+
+	static constexpr int32 StateBitCount = static_cast<int32>(ETileState::SpellRangeAoE) + 1;
+
+	static uint32 ZigZag(const int32 Value)
+	{
+		return (static_cast<uint32>(Value) << 1) ^ static_cast<uint32>(Value >> 31);
+	}
+
+	static int32 UnZigZag(const uint32 Value)
+	{
+		return static_cast<int32>(Value >> 1) ^ -static_cast<int32>(Value & 1);
+	}
+
+	static void WritePacked(FArchive& Ar, uint32 Value)
+	{
+		Ar.SerializeIntPacked(Value);
+	}
+
+	static uint32 ReadPacked(FArchive& Ar)
+	{
+		uint32 Value = 0;
+		Ar.SerializeIntPacked(Value);
+		return Value;
+	}
+
+	static FTransform GetDefaultTransform(const FIntVector Index, const FVector& Origin, const FVector& TileSize)
+	{
+		return FTransform(FRotator(0.0f, 0.0f, 0.0f), Origin + TileSize * FVector(Index), TileSize / 100.0f);
+	}
+
+	// Sorting key: chunk, then column inside the chunk, then height
+	static bool IsBefore(const FIntVector A, const FIntVector B)
+	{
+		const FIntPoint ChunkA = FGridChunk::GetChunkCoord(A);
+		const FIntPoint ChunkB = FGridChunk::GetChunkCoord(B);
+
+		if (ChunkA.Y != ChunkB.Y) return ChunkA.Y < ChunkB.Y;
+		if (ChunkA.X != ChunkB.X) return ChunkA.X < ChunkB.X;
+
+		const int32 ColumnA = FGridChunk::GetColumnOffset(FIntPoint(A.X, A.Y));
+		const int32 ColumnB = FGridChunk::GetColumnOffset(FIntPoint(B.X, B.Y));
+
+		if (ColumnA != ColumnB) return ColumnA < ColumnB;
+		return A.Z < B.Z;
+	}
+}
+
+
+// ***
+// Serialization
+// ***
+
+void UGridTilesData::Serialize(FArchive& Ar)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UGridTilesData::Serialize);
+
+	Ar.UsingCustomVersion(FGridTilesDataCustomVersion::GUID);
+
+	// Transactions, duplication and reference collection keep going through the tagged properties
+	const bool bCompactPayload = Ar.IsPersistent() && !Ar.IsTransacting() && !Ar.IsObjectReferenceCollector() && !Ar.IsCountingMemory();
+
+	if (Ar.IsSaving() && bCompactPayload)
+	{
+		if (bTilePayloadPending)
+		{
+			LoadTilePayload();
+		}
+
+		// The tagged maps go out empty, the Tiles travel in the payload
+		TMap<FIntVector, FGridTileData> SavedGridTiles = MoveTemp(GridTiles);
+		TArray<FIntVector> SavedInstanceIndexes = MoveTemp(InstanceIndexes);
+		TMap<FIntPoint, FTileHeightTranslator> SavedTileHeightTranslator = MoveTemp(TileHeightTranslator);
+
+		Super::Serialize(Ar);
+
+		GridTiles = MoveTemp(SavedGridTiles);
+		InstanceIndexes = MoveTemp(SavedInstanceIndexes);
+		TileHeightTranslator = MoveTemp(SavedTileHeightTranslator);
+
+		TArray<uint8> Bytes;
+		if (bTilePayloadPending)
+		{
+			// Undecodable, it goes back out as it was instead of being replaced by the few Tiles in memory
+			Bytes.SetNumUninitialized(TilePayload.GetBulkDataSize());
+			FMemory::Memcpy(Bytes.GetData(), TilePayload.LockReadOnly(), Bytes.Num());
+			TilePayload.Unlock();
+		}
+		else
+		{
+			EncodeTiles(GridTiles, InstanceIndexes, GridOrigin, GridTileSize, Bytes);
+		}
+
+		// Kept uncompressed and out of the export so it can be memory mapped or streamed on its own
+		TilePayload.SetBulkDataFlags(BULKDATA_Force_NOT_InlinePayload | BULKDATA_MemoryMappedPayload);
+		TilePayload.Lock(LOCK_READ_WRITE);
+		FMemory::Memcpy(TilePayload.Realloc(Bytes.Num()), Bytes.GetData(), Bytes.Num());
+		TilePayload.Unlock();
+		TilePayload.Serialize(Ar, this);
+
+		int32 UnitCount = 0;
+		if (bTilePayloadPending)
+		{
+			// Units of the undecoded payload are still waiting for their Tiles
+			UnitCount = PendingUnitsOnTiles.Num();
+			Ar << UnitCount;
+			for (TPair<FIntVector, TObjectPtr<AActor>>& Pair : PendingUnitsOnTiles)
+			{
+				Ar << Pair.Key;
+				Ar << Pair.Value;
+			}
+
+			return;
+		}
+
+		for (const TPair<FIntVector, FGridTileData>& Pair : GridTiles)
+		{
+			UnitCount += Pair.Value.UnitOnTile ? 1 : 0;
+		}
+
+		Ar << UnitCount;
+		for (TPair<FIntVector, FGridTileData>& Pair : GridTiles)
+		{
+			if (Pair.Value.UnitOnTile)
+			{
+				Ar << Pair.Key;
+				Ar << Pair.Value.UnitOnTile;
+			}
+		}
+
+		// The linker writes the payload after the exports, it's released in PostSaveRoot once the package is done
+		return;
+	}
+
+	// Assets saved before the compact payload fill the maps from their tagged properties here
+	Super::Serialize(Ar);
+
+	if (Ar.IsLoading() && bCompactPayload && Ar.CustomVer(FGridTilesDataCustomVersion::GUID) >= FGridTilesDataCustomVersion::CompactTilePayload)
+	{
+		// Maps the payload straight from the file where the platform allows it
+		TilePayload.Serialize(Ar, this, true);
+
+		int32 UnitCount = 0;
+		Ar << UnitCount;
+
+		PendingUnitsOnTiles.Empty(UnitCount);
+		for (int32 i = 0; i < UnitCount; ++i)
+		{
+			FIntVector Index;
+			TObjectPtr<AActor> Unit;
+			Ar << Index;
+			Ar << Unit;
+			PendingUnitsOnTiles.Emplace(Index, Unit);
+		}
+
+		bTilePayloadPending = TilePayload.GetBulkDataSize() > 0;
+		bTilePayloadUndecodable = false;
+	}
+}
+
+void UGridTilesData::PostLoad()
+{
+	Super::PostLoad();
+
+	if (bTilePayloadPending && !bDeferTilePayload)
+	{
+		LoadTilePayload();
+	}
+}
+
+void UGridTilesData::PostSaveRoot(FObjectPostSaveRootContext ObjectSaveContext)
+{
+	Super::PostSaveRoot(ObjectSaveContext);
+
+	// Only needed while saving, the Tiles are the source of truth in memory. Grid data saved inside
+	// another package keeps it until its next save overwrites it or the object goes away
+	if (!bTilePayloadPending)
+	{
+		TilePayload.RemoveBulkData();
+	}
+}
+
+void UGridTilesData::BeginDestroy()
+{
+	if (TilePayloadRequest)
+	{
+		TilePayloadRequest->Cancel();
+		TilePayloadRequest->WaitCompletion();
+		delete TilePayloadRequest;
+		TilePayloadRequest = nullptr;
+	}
+
+	Super::BeginDestroy();
+}
+
+void UGridTilesData::LoadTilePayload()
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UGridTilesData::LoadTilePayload);
+
+	if (!bTilePayloadPending || bTilePayloadUndecodable)
+	{
+		return;
+	}
+
+	// A streaming request still in flight is dropped, if its decode already started it finds the payload applied and backs off
+	if (TilePayloadRequest)
+	{
+		TilePayloadRequest->Cancel();
+		TilePayloadRequest->WaitCompletion();
+		delete TilePayloadRequest;
+		TilePayloadRequest = nullptr;
+	}
+
+	FGridTilesPayload Payload;
+	bool bDecoded;
+	{
+		const uint8* Bytes = static_cast<const uint8*>(TilePayload.LockReadOnly());
+		bDecoded = DecodeTiles(TArrayView<const uint8>(Bytes, TilePayload.GetBulkDataSize()), GridOrigin, GridTileSize, Payload);
+		TilePayload.Unlock();
+	}
+
+	if (!bDecoded)
+	{
+		FailTilePayload();
+		return;
+	}
+
+	ApplyTilePayload(MoveTemp(Payload));
+}
+
+void UGridTilesData::LoadTilePayloadAsync(TFunction<void()> OnLoaded)
+{
+	check(IsInGameThread());
+
+	if (!bTilePayloadPending || bTilePayloadUndecodable)
+	{
+		if (OnLoaded)
+		{
+			OnLoaded();
+		}
+		return;
+	}
+
+	if (OnLoaded)
+	{
+		TilePayloadCallbacks.Emplace(MoveTemp(OnLoaded));
+	}
+
+	// Already streaming
+	if (TilePayloadRequest)
+	{
+		return;
+	}
+
+	TWeakObjectPtr<UGridTilesData> WeakThis(this);
+	const FVector Origin = GridOrigin;
+	const FVector TileSize = GridTileSize;
+
+	FBulkDataIORequestCallBack Callback = [WeakThis, Origin, TileSize](bool bWasCancelled, IBulkDataIORequest* Request)
+	{
+		if (bWasCancelled)
+		{
+			return;
+		}
+
+		// We own the read buffer from here on
+		uint8* Bytes = Request->GetReadResults();
+		const int64 Size = Request->GetSize();
+
+		// Decoding a large Grid takes a while, keep it off the IO thread
+		Async(EAsyncExecution::ThreadPool, [WeakThis, Origin, TileSize, Bytes, Size]()
+		{
+			TSharedRef<FGridTilesPayload> Payload = MakeShared<FGridTilesPayload>();
+			const bool bDecoded = DecodeTiles(TArrayView<const uint8>(Bytes, Size), Origin, TileSize, *Payload);
+			FMemory::Free(Bytes);
+
+			AsyncTask(ENamedThreads::GameThread, [WeakThis, Payload, bDecoded]()
+			{
+				// A blocking LoadTilePayload may have got there first
+				UGridTilesData* This = WeakThis.Get();
+				if (!This || !This->bTilePayloadPending || This->bTilePayloadUndecodable)
+				{
+					return;
+				}
+
+				if (bDecoded)
+				{
+					This->ApplyTilePayload(MoveTemp(*Payload));
+				}
+				else
+				{
+					This->FailTilePayload();
+				}
+			});
+		});
+	};
+
+	TilePayloadRequest = TilePayload.CreateStreamingRequest(AIOP_Normal, &Callback, nullptr);
+
+	// Payload isn't streamable (e.g. already resident), decode it in place
+	if (!TilePayloadRequest)
+	{
+		LoadTilePayload();
+	}
+}
+
+void UGridTilesData::ApplyTilePayload(FGridTilesPayload&& Payload)
+{
+	// Tiles added while the payload was still on disk win over the stored ones
+	for (TPair<FIntVector, FGridTileData>& Pair : GridTiles)
+	{
+		Payload.GridTiles.Emplace(Pair.Key, MoveTemp(Pair.Value));
+	}
+
+	GridTiles = MoveTemp(Payload.GridTiles);
+	InstanceIndexes = MoveTemp(Payload.InstanceIndexes);
+	TileHeightTranslator = MoveTemp(Payload.TileHeightTranslator);
+
+	for (const TPair<FIntVector, TObjectPtr<AActor>>& Pair : PendingUnitsOnTiles)
+	{
+		if (FGridTileData* Tile = GridTiles.Find(Pair.Key))
+		{
+			Tile->UnitOnTile = Pair.Value;
+		}
+	}
+	PendingUnitsOnTiles.Empty();
+
+	if (TilePayloadRequest)
+	{
+		TilePayloadRequest->WaitCompletion();
+		delete TilePayloadRequest;
+		TilePayloadRequest = nullptr;
+	}
+
+	TilePayload.RemoveBulkData();
+	bTilePayloadPending = false;
+
+	TArray<TFunction<void()>> Callbacks = MoveTemp(TilePayloadCallbacks);
+	for (TFunction<void()>& Callback : Callbacks)
+	{
+		Callback();
+	}
+}
+
+void UGridTilesData::FailTilePayload()
+{
+	UE_LOG(LogGridTilesData, Error, TEXT("%s: Tile payload failed to decode, its Tiles stay out of the Grid and it's saved back unchanged"), *GetPathName());
+
+	// The payload stays pending with its bulk data, so nothing ever saves the Tiles in memory over it
+	bTilePayloadUndecodable = true;
+
+	if (TilePayloadRequest)
+	{
+		TilePayloadRequest->WaitCompletion();
+		delete TilePayloadRequest;
+		TilePayloadRequest = nullptr;
+	}
+
+	// Waiters go on with whatever the Grid has
+	TArray<TFunction<void()>> Callbacks = MoveTemp(TilePayloadCallbacks);
+	for (TFunction<void()>& Callback : Callbacks)
+	{
+		Callback();
+	}
+}
+
+
+// ***
+// Compact Tile payload
+// ***
+
+void UGridTilesData::EncodeTiles(const TMap<FIntVector, FGridTileData>& Tiles, const TArray<FIntVector>& Instances, const FVector& Origin, const FVector& TileSize, TArray<uint8>& OutBytes)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UGridTilesData::EncodeTiles);
+
+	using namespace GridTilesPayload;
+
+	TArray<const FGridTileData*> Ordered;
+	Ordered.Reserve(Tiles.Num());
+	for (const TPair<FIntVector, FGridTileData>& Pair : Tiles)
+	{
+		Ordered.Emplace(&Pair.Value);
+	}
+
+	Algo::Sort(Ordered, [](const FGridTileData* A, const FGridTileData* B) { return IsBefore(A->Index, B->Index); });
+
+	FMemoryWriter Writer(OutBytes);
+
+	uint8 PayloadVersion = Version;
+	Writer << PayloadVersion;
+	WritePacked(Writer, Ordered.Num());
+
+	// Count the chunks up front so the reader can reserve
+	uint32 ChunkCount = 0;
+	for (int32 i = 0; i < Ordered.Num(); ++i)
+	{
+		ChunkCount += (i == 0 || FGridChunk::GetChunkCoord(Ordered[i]->Index) != FGridChunk::GetChunkCoord(Ordered[i - 1]->Index)) ? 1 : 0;
+	}
+	WritePacked(Writer, ChunkCount);
+
+	int32 ChunkStart = 0;
+	while (ChunkStart < Ordered.Num())
+	{
+		const FIntPoint Chunk = FGridChunk::GetChunkCoord(Ordered[ChunkStart]->Index);
+
+		int32 ChunkEnd = ChunkStart + 1;
+		while (ChunkEnd < Ordered.Num() && FGridChunk::GetChunkCoord(Ordered[ChunkEnd]->Index) == Chunk)
+		{
+			++ChunkEnd;
+		}
+
+		const TArrayView<const FGridTileData*> ChunkTiles(&Ordered[ChunkStart], ChunkEnd - ChunkStart);
+
+		WritePacked(Writer, ZigZag(Chunk.X));
+		WritePacked(Writer, ZigZag(Chunk.Y));
+		WritePacked(Writer, ChunkTiles.Num());
+
+		// Columns, ascending so the deltas stay small
+		int32 PreviousColumn = 0;
+		for (const FGridTileData* Tile : ChunkTiles)
+		{
+			const int32 Column = FGridChunk::GetColumnOffset(FIntPoint(Tile->Index.X, Tile->Index.Y));
+			WritePacked(Writer, Column - PreviousColumn);
+			PreviousColumn = Column;
+		}
+
+		// Heights, as deltas to the previous Tile
+		int32 PreviousZ = 0;
+		for (const FGridTileData* Tile : ChunkTiles)
+		{
+			WritePacked(Writer, ZigZag(Tile->Index.Z - PreviousZ));
+			PreviousZ = Tile->Index.Z;
+		}
+
+		// Types, run-length encoded
+		TArray<TPair<uint32, uint8>, TInlineAllocator<8>> TypeRuns;
+		for (const FGridTileData* Tile : ChunkTiles)
+		{
+			const uint8 Type = static_cast<uint8>(Tile->Type);
+			if (TypeRuns.Num() > 0 && TypeRuns.Last().Value == Type)
+			{
+				++TypeRuns.Last().Key;
+			}
+			else
+			{
+				TypeRuns.Emplace(1, Type);
+			}
+		}
+
+		WritePacked(Writer, TypeRuns.Num());
+		for (TPair<uint32, uint8>& Run : TypeRuns)
+		{
+			WritePacked(Writer, Run.Key);
+			Writer << Run.Value;
+		}
+
+		// States, one bit per state per Tile, skipped entirely for chunks without any
+		TArray<uint8> StateBits;
+		bool bHasStates = false;
+		for (int32 i = 0; i < ChunkTiles.Num(); ++i)
+		{
+			for (const ETileState State : ChunkTiles[i]->States)
+			{
+				if (!bHasStates)
+				{
+					StateBits.SetNumZeroed((ChunkTiles.Num() * StateBitCount + 7) / 8);
+					bHasStates = true;
+				}
+
+				const int32 Bit = i * StateBitCount + static_cast<int32>(State);
+				StateBits[Bit >> 3] |= 1 << (Bit & 7);
+			}
+		}
+
+		Writer << bHasStates;
+		if (bHasStates)
+		{
+			Writer.Serialize(StateBits.GetData(), StateBits.Num());
+		}
+
+		// Transforms that don't match the Index, e.g. rotated or hand placed Tiles
+		TArray<int32, TInlineAllocator<8>> CustomTransforms;
+		for (int32 i = 0; i < ChunkTiles.Num(); ++i)
+		{
+			if (!ChunkTiles[i]->Transform.Equals(GetDefaultTransform(ChunkTiles[i]->Index, Origin, TileSize)))
+			{
+				CustomTransforms.Emplace(i);
+			}
+		}
+
+		WritePacked(Writer, CustomTransforms.Num());
+		for (const int32 i : CustomTransforms)
+		{
+			WritePacked(Writer, i);
+			FTransform Transform = ChunkTiles[i]->Transform;
+			Writer << Transform;
+		}
+
+		ChunkStart = ChunkEnd;
+	}
+
+	// Instance order, as positions in the payload. Left out when it already matches the payload order
+	bool bInstancesInPayloadOrder = Instances.Num() == Ordered.Num();
+	for (int32 i = 0; bInstancesInPayloadOrder && i < Instances.Num(); ++i)
+	{
+		bInstancesInPayloadOrder = Instances[i] == Ordered[i]->Index;
+	}
+
+	Writer << bInstancesInPayloadOrder;
+	if (!bInstancesInPayloadOrder)
+	{
+		TMap<FIntVector, int32> Ordinals;
+		Ordinals.Reserve(Ordered.Num());
+		for (int32 i = 0; i < Ordered.Num(); ++i)
+		{
+			Ordinals.Emplace(Ordered[i]->Index, i);
+		}
+
+		WritePacked(Writer, Instances.Num());
+		for (FIntVector Instance : Instances)
+		{
+			// 0 flags an instance without a Tile, its Index follows
+			const int32* Ordinal = Ordinals.Find(Instance);
+			WritePacked(Writer, Ordinal ? *Ordinal + 1 : 0);
+			if (!Ordinal)
+			{
+				Writer << Instance;
+			}
+		}
+	}
+}
+
+bool UGridTilesData::DecodeTiles(TArrayView<const uint8> Bytes, const FVector& Origin, const FVector& TileSize, FGridTilesPayload& OutPayload)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UGridTilesData::DecodeTiles);
+
+	using namespace GridTilesPayload;
+
+	FMemoryReaderView Reader(Bytes);
+
+	uint8 PayloadVersion = 0;
+	Reader << PayloadVersion;
+	if (PayloadVersion != Version)
+	{
+		UE_LOG(LogGridTilesData, Error, TEXT("Unknown Tile payload version %d"), PayloadVersion);
+		return false;
+	}
+
+	const int32 TileCount = ReadPacked(Reader);
+	const uint32 ChunkCount = ReadPacked(Reader);
+
+	OutPayload.GridTiles.Empty(TileCount);
+	OutPayload.TileHeightTranslator.Empty(TileCount);
+
+	TArray<FIntVector> Ordered;
+	Ordered.Reserve(TileCount);
+
+	TArray<FIntVector> ChunkIndexes;
+	TArray<ETileType> ChunkTypes;
+	TArray<uint8> StateBits;
+
+	for (uint32 c = 0; c < ChunkCount && !Reader.IsError(); ++c)
+	{
+		const FIntPoint Chunk(UnZigZag(ReadPacked(Reader)), UnZigZag(ReadPacked(Reader)));
+		const FIntPoint ChunkOrigin = FGridChunk::GetChunkOrigin(Chunk);
+		const int32 Count = ReadPacked(Reader);
+
+		ChunkIndexes.SetNum(Count);
+
+		int32 Column = 0;
+		for (FIntVector& Index : ChunkIndexes)
+		{
+			Column += ReadPacked(Reader);
+			Index.X = ChunkOrigin.X + (Column & (FGridChunk::Size - 1));
+			Index.Y = ChunkOrigin.Y + (Column >> FGridChunk::SizeLog2);
+		}
+
+		int32 Z = 0;
+		for (FIntVector& Index : ChunkIndexes)
+		{
+			Z += UnZigZag(ReadPacked(Reader));
+			Index.Z = Z;
+		}
+
+		ChunkTypes.Reset(Count);
+		const uint32 RunCount = ReadPacked(Reader);
+		for (uint32 r = 0; r < RunCount; ++r)
+		{
+			const uint32 RunLength = ReadPacked(Reader);
+			uint8 Type = 0;
+			Reader << Type;
+
+			for (uint32 i = 0; i < RunLength && ChunkTypes.Num() < Count; ++i)
+			{
+				ChunkTypes.Emplace(static_cast<ETileType>(Type));
+			}
+		}
+		ChunkTypes.SetNumZeroed(Count);
+
+		bool bHasStates = false;
+		Reader << bHasStates;
+		if (bHasStates)
+		{
+			StateBits.SetNumUninitialized((Count * StateBitCount + 7) / 8);
+			Reader.Serialize(StateBits.GetData(), StateBits.Num());
+		}
+
+		for (int32 i = 0; i < Count; ++i)
+		{
+			const FIntVector Index = ChunkIndexes[i];
+			FGridTileData& Tile = OutPayload.GridTiles.Emplace(Index, FGridTileData(Index, ChunkTypes[i], GetDefaultTransform(Index, Origin, TileSize)));
+
+			if (bHasStates)
+			{
+				for (int32 State = 0; State < StateBitCount; ++State)
+				{
+					const int32 Bit = i * StateBitCount + State;
+					if (StateBits[Bit >> 3] & (1 << (Bit & 7)))
+					{
+						Tile.States.Emplace(static_cast<ETileState>(State));
+					}
+				}
+			}
+
+			// Sorted by column then Z, so appending keeps each column sorted
+			OutPayload.TileHeightTranslator.FindOrAdd(FIntPoint(Index.X, Index.Y)).Translator.Emplace(Index);
+			Ordered.Emplace(Index);
+		}
+
+		const uint32 CustomCount = ReadPacked(Reader);
+		for (uint32 t = 0; t < CustomCount; ++t)
+		{
+			const int32 i = ReadPacked(Reader);
+			FTransform Transform;
+			Reader << Transform;
+
+			if (ChunkIndexes.IsValidIndex(i))
+			{
+				OutPayload.GridTiles.FindChecked(ChunkIndexes[i]).Transform = Transform;
+			}
+		}
+	}
+
+	bool bInstancesInPayloadOrder = true;
+	Reader << bInstancesInPayloadOrder;
+	if (bInstancesInPayloadOrder)
+	{
+		OutPayload.InstanceIndexes = MoveTemp(Ordered);
+	}
+	else
+	{
+		const int32 InstanceCount = ReadPacked(Reader);
+		OutPayload.InstanceIndexes.Empty(InstanceCount);
+
+		for (int32 i = 0; i < InstanceCount && !Reader.IsError(); ++i)
+		{
+			const int32 Ordinal = ReadPacked(Reader);
+			if (Ordinal > 0 && Ordered.IsValidIndex(Ordinal - 1))
+			{
+				OutPayload.InstanceIndexes.Emplace(Ordered[Ordinal - 1]);
+			}
+			else
+			{
+				FIntVector Instance;
+				Reader << Instance;
+				OutPayload.InstanceIndexes.Emplace(Instance);
+			}
+		}
+	}
+
+	if (Reader.IsError())
+	{
+		UE_LOG(LogGridTilesData, Error, TEXT("Tile payload is truncated or corrupt"));
+		return false;
+	}
+
+	// Payload order is chunk major, the storage wants Z-order
+	SortTilesMorton(OutPayload.GridTiles);
+
+	return true;
+}
+
+
+// ***
+// Tile layout
+// ***
+
+void UGridTilesData::SortTilesMorton(TMap<FIntVector, FGridTileData>& Tiles)
+{
+	TRACE_CPUPROFILER_EVENT_SCOPE(UGridTilesData::SortTilesMorton);
+
+	Tiles.KeySort([](const FIntVector A, const FIntVector B)
+	{
+		return FGridTileKey(A) < FGridTileKey(B);
+	});
+}
+
+
+// ***
+// Benchmark
+// ***
+
+#if !UE_BUILD_SHIPPING
+
+static FAutoConsoleCommand GGridBenchmarkTileSerialization(
+	TEXT("Grid.BenchmarkTileSerialization"),
+	TEXT("Times the compact Tile payload against tagged serialization. Optional argument: Tile count (default 1000000)"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 TileCount = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000000;
+		const int32 Side = FMath::Max(1, FMath::CeilToInt(FMath::Sqrt(static_cast<float>(TileCount))));
+		const FVector TileSize(100.0f, 100.0f, 50.0f);
+
+		UGridTilesData* Data = NewObject<UGridTilesData>();
+		Data->GridTileSize = TileSize;
+		Data->GridTiles.Reserve(Side * Side);
+
+		for (int32 x = 0; x < Side; ++x)
+		{
+			for (int32 y = 0; y < Side; ++y)
+			{
+				// Some relief and obstacles so the encoding isn't the best case
+				const FIntVector Index(x, y, (x / 16 + y / 16) % 4);
+				const ETileType Type = (x * 7 + y * 13) % 23 == 0 ? ETileType::Obstacle : ETileType::Normal;
+
+				Data->GridTiles.Emplace(Index, FGridTileData(Index, Type, FTransform(FRotator(0.0f, 0.0f, 0.0f), TileSize * FVector(Index), TileSize / 100.0f)));
+				Data->InstanceIndexes.Emplace(Index);
+				Data->TileHeightTranslator.FindOrAdd(FIntPoint(x, y)).AddTile(Index);
+			}
+		}
+
+		TArray<uint8> CompactBytes;
+		double CompactSave = 0.0;
+		{
+			FScopedDurationTimer Timer(CompactSave);
+			UGridTilesData::EncodeTiles(Data->GridTiles, Data->InstanceIndexes, Data->GridOrigin, Data->GridTileSize, CompactBytes);
+		}
+
+		double CompactLoad = 0.0;
+		{
+			FScopedDurationTimer Timer(CompactLoad);
+			FGridTilesPayload Payload;
+			UGridTilesData::DecodeTiles(CompactBytes, Data->GridOrigin, Data->GridTileSize, Payload);
+		}
+
+		TArray<uint8> TaggedBytes;
+		double TaggedSave = 0.0;
+		{
+			FScopedDurationTimer Timer(TaggedSave);
+			FObjectWriter Writer(Data, TaggedBytes);
+		}
+
+		double TaggedLoad = 0.0;
+		{
+			UGridTilesData* Loaded = NewObject<UGridTilesData>();
+			FScopedDurationTimer Timer(TaggedLoad);
+			FObjectReader Reader(Loaded, TaggedBytes);
+		}
+
+		UE_LOG(LogGridTilesData, Display, TEXT("%d Tiles, compact: save %.1f ms, load %.1f ms, %.2f MB"), Data->GridTiles.Num(), CompactSave * 1000.0, CompactLoad * 1000.0, CompactBytes.Num() / (1024.0 * 1024.0));
+		UE_LOG(LogGridTilesData, Display, TEXT("%d Tiles, tagged:  save %.1f ms, load %.1f ms, %.2f MB"), Data->GridTiles.Num(), TaggedSave * 1000.0, TaggedLoad * 1000.0, TaggedBytes.Num() / (1024.0 * 1024.0));
+	}));
+
+static FAutoConsoleCommand GGridBenchmarkTileLayout(
+	TEXT("Grid.BenchmarkTileLayout"),
+	TEXT("Times path search, flood fill and field of view over row-major and Morton ordered Tiles. Optional argument: Tile count (default 1000000)"),
+	FConsoleCommandWithArgsDelegate::CreateLambda([](const TArray<FString>& Args)
+	{
+		const int32 TileCount = Args.Num() > 0 ? FCString::Atoi(*Args[0]) : 1000000;
+		const int32 Side = FMath::Max(4, FMath::CeilToInt(FMath::Sqrt(static_cast<float>(TileCount))));
+
+		// Same insertion order as the generation worker
+		TMap<FIntVector, FGridTileData> RowMajor;
+		RowMajor.Reserve(Side * Side);
+		for (int32 x = 0; x < Side; ++x)
+		{
+			for (int32 y = 0; y < Side; ++y)
+			{
+				const FIntVector Index(x, y, 0);
+				const ETileType Type = (x * 7 + y * 13) % 23 == 0 ? ETileType::Obstacle : ETileType::Normal;
+				RowMajor.Emplace(Index, FGridTileData(Index, Type, FTransform(FVector(Index))));
+			}
+		}
+
+		TMap<FIntVector, FGridTileData> Morton = RowMajor;
+		UGridTilesData::SortTilesMorton(Morton);
+
+		static const FIntVector Offsets[] = {{1, 0, 0}, {0, 1, 0}, {-1, 0, 0}, {0, -1, 0}};
+
+		auto RunWorkloads = [Side](const TMap<FIntVector, FGridTileData>& Tiles, const TCHAR* Layout)
+		{
+			int64 Checksum = 0;
+
+			// Path search: uniform cost search from the center to a far Tile, scratch indexed by storage slot
+			double PathTime = 0.0;
+			{
+				FScopedDurationTimer Timer(PathTime);
+
+				const FIntVector Start(Side / 2, Side / 2, 0);
+				const FIntVector Target(Side - 2, Side / 4, 0);
+
+				TArray<int32> Previous;
+				Previous.Init(INDEX_NONE, Tiles.GetMaxIndex());
+
+				TArray<FSetElementId> Queue;
+				Queue.Reserve(Tiles.Num());
+				Queue.Emplace(Tiles.FindId(Start));
+				Previous[Queue[0].AsInteger()] = Queue[0].AsInteger();
+
+				for (int32 Head = 0; Head < Queue.Num(); ++Head)
+				{
+					const FIntVector Current = Tiles.Get(Queue[Head]).Key;
+					if (Current == Target)
+					{
+						for (int32 Ordinal = Queue[Head].AsInteger(); Previous[Ordinal] != Ordinal; Ordinal = Previous[Ordinal])
+						{
+							++Checksum;
+						}
+						break;
+					}
+
+					for (const FIntVector& Offset : Offsets)
+					{
+						const FSetElementId Id = Tiles.FindId(Current + Offset);
+						if (Id.IsValidId() && Previous[Id.AsInteger()] == INDEX_NONE && UGridTilesData::IsTileTypeWalkable(Tiles.Get(Id).Value.Type))
+						{
+							Previous[Id.AsInteger()] = Queue[Head].AsInteger();
+							Queue.Emplace(Id);
+						}
+					}
+				}
+			}
+
+			// Flood fill: every walkable Tile reachable from a corner
+			double FloodTime = 0.0;
+			{
+				FScopedDurationTimer Timer(FloodTime);
+
+				TBitArray<> Visited(false, Tiles.GetMaxIndex());
+				TArray<FIntVector> Stack;
+				Stack.Emplace(1, 1, 0);
+				Visited[Tiles.FindId(Stack[0]).AsInteger()] = true;
+
+				while (!Stack.IsEmpty())
+				{
+					const FIntVector Current = Stack.Pop();
+					++Checksum;
+
+					for (const FIntVector& Offset : Offsets)
+					{
+						const FSetElementId Id = Tiles.FindId(Current + Offset);
+						if (Id.IsValidId() && !Visited[Id.AsInteger()] && UGridTilesData::IsTileTypeWalkable(Tiles.Get(Id).Value.Type))
+						{
+							Visited[Id.AsInteger()] = true;
+							Stack.Emplace(Current + Offset);
+						}
+					}
+				}
+			}
+
+			// Field of view: every Tile in a radius around a spread of viewers, counting the blockers
+			double FovTime = 0.0;
+			{
+				FScopedDurationTimer Timer(FovTime);
+
+				constexpr int32 Radius = 12;
+				const int32 Step = FMath::Max(Side / 16, 1);
+
+				for (int32 ViewerX = Radius; ViewerX < Side - Radius; ViewerX += Step)
+				{
+					for (int32 ViewerY = Radius; ViewerY < Side - Radius; ViewerY += Step)
+					{
+						for (int32 x = -Radius; x <= Radius; ++x)
+						{
+							for (int32 y = -Radius; y <= Radius; ++y)
+							{
+								const FGridTileData* Tile = x * x + y * y <= Radius * Radius ? Tiles.Find(FIntVector(ViewerX + x, ViewerY + y, 0)) : nullptr;
+								Checksum += Tile && Tile->Type == ETileType::Obstacle;
+							}
+						}
+					}
+				}
+			}
+
+			UE_LOG(LogGridTilesData, Display, TEXT("%d Tiles, %s: path %.1f ms, flood fill %.1f ms, field of view %.1f ms (checksum %lld)"),
+				Tiles.Num(), Layout, PathTime * 1000.0, FloodTime * 1000.0, FovTime * 1000.0, Checksum);
+		};
+
+		RunWorkloads(RowMajor, TEXT("row-major"));
+		RunWorkloads(Morton, TEXT("Morton"));
+	}));
+
+#endif
@@ -10,3 +10,8 @@ FVector UGridUtilities::SnapVectorToVector(const FVector& V1, const FVector& V2)
 		FMath::GridSnap(V1.Y, V2.Y),
 		FMath::GridSnap(V1.Z, V2.Z));
 }
+
+FVector UGridUtilities::GetGridBottomLeftCorner(const FVector& CenterLocation, const FVector& TileSize, const FIntPoint TileCount)
+{
+	return SnapVectorToVector(CenterLocation, TileSize) - (TileSize * FVector(((TileCount - FIntPoint(TileCount.X % 2 == 0 ? 0 : 1, TileCount.Y % 2 == 0 ? 0 : 1)) / 2.0f),0.0f));
+}
@@ -3,11 +3,89 @@
 #pragma once
 
 #include "CoreMinimal.h"
+#include "Async/Future.h"
 #include "GameFramework/Actor.h"
 #include "GridTilesData.h"
+#include "GridChunk.h"
+#include "GridChangeJournal.h"
+#include "GridSpatialIndex.h"
+#include "GridOccupancy.h"
+#include "GridJobScheduler.h"
+#include "GridTerrain.h"
+#include "GridTerrainTracer.h"
+#include "GridImporter.h"
+#include "GridEditBuffer.h"
+#include "GridPatternCache.h"
 #include "GridActor.generated.h"
 
 class UInstancedStaticMeshComponent;
+class FGridChunkStore;
+class FGridSnapshot;
+struct FGridGenerationQueue;
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnGridTilesChangedSignature, const FGridTileChanges&, Changes);
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnGridGeneratedSignature);
+
+DECLARE_DYNAMIC_MULTICAST_DELEGATE_TwoParams(FOnTileOccupancyChangedSignature, FIntVector, Index, AActor*, Unit);
+
+UENUM(BlueprintType)
+enum class EGridStencilOperation : uint8
+{
+	Fill		UMETA(DisplayName="Fill"),
+	SetType		UMETA(DisplayName="Set Type"),
+	Raise		UMETA(DisplayName="Raise"),
+	Remove		UMETA(DisplayName="Remove")
+};
+
+/**
+ * Instance side of a batch of Tile edits, applied once the Tile storage is already up to date
+ */
+struct FGridInstanceEdits
+{
+	TSet<FIntVector> Removed;
+
+	/** Old Index to new Index of Tiles that moved, their instance is moved in place */
+	TMap<FIntVector, FIntVector> Moved;
+
+	TArray<FIntVector> Added;
+};
+
+/**
+ * Instances of one chunk. Each chunk draws through its own component, so an edit only rebuilds the
+ * instance buffer of its chunk and chunks are culled and LODed on their own
+ */
+USTRUCT()
+struct FGridChunkInstances
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Transient)
+	TObjectPtr<UInstancedStaticMeshComponent> Component;
+
+	/** Tile of each instance of the component */
+	TArray<FIntVector> Indexes;
+};
+
+/**
+ * Tile a ray ran into, see AGridActor::TraceGridTiles
+ */
+USTRUCT(BlueprintType)
+struct FGridRayHit
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Category="Grid|Queries", VisibleAnywhere, BlueprintReadOnly)
+	FIntVector Index{0, 0, 0};
+
+	/** Where the ray enters the Tile */
+	UPROPERTY(Category="Grid|Queries", VisibleAnywhere, BlueprintReadOnly)
+	FVector Location = FVector::ZeroVector;
+
+	/** From the start of the ray */
+	UPROPERTY(Category="Grid|Queries", VisibleAnywhere, BlueprintReadOnly)
+	float Distance = 0.0f;
+};
 
 UCLASS()
 class GRID_API AGridActor : public AActor
@@ -22,18 +100,48 @@ protected:
 	// Called when the game starts or when spawned
 	virtual void BeginPlay() override;
 
+	virtual void EndPlay(const EEndPlayReason::Type EndPlayReason) override;
+
 	virtual void BeginDestroy() override;
 
-	class FGridGenerateInstancesWorker* GridGenerateInstancesWorker;
+	/** Chunk components aren't saved, they're rebuilt from the Tiles */
+	virtual void PostRegisterAllComponents() override;
+
+#if WITH_EDITOR
+	/** Undo puts the Tiles back, everything derived from them is rebuilt */
+	virtual void PostEditUndo() override;
+#endif
+
+	/** Jobs of the running generation, the last one hands the result to the Grid */
+	TArray<FGridJobHandle> GenerationJobs;
 
 public:
 	// Called every frame
 	virtual void Tick(float DeltaTime) override;
 
+	virtual bool ShouldTickIfViewportsOnly() const override;
+
+	// ***
+	// Delegates
+	// ***
+
+	/** Fired at most once per frame with every Tile changed since the previous broadcast */
+	UPROPERTY(BlueprintAssignable)
+	FOnGridTilesChangedSignature OnGridTilesChanged;
+
+	/** Fired right away for every Tile a unit enters or leaves, Unit is null when the Tile was freed */
+	UPROPERTY(BlueprintAssignable)
+	FOnTileOccupancyChangedSignature OnTileOccupancyChanged;
+
+	/** Fired once every generated Tile made it into the Grid */
+	UPROPERTY(BlueprintAssignable)
+	FOnGridGeneratedSignature OnGridGenerated;
+
 	// ***
 	// Grid Properties
 	// ***
 
+	/** Root of the chunk components, which take its mesh, material and collision. Holds no instances itself */
 	UPROPERTY(Category="Grid", VisibleDefaultsOnly, BlueprintReadOnly)
 	TObjectPtr<UInstancedStaticMeshComponent> GridComponent;
 
@@ -58,15 +166,120 @@ public:
 	UPROPERTY(Category="Grid", EditAnywhere, BlueprintReadWrite)
 	TObjectPtr<UGridTilesData> GridTilesData;
 
+	/** Number of Tile changes the journal remembers, older versions can only be answered with dirty rects */
+	UPROPERTY(Category="Grid", EditAnywhere, BlueprintReadWrite, meta=(ClampMin=1))
+	int32 ChangeJournalCapacity = 16384;
+
+	/**
+	 * AddGridTile, RemoveGridTile and MoveGridTile only record the edit, and every Tile edited this frame is committed
+	 * in one batch on the next one, or by CommitTileEdits. Queries see the Grid as of the last commit. Batch, region and
+	 * state edits still apply right away, they commit the pending edits first so every edit lands in the order it was made
+	 */
+	UPROPERTY(Category="Grid", EditAnywhere, BlueprintReadWrite)
+	bool bDeferTileEdits = false;
+
+	/**
+	 * States a Tile's instance is highlighted with, the first one a Tile has wins. Instance custom data float 0 holds its ETileState value,
+	 * 0 when the Tile has none of them, float 1 holds every state of the Tile as a bit mask (1 << ETileState value).
+	 * The plugin ships no material for it, the one set through InitializeInstances reads them with PerInstanceCustomData.
+	 */
+	UPROPERTY(Category="Grid|States", EditAnywhere, BlueprintReadWrite)
+	TArray<ETileState> HighlightPriority = {
+		ETileState::Hovered,
+		ETileState::Selected,
+		ETileState::Path,
+		ETileState::SpellRangeAoE,
+		ETileState::SpellRange,
+		ETileState::Reachable,
+		ETileState::Neighbour,
+		ETileState::Analyzed,
+		ETileState::Discovered
+	};
+
+	/** Hand generated chunks over a few at a time, so the Grid fills in while the game keeps running. SpawnGrid returns before the Tiles are in */
+	UPROPERTY(Category="Grid|Generation", EditAnywhere, BlueprintReadWrite)
+	bool bProgressiveGeneration = false;
+
+	/** Game Thread time spent adding generated chunks per frame, at least one chunk goes in every frame */
+	UPROPERTY(Category="Grid|Generation", EditAnywhere, BlueprintReadWrite, meta=(EditCondition="bProgressiveGeneration", ClampMin=0.1, Units="ms"))
+	float GenerationFrameBudgetMs = 4.0f;
+
+	/** Generate terrain from seeded noise instead of a flat Grid */
+	UPROPERTY(Category="Grid|Generation", EditAnywhere, BlueprintReadWrite)
+	bool bGenerateTerrain = false;
+
+	UPROPERTY(Category="Grid|Generation", EditAnywhere, BlueprintReadWrite, meta=(EditCondition="bGenerateTerrain"))
+	FGridTerrainSettings TerrainSettings;
+
+	/** Lay the Tiles on the world below the Grid with line traces, instead of generating them */
+	UPROPERTY(Category="Grid|Generation", EditAnywhere, BlueprintReadWrite)
+	bool bConformToWorld = false;
+
+	UPROPERTY(Category="Grid|Generation", EditAnywhere, BlueprintReadWrite, meta=(EditCondition="bConformToWorld"))
+	FGridTraceSettings ConformSettings;
+
+	/**
+	 * Every column inside the Grid has a Normal Tile at Z 0 that's never stored, only Tiles that differ from it are.
+	 * Memory and generation time follow the number of edited Tiles. Default Tiles get no instance, draw the ground with the level,
+	 * except while they have states or an overlay to show.
+	 */
+	UPROPERTY(Category="Grid|Generation", EditAnywhere, BlueprintReadWrite)
+	bool bImplicitTiles = false;
+
+	// ***
+	// Grid Streaming Properties
+	// ***
+
+	/** Keep only the chunks around the focus points in memory, the rest lives in the chunk store on disk */
+	UPROPERTY(Category="Grid|Streaming", EditAnywhere, BlueprintReadWrite)
+	bool bStreamChunks = false;
+
+	/** Chunk store folder, defaults to Saved/GridChunks/<ActorName> when empty */
+	UPROPERTY(Category="Grid|Streaming", EditAnywhere, BlueprintReadWrite, meta=(EditCondition="bStreamChunks"))
+	FString ChunkStoreDirectory;
+
+	/** Chunks within this radius of a focus point get loaded, they get unloaded one chunk further out */
+	UPROPERTY(Category="Grid|Streaming", EditAnywhere, BlueprintReadWrite, meta=(EditCondition="bStreamChunks", ClampMin=0))
+	int32 ChunkStreamingRadius = 2;
+
+	/** Use the first player's camera as a focus point */
+	UPROPERTY(Category="Grid|Streaming", EditAnywhere, BlueprintReadWrite, meta=(EditCondition="bStreamChunks"))
+	bool bStreamAroundPlayerCamera = true;
+
+	UPROPERTY(Category="Grid|Streaming", EditAnywhere, BlueprintReadWrite, meta=(EditCondition="bStreamChunks"))
+	TArray<TObjectPtr<AActor>> StreamingFocusActors;
+
 	// ***
 	// Grid Generation
 	// ***
 
 	UFUNCTION(Category="Grid|Generation", BlueprintCallable)
 	void SpawnGrid(const FVector CenterLocation, const FVector TileSize, const FIntPoint TileCount, const bool bFastGen = false);
+
+	/**
+	 * Imports the Grid from a heightmap and/or a type map. Imports always go through the chunk store, which is cleared first.
+	 * With bStreamChunks off every imported chunk is loaded once the import is done, otherwise streaming takes over from there.
+	 */
+	UFUNCTION(Category="Grid|Generation", BlueprintCallable)
+	void ImportGrid(const FVector CenterLocation, const FVector TileSize, const FGridImportSettings& Settings);
+
+	/** True while generated chunks are still on their way in */
+	UFUNCTION(Category="Grid|Generation", BlueprintPure)
+	bool IsGenerating() const;
+
+	/** Progress of the generation job, 0 to 1 */
+	UFUNCTION(Category="Grid|Generation", BlueprintPure)
+	float GetGenerationProgress() const;
+
+	/** Stops generating, whatever already made it into the Grid stays */
+	UFUNCTION(Category="Grid|Generation", BlueprintCallable)
+	void CancelGeneration();
 	
 	UFUNCTION(Category="Grid|Generation", BlueprintCallable)
-	void GenerateGridTiles(const TArray<FTransform> Transforms, const TArray<FIntVector> Indexes, const TMap<FIntVector, FGridTileData> GridTiles, const TMap<FIntPoint, FTileHeightTranslator> TileHeightTranslator) const;
+	void GenerateGridTiles(const TArray<FTransform>& Transforms, const TArray<FIntVector>& Indexes, const TMap<FIntVector, FGridTileData>& GridTiles, const TMap<FIntPoint, FTileHeightTranslator>& TileHeightTranslator) const;
+
+	/** Native GenerateGridTiles, takes ownership of the buffers instead of copying them */
+	void TakeGeneratedTiles(FGridTilesPayload&& Payload, TArray<FTransform>&& Transforms) const;
 
 	UFUNCTION(Category="Grid|Generation", BlueprintCallable)
 	void AddGridTiles(const TArray<FIntVector> Indexes) const;
@@ -86,9 +299,67 @@ public:
 	UFUNCTION(Category="Grid|Generation", BlueprintCallable)
 	void MoveGridTile(const FIntVector Index, const int32 MoveAmount);
 
+	/** Moves each Tile by its own amount in one batch, a single transform update and render state flush per chunk */
+	UFUNCTION(Category="Grid|Generation", BlueprintCallable)
+	int32 MoveGridTiles(const TArray<FIntVector>& Indexes, const TArray<int32>& MoveAmounts);
+
+	/** Applies the deferred edits now instead of on the next frame, see bDeferTileEdits */
+	UFUNCTION(Category="Grid|Generation", BlueprintCallable)
+	void CommitTileEdits() const;
+
+	/** Deferred edits waiting for the next commit, at most one per Tile */
+	UFUNCTION(Category="Grid|Generation", BlueprintCallable, BlueprintPure)
+	int32 GetPendingTileEdits() const { return TileEditBuffer.Num(); }
+
 	UFUNCTION(Category="Grid|Generation", BlueprintCallable)
 	void DestroyGrid();
 
+	// ***
+	// Grid Regions
+	// ***
+
+	/** Puts a Tile of the type at Height on every column of the rect, Min and Max included. None removes them. Returns the Tiles touched */
+	UFUNCTION(Category="Grid|Regions", BlueprintCallable)
+	int32 FillRect(const FIntPoint Min, const FIntPoint Max, const ETileType Type, const int32 Height = 0);
+
+	/** Changes the type of every Tile in the columns of the rect */
+	UFUNCTION(Category="Grid|Regions", BlueprintCallable)
+	int32 SetTypeInRegion(const FIntPoint Min, const FIntPoint Max, const ETileType Type);
+
+	/** Moves every Tile in the columns of the rect up by Amount, down when negative */
+	UFUNCTION(Category="Grid|Regions", BlueprintCallable)
+	int32 RaiseRegion(const FIntPoint Min, const FIntPoint Max, const int32 Amount);
+
+	/** Applies the operation at Origin + each offset, Raise moves the whole column. Offsets as from GetIndexesFromPatternAndRange at the zero Index */
+	UFUNCTION(Category="Grid|Regions", BlueprintCallable)
+	int32 ApplyStencil(const FIntVector Origin, const TArray<FIntVector>& Offsets, const EGridStencilOperation Operation, const ETileType Type = ETileType::Normal, const int32 Amount = 1);
+
+	// ***
+	// Grid States
+	// ***
+
+	/** Floats 0 and 1 as described by HighlightPriority, float 2 holds the overlay value, 0 without one */
+	static constexpr int32 InstanceCustomDataFloats = 3;
+
+	/** Adds or removes the state on every Tile, their instances are updated once per chunk. Returns the Tiles changed */
+	UFUNCTION(Category="Grid|States", BlueprintCallable)
+	int32 SetTilesState(const TArray<FIntVector>& Indexes, const ETileState State, const bool bEnabled = true);
+
+	/** Removes the state from every Tile it was set on */
+	UFUNCTION(Category="Grid|States", BlueprintCallable)
+	int32 ClearTileState(const ETileState State);
+
+	/**
+	 * Shows Value on the instances of the Tiles without touching the Tiles themselves, meant for debug views.
+	 * Nothing is saved or journaled. Default Tiles get an instance for as long as they have an overlay
+	 */
+	UFUNCTION(Category="Grid|States", BlueprintCallable)
+	void SetTilesOverlay(const TArray<FIntVector>& Indexes, const float Value);
+
+	/** Removes the overlay from every instance */
+	UFUNCTION(Category="Grid|States", BlueprintCallable)
+	void ClearTilesOverlay();
+
 	UFUNCTION(Category="Grid|Generation", BlueprintCallable, BlueprintPure)
 	void CalculateCenterAndBottomLeft(FVector& CenterLocation, FVector& BottomLeftCornerLocation) const;
 
@@ -108,12 +379,15 @@ public:
 	UFUNCTION(Category="Grid|Utilities", BlueprintCallable, BlueprintPure)
 	TMap<FIntVector, FGridTileData>& GetGridTiles() const;
 
-	UFUNCTION(Category="Grid|Utilities", BlueprintCallable, BlueprintPure)
-	TArray<FIntVector>& GetInstanceIndexes() const;
-
 	UFUNCTION(Category="Grid|Utilities", BlueprintCallable, BlueprintPure)
 	TArray<FIntVector> FindGridTilesAtIndex(const FIntPoint Index) const;
 
+	/**
+	 * Non-allocating view over the Tiles of a column, sorted by Z, implicit Tile included.
+	 * Invalidated by any edit of that column, and for a column with an implicit Tile by the next call.
+	 */
+	TArrayView<const FIntVector> GetGridTilesAtIndex(const FIntPoint Index) const;
+
 	UFUNCTION(Category="Grid|Utilities", BlueprintCallable, BlueprintPure)
 	bool IsIndexValid(const FIntVector Index) const;
 	
@@ -123,15 +397,179 @@ public:
 	UFUNCTION(Category="Grid|Utilities", BlueprintCallable, BlueprintPure)
 	bool IsTileWalkable(const FIntVector Index) const;
 
+	/** True for a default Tile of an implicit Grid that isn't stored */
+	UFUNCTION(Category="Grid|Utilities", BlueprintCallable, BlueprintPure)
+	bool IsImplicitTile(const FIntVector Index) const;
+
+	/** Copy of a Tile, stored or implicit */
+	UFUNCTION(Category="Grid|Utilities", BlueprintCallable)
+	bool FindTileData(const FIntVector Index, FGridTileData& OutData) const;
+
+	/** Default Tile of an implicit Grid at Index */
+	FGridTileData MakeImplicitTile(const FIntVector Index) const;
+
+	/** Default Tiles holding a unit or states, the only ones MakeImplicitTile doesn't return bare */
+	void GetImplicitTilesWithData(TArray<FIntVector>& OutIndexes) const;
+
+	/**
+	 * Immutable copy of the Tiles in memory, safe to hand to worker threads and to fork.
+	 * Consecutive snapshots share every chunk that wasn't edited through the Grid Actor in between.
+	 */
+	TSharedRef<const FGridSnapshot> GetGridSnapshot() const;
+
+	// ***
+	// Grid Changes
+	// ***
+
+	/** Goes up by one with every Tile change, cheap to compare against a cached value */
+	UFUNCTION(Category="Grid|Changes", BlueprintCallable, BlueprintPure)
+	int64 GetGridVersion() const { return ChangeJournal.GetVersion(); }
+
+	UFUNCTION(Category="Grid|Changes", BlueprintCallable, BlueprintPure)
+	int64 GetChunkVersion(const FIntPoint Chunk) const { return ChangeJournal.GetChunkVersion(Chunk); }
+
+	/**
+	 * Each Tile changed after the version, chunks streamed in or out as a whole come out as their column rect (max exclusive).
+	 * False if the journal doesn't reach back that far, rescan everything then
+	 */
+	UFUNCTION(Category="Grid|Changes", BlueprintCallable)
+	bool GetChangedTilesSince(const int64 Version, TArray<FIntVector>& OutTiles, TArray<FIntRect>& OutRects) const;
+
+	/** Column rects (max exclusive) of the chunks changed after the version, survives journal overflow */
+	bool GetDirtyRectsSince(const int64 Version, TArray<FIntRect>& OutRects) const;
+
+	const FGridChangeJournal& GetChangeJournal() const { return ChangeJournal; }
+
+	// ***
+	// Grid Queries
+	// ***
+
+	/** Tiles whose column lies between Min and Max included, OutTiles is reset and refilled */
+	UFUNCTION(Category="Grid|Queries", BlueprintCallable)
+	int32 QueryTilesInRect(const FIntPoint Min, const FIntPoint Max, const FGridTileQueryFilter& Filter, TArray<FIntVector>& OutTiles) const;
+
+	/** Tiles whose column lies within Radius columns of Center, OutTiles is reset and refilled */
+	UFUNCTION(Category="Grid|Queries", BlueprintCallable)
+	int32 QueryTilesInRadius(const FIntPoint Center, const float Radius, const FGridTileQueryFilter& Filter, TArray<FIntVector>& OutTiles) const;
+
+	/** Up to Count Tiles nearest to Origin, nearest first, OutTiles is reset and refilled */
+	UFUNCTION(Category="Grid|Queries", BlueprintCallable)
+	int32 QueryNearestTiles(const FIntVector Origin, const int32 Count, const FGridTileQueryFilter& Filter, TArray<FIntVector>& OutTiles, const int32 MaxRadius = 64) const;
+
+	UFUNCTION(Category="Grid|Queries", BlueprintCallable)
+	bool FindNearestTileToLocation(const FVector Location, const FGridTileQueryFilter& Filter, FIntVector& OutIndex, const int32 MaxRadius = 64) const;
+
+	/**
+	 * First Tile on the segment, found by walking the columns under it and testing the heights of their Tiles.
+	 * Each Tile fills its column cell and one Tile step of height around its location, no collision involved
+	 */
+	UFUNCTION(Category="Grid|Queries", BlueprintCallable)
+	bool TraceGridTiles(const FVector Start, const FVector End, FGridRayHit& OutHit) const;
+
+	/** Direct access for native callers that keep a prebuilt filter mask around, Game Thread only */
+	FGridSpatialIndex& GetSpatialIndex() const { return SpatialIndex; }
+
+	// ***
+	// Grid Units
+	// ***
+
+	/** Puts the unit on a free Tile, moving it there if it already stands somewhere */
+	UFUNCTION(Category="Grid|Units", BlueprintCallable)
+	bool PlaceUnit(AActor* Unit, const FIntVector Index);
+
+	/** Moves a placed unit to a free Tile, fails without changing anything if it can't */
+	UFUNCTION(Category="Grid|Units", BlueprintCallable)
+	bool MoveUnit(AActor* Unit, const FIntVector To);
+
+	UFUNCTION(Category="Grid|Units", BlueprintCallable)
+	AActor* RemoveUnitFromTile(const FIntVector Index);
+
+	UFUNCTION(Category="Grid|Units", BlueprintCallable)
+	bool RemoveUnit(AActor* Unit);
+
+	UFUNCTION(Category="Grid|Units", BlueprintCallable, BlueprintPure)
+	AActor* GetUnitOnTile(const FIntVector Index) const;
+
+	UFUNCTION(Category="Grid|Units", BlueprintCallable, BlueprintPure)
+	bool FindUnitTile(const AActor* Unit, FIntVector& OutIndex) const;
+
+	UFUNCTION(Category="Grid|Units", BlueprintCallable, BlueprintPure)
+	bool IsTileOccupied(const FIntVector Index) const;
+
+	/** Units in the neighbouring columns, at most MaxHeightDifference Tiles above or below, OutUnits is reset and refilled */
+	UFUNCTION(Category="Grid|Units", BlueprintCallable)
+	int32 GetAdjacentUnits(const FIntVector Index, const bool bIncludeDiagonals, TArray<AActor*>& OutUnits, const int32 MaxHeightDifference = 1) const;
+
+	/**
+	 * Unit to Tile and Tile to unit lookups. Setting UnitOnTile by hand bypasses it,
+	 * go through the Grid Units functions, UnitOnTile is kept as a mirror for saving and Blueprints.
+	 */
+	const FGridOccupancy& GetOccupancy() const { return Occupancy; }
+
 	UFUNCTION(Category="Instances", BlueprintCallable)
 	void InitializeInstances(UStaticMesh* Mesh, UMaterialInstance* Material);
 
+	/** Recreates every chunk component from the Tiles, call it once a deferred Tile payload is loaded */
+	UFUNCTION(Category="Instances", BlueprintCallable)
+	void RebuildInstances() const;
+
+	// ***
+	// Grid Streaming
+	// ***
+
+	UFUNCTION(Category="Grid|Streaming", BlueprintCallable)
+	void StartChunkStreaming();
+
+	/** Writes back the edited chunks and stops streaming, loaded chunks stay in memory */
+	UFUNCTION(Category="Grid|Streaming", BlueprintCallable)
+	void StopChunkStreaming();
+
+	/** Writes every Tile currently in memory to the chunk store */
+	UFUNCTION(Category="Grid|Streaming", BlueprintCallable)
+	void BakeChunkStore();
+
+	UFUNCTION(Category="Grid|Streaming", BlueprintCallable)
+	void AddStreamingFocus(AActor* Focus);
+
+	UFUNCTION(Category="Grid|Streaming", BlueprintCallable)
+	void RemoveStreamingFocus(AActor* Focus);
+
+	UFUNCTION(Category="Grid|Streaming", BlueprintCallable, BlueprintPure)
+	bool IsChunkLoaded(const FIntPoint Chunk) const;
+
+	/** Brings a stored chunk in right away, blocking on the store, for code that can't wait for a focus to come near it */
+	UFUNCTION(Category="Grid|Streaming", BlueprintCallable)
+	bool LoadChunkNow(const FIntPoint Chunk);
+
+	/** True if the Tile belongs to a chunk that exists in the store but isn't in memory right now */
+	UFUNCTION(Category="Grid|Streaming", BlueprintCallable, BlueprintPure)
+	bool IsTileInUnloadedChunk(const FIntVector Index) const;
+
+	/** Coarse walkability of a column of an unloaded chunk, from its chunk summary */
+	UFUNCTION(Category="Grid|Streaming", BlueprintCallable, BlueprintPure)
+	bool IsUnloadedTileWalkable(const FIntVector Index) const;
+
+	const FGridChunkSummary* FindChunkSummary(const FIntPoint Chunk) const { return ChunkSummaries.Find(Chunk); }
+
+	/** Called on the Game Thread once a worker has generated the Grid straight into the chunk store */
+	void SetChunkSummaries(TMap<FIntPoint, FGridChunkSummary>&& Summaries);
+
 	// ***
 	// Grid Patterns
 	// ***
 	
 	UFUNCTION(Category="Grid|Patterns", BlueprintCallable, BlueprintPure)
 	static TArray<FIntVector> GetIndexesFromPatternAndRange(FIntVector OriginIndex, const EGridPattern Pattern, const FIntPoint Range);
+
+	/** Same, with Cone and LineToTarget pointing from OriginIndex at TargetIndex */
+	UFUNCTION(Category="Grid|Patterns", BlueprintCallable, BlueprintPure)
+	static TArray<FIntVector> GetIndexesFromPatternTowards(FIntVector OriginIndex, const EGridPattern Pattern, const FIntPoint Range, const FIntVector TargetIndex);
+
+	/** Cached offsets of the pattern around the zero Index, add them to an Index to stamp the pattern without allocating. Hold the result while walking it */
+	static TSharedRef<const TArray<FIntVector>> GetPatternOffsets(const EGridPattern Pattern, const FIntPoint Range, const FIntPoint Direction = FIntPoint(1, 0))
+	{
+		return FGridPatternCache::GetStencil(Pattern, Range, Direction);
+	}
 	
 
 private:
@@ -146,23 +584,62 @@ private:
 	
 	void ClearInstances() const;
 
+	/** Adds instances for Tiles already stored, one call per run of Tiles from the same chunk */
+	void AddInstances(TConstArrayView<FIntVector> Indexes, TConstArrayView<FTransform> Transforms) const;
+
+	/** Creates the chunk's component the first time one of its Tiles gets an instance */
+	FGridChunkInstances& FindOrCreateChunkInstances(const FIntPoint Chunk) const;
+
+	/** Tile an instance draws, a default one is made in a scratch that stays valid until the next call */
+	const FGridTileData* FindInstancedTile(const FIntVector Index) const;
+
+	/** Queues an instance for a default Tile that got states or an overlay, or the removal of one that has neither anymore */
+	void UpdateImplicitInstance(const FIntVector Index, FGridInstanceEdits& Edits) const;
+
+	/** Writes the highlight and overlay of each Tile into its instance custom data, one render state update per touched chunk */
+	void UpdateInstanceStates(TConstArrayView<FIntVector> Indexes) const;
+
+	/** See HighlightPriority */
+	void WriteInstanceCustomData(UInstancedStaticMeshComponent* Component, const int32 Slot, const FGridTileData& Data) const;
+
+	/** Fills the InstanceCustomDataFloats floats of a Tile's instance */
+	void MakeInstanceCustomData(const FGridTileData& Data, TArrayView<float> OutCustomData) const;
+
+	/** Adds or removes a state of a default Tile without storing it. Returns false if it already was that way */
+	bool SetImplicitTileState(const FIntVector Index, const ETileState State, const bool bEnabled) const;
+
+	/** Remembers the Tile under each of its states, so ClearTileState doesn't have to go through every Tile */
+	void TrackTileStates(const FGridTileData& Data) const;
+
+	/** Forgets the states and overlay of whatever Tile is at Index, before another Tile replaces it */
+	void UntrackTileStates(const FIntVector Index) const;
+
+	/** Applies a whole batch to the instances, split per chunk so only the touched chunks get rebuilt */
+	void ApplyInstanceEdits(const FGridInstanceEdits& Edits) const;
+
+	/** One pass to find the slots, holes refilled from the tail, one render state update */
+	void ApplyChunkInstanceEdits(FGridChunkInstances& ChunkInstance, const FGridInstanceEdits& Edits) const;
+
 	// ***
-	// Grid Patterns
+	// Batched edits
 	// ***
-	
-	static TArray<FIntVector> OffsetIndexArray(TArray<FIntVector> Array, const FIntVector Offset);
-	
-	static TArray<FIntVector> GetPatternLine(const FIntPoint Range);
-	
-	static TArray<FIntVector> GetPatternDiagonal(const FIntPoint Range);
-	
-	static TArray<FIntVector> GetPatternHalfDiagonal(const FIntPoint Range);
-	
-	static TArray<FIntVector> GetPatternStar(const FIntPoint Range);
-	
-	static TArray<FIntVector> GetPatternDiamond(const FIntPoint Range);
-	
-	static TArray<FIntVector> GetPatternSquare(const FIntPoint Range);
+
+	int32 FillTiles(const TConstArrayView<FIntVector> Indexes, const ETileType Type);
+
+	/** AddGridTile for a whole batch, Tiles already there are replaced */
+	int32 AddTiles(const TConstArrayView<FGridTileData> Tiles) const;
+
+	int32 SetTileTypes(const TConstArrayView<FIntVector> Indexes, const ETileType Type);
+
+	int32 MoveTiles(const TConstArrayView<FIntVector> Indexes, const int32 MoveAmount);
+
+	/** One amount for every Tile, or one per Tile. Moved Tiles keep their instance, only its transform changes */
+	int32 MoveTiles(const TConstArrayView<FIntVector> Indexes, const TConstArrayView<int32> MoveAmounts);
+
+	int32 RemoveTiles(const TConstArrayView<FIntVector> Indexes);
+
+	/** Every Tile in the columns of the rect, clamped to the Grid bounds */
+	void GatherRectTiles(const FIntPoint Min, const FIntPoint Max, TArray<FIntVector>& OutIndexes) const;
 
 	// ***
 	// Utilities
@@ -173,4 +650,133 @@ private:
 	void AddTileToTranslator(FIntVector Index) const;
 
 	void RemoveTileFromTranslator(FIntVector Index) const;
+
+	/** Stores the default Tile at Index so it can be edited, returns the stored Tile. Its instance is queued in Edits */
+	FGridTileData* MaterializeImplicitTile(const FIntVector Index, FGridInstanceEdits& Edits) const;
+
+	/** Keeps a removed Tile of an implicit Grid from falling back to the default */
+	void SuppressImplicitTile(const FIntVector Index) const;
+
+	// ***
+	// Progressive Generation
+	// ***
+
+	/** Moves queued chunks into the Grid until the frame budget runs out */
+	void DrainGenerationQueue();
+
+	// ***
+	// Streaming
+	// ***
+
+	TSharedPtr<FGridChunkStore> GetOrCreateChunkStore();
+
+	void UpdateChunkStreaming();
+
+	void StreamInChunk(const FIntPoint Chunk, TArray<FGridTileData>&& Tiles);
+
+	void StreamOutChunk(const FIntPoint Chunk);
+
+	void GatherChunkTiles(const FIntPoint Chunk, TArray<FIntVector>& OutIndexes) const;
+
+	void SaveChunk(const FIntPoint Chunk, const TArray<FIntVector>& Indexes, const bool bAsync);
+
+	/** Blocks until every in-flight chunk load and save is done */
+	void FlushChunkStreaming();
+
+	void MarkChunkDirty(const FIntVector Index) const;
+
+	// ***
+	// Changes
+	// ***
+
+	void RecordTileChange(const FIntVector Index, const EGridTileChange Change) const;
+
+	/** Every Tile of the chunk changed at once, a single journal entry */
+	void RecordChunkChange(const FIntPoint Chunk, const EGridTileChange Change) const;
+
+	/** Whole Grid replaced, listeners get a full refresh */
+	void RecordGridReset() const;
+
+	void QueueTileChangesBroadcast() const;
+
+	void BroadcastTileChanges() const;
+
+	mutable FGridChangeJournal ChangeJournal;
+
+	mutable int64 LastBroadcastVersion = 0;
+
+	mutable bool bTileChangesBroadcastQueued = false;
+
+	// ***
+	// Deferred edits
+	// ***
+
+	/** Records through Record, committing what's pending first when the edit can't be folded into it */
+	void DeferTileEdit(TFunctionRef<bool()> Record) const;
+
+	void QueueTileEditsCommit() const;
+
+	mutable FGridEditBuffer TileEditBuffer;
+
+	mutable bool bTileEditsCommitQueued = false;
+
+	mutable FGridSpatialIndex SpatialIndex;
+
+	/** Backs the view GetGridTilesAtIndex returns for a column with an implicit Tile */
+	mutable FTileHeightTranslator ImplicitColumn;
+
+	UPROPERTY(Transient)
+	mutable TMap<FIntPoint, FGridChunkInstances> ChunkInstances;
+
+	/** Tiles each state was set on, may still hold Tiles that lost it since */
+	mutable TMap<ETileState, TSet<FIntVector>> TilesByState;
+
+	/** States of default Tiles, kept beside them so highlighting never stores a Tile */
+	mutable TMap<FIntVector, TArray<ETileState>> ImplicitTileStates;
+
+	/** See SetTilesOverlay */
+	mutable TMap<FIntVector, float> TileOverlay;
+
+	/** Default Tiles given an instance to show their states or overlay, they're still not stored */
+	mutable TSet<FIntVector> ImplicitInstances;
+
+	/** Scratch for FindInstancedTile */
+	mutable FGridTileData ImplicitInstanceTile;
+
+	// ***
+	// Units
+	// ***
+
+	/** Re-registers every UnitOnTile found in the Tiles */
+	void RebuildOccupancy() const;
+
+	void HandleOccupancyChanged(const FIntVector Index, AActor* Unit);
+
+	mutable FGridOccupancy Occupancy;
+
+	// ***
+	// Snapshots
+	// ***
+
+	mutable TSharedPtr<const FGridSnapshot> CachedSnapshot;
+
+	mutable TSet<FIntPoint> SnapshotDirtyChunks;
+
+	TSharedPtr<FGridChunkStore> ChunkStore;
+
+	TSharedPtr<FGridGenerationQueue> GenerationQueue;
+
+	TSharedPtr<FGridTerrainTracer> TerrainTracer;
+
+	TMap<FIntPoint, FGridChunkSummary> ChunkSummaries;
+
+	TSet<FIntPoint> LoadedChunks;
+
+	mutable TSet<FIntPoint> DirtyChunks;
+
+	TMap<FIntPoint, TFuture<TSharedPtr<TArray<FGridTileData>>>> PendingChunkLoads;
+
+	TMap<FIntPoint, TFuture<void>> PendingChunkSaves;
+
+	bool bChunkSummariesDirty = false;
 };
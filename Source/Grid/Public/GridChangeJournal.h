@@ -0,0 +1,117 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GridChangeJournal.generated.h"
+
+enum class EGridTileChange : uint8
+{
+	Added,
+	Removed,
+	Modified
+};
+
+struct FGridTileChange
+{
+	int64 Version = 0;
+
+	FIntVector Index = FIntVector::ZeroValue;
+
+	EGridTileChange Change = EGridTileChange::Modified;
+
+	/** Stands for every Tile of the chunk holding Index, changed together and not listed one by one */
+	bool bWholeChunk = false;
+};
+
+/**
+ * Every Tile change made during one frame, handed to listeners in a single event
+ */
+USTRUCT(BlueprintType)
+struct FGridTileChanges
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Category="Grid|Changes", VisibleAnywhere, BlueprintReadOnly)
+	int64 FromVersion = 0;
+
+	UPROPERTY(Category="Grid|Changes", VisibleAnywhere, BlueprintReadOnly)
+	int64 ToVersion = 0;
+
+	/** The journal can't describe this range anymore (cleared, regenerated or overflowed), rescan everything */
+	UPROPERTY(Category="Grid|Changes", VisibleAnywhere, BlueprintReadOnly)
+	bool bFullRefresh = false;
+
+	/** Each changed Tile once, empty on a full refresh */
+	UPROPERTY(Category="Grid|Changes", VisibleAnywhere, BlueprintReadOnly)
+	TArray<FIntVector> Tiles;
+
+	/** Column rects (max exclusive) of the chunks that changed as a whole, e.g. streamed in or out, their Tiles aren't in Tiles */
+	UPROPERTY(Category="Grid|Changes", VisibleAnywhere, BlueprintReadOnly)
+	TArray<FIntRect> Rects;
+};
+
+/**
+ * Versioned record of the Tile edits. The Grid version goes up by one per change, every chunk remembers
+ * the version of its last change and the latest changes are kept in a bounded ring buffer.
+ * Tile lists are only available while the ring still covers the asked range, dirty rects always are.
+ */
+class GRID_API FGridChangeJournal
+{
+public:
+	explicit FGridChangeJournal(const int32 InCapacity = 16384);
+
+	int64 Record(const FIntVector Index, const EGridTileChange Change);
+
+	/** One entry for a change of every Tile of the chunk, instead of one per Tile */
+	int64 RecordChunk(const FIntPoint Chunk, const EGridTileChange Change);
+
+	/** Forgets everything, any version from before can only be answered with a full refresh */
+	int64 Reset();
+
+	void SetCapacity(const int32 InCapacity);
+
+	int64 GetVersion() const { return Version; }
+
+	/** Version of the last change inside the chunk, 0 if it never changed since the last reset */
+	int64 GetChunkVersion(const FIntPoint Chunk) const { return ChunkVersions.FindRef(Chunk); }
+
+	/** True if the changes made after SinceVersion are all still in the ring buffer */
+	bool CanDescribeChangesSince(const int64 SinceVersion) const;
+
+	/** Changes made after SinceVersion, oldest first. False if they're not all available anymore */
+	bool GetChangesSince(const int64 SinceVersion, TArray<FGridTileChange>& OutChanges) const;
+
+	/** Each Tile changed after SinceVersion once, in order of first change. Chunks changed as a whole come out as their column rect */
+	bool GetChangedTilesSince(const int64 SinceVersion, TArray<FIntVector>& OutTiles, TArray<FIntRect>& OutRects) const;
+
+	bool GetDirtyChunksSince(const int64 SinceVersion, TArray<FIntPoint>& OutChunks) const;
+
+	/** Column rects (max exclusive) covering the chunks changed after SinceVersion, neighbouring chunks of a row are merged */
+	bool GetDirtyRectsSince(const int64 SinceVersion, TArray<FIntRect>& OutRects) const;
+
+private:
+	int64 Push(const FGridTileChange& Change);
+
+	template <typename FunctionType>
+	void ForEachChangeSince(const int64 SinceVersion, FunctionType&& Function) const;
+
+	TArray<FGridTileChange> Entries;
+
+	int32 Capacity = 0;
+
+	/** Slot the next change is written to */
+	int32 Head = 0;
+
+	int32 Count = 0;
+
+	int64 Version = 0;
+
+	/** Nothing at or before this version can be described anymore */
+	int64 ForgottenVersion = 0;
+
+	/** Version of the last reset, chunk versions can't describe anything before it */
+	int64 ResetVersion = 0;
+
+	TMap<FIntPoint, int64> ChunkVersions;
+};
@@ -0,0 +1,68 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GridTilesData.h"
+
+/**
+ * Chunks are square blocks of Tile columns, the Grid is streamed, summarised and batched per chunk
+ */
+struct GRID_API FGridChunk
+{
+	static constexpr int32 SizeLog2 = 5;
+	static constexpr int32 Size = 1 << SizeLog2;
+	static constexpr int32 ColumnCount = Size * Size;
+
+	/** Chunk coordinate containing the column, rounds down for negative indexes too */
+	static FIntPoint GetChunkCoord(const FIntPoint Index)
+	{
+		return FIntPoint(Index.X >> SizeLog2, Index.Y >> SizeLog2);
+	}
+
+	static FIntPoint GetChunkCoord(const FIntVector Index)
+	{
+		return GetChunkCoord(FIntPoint(Index.X, Index.Y));
+	}
+
+	/** First column index of the chunk */
+	static FIntPoint GetChunkOrigin(const FIntPoint Chunk)
+	{
+		return FIntPoint(Chunk.X << SizeLog2, Chunk.Y << SizeLog2);
+	}
+
+	/** Offset of the column inside its chunk, in [0, ColumnCount) */
+	static int32 GetColumnOffset(const FIntPoint Index)
+	{
+		return (Index.X & (Size - 1)) + ((Index.Y & (Size - 1)) << SizeLog2);
+	}
+};
+
+/**
+ * Coarse description of a chunk, always kept in memory so unloaded chunks can still be reasoned about
+ */
+struct GRID_API FGridChunkSummary
+{
+	int32 TileCount = 0;
+
+	int32 WalkableCount = 0;
+
+	int32 MinZ = 0;
+
+	int32 MaxZ = 0;
+
+	/** One bit per column, set when the column holds at least one walkable Tile */
+	uint64 WalkableColumns[FGridChunk::ColumnCount / 64] = {};
+
+	void AddTile(const FGridTileData& Tile);
+
+	bool IsColumnWalkable(const FIntPoint Index) const
+	{
+		const int32 Offset = FGridChunk::GetColumnOffset(Index);
+		return (WalkableColumns[Offset >> 6] & (1ull << (Offset & 63))) != 0;
+	}
+
+	static FGridChunkSummary Build(const TArray<FGridTileData>& Tiles);
+
+	friend FArchive& operator<<(FArchive& Ar, FGridChunkSummary& Summary);
+};
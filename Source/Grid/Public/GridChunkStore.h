@@ -0,0 +1,38 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GridChunk.h"
+
+/**
+ * On-disk backing store for streamed Grids, one file per chunk plus one file with every chunk summary.
+ * The store holds no mutable state, so chunks can be read and written from any thread.
+ */
+class GRID_API FGridChunkStore
+{
+public:
+	explicit FGridChunkStore(const FString& InDirectory);
+
+	const FString& GetDirectory() const { return Directory; }
+
+	bool SaveChunk(const FIntPoint Chunk, const TArray<FGridTileData>& Tiles) const;
+
+	bool LoadChunk(const FIntPoint Chunk, TArray<FGridTileData>& OutTiles) const;
+
+	bool SaveSummaries(const TMap<FIntPoint, FGridChunkSummary>& Summaries) const;
+
+	bool LoadSummaries(TMap<FIntPoint, FGridChunkSummary>& OutSummaries) const;
+
+	/** Deletes every chunk file of the store */
+	void Clear() const;
+
+	static void SerializeTile(FArchive& Ar, FGridTileData& Tile);
+
+private:
+	FString GetChunkPath(const FIntPoint Chunk) const;
+
+	FString GetSummariesPath() const;
+
+	FString Directory;
+};
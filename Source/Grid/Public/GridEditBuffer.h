@@ -0,0 +1,44 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GridTilesData.h"
+
+/**
+ * Tile edits recorded while a Grid defers them, folded so each Tile has at most one pending edit:
+ * the last add wins, an add then remove of a Tile that wasn't there cancels out, and moving the same Tile again adds up.
+ * An edit that can't be folded into the pending ones is refused, the Grid commits what's pending and records it again.
+ */
+class GRID_API FGridEditBuffer
+{
+public:
+	bool RecordAdd(const FGridTileData& Data);
+
+	/** bStored, whether the Grid holds a Tile at Index right now */
+	bool RecordRemove(const FIntVector Index, const bool bStored);
+
+	/** bStored, whether the Grid holds a Tile at Index right now, a pending move landing there would replace it */
+	bool RecordMove(const FIntVector Index, const int32 MoveAmount, const bool bStored);
+
+	bool IsEmpty() const { return Added.IsEmpty() && Removed.IsEmpty() && Moved.IsEmpty(); }
+
+	int32 Num() const { return Added.Num() + Removed.Num() + Moved.Num(); }
+
+	void Reset();
+
+	/** Tiles to add or replace */
+	TMap<FIntVector, FGridTileData> Added;
+
+	TSet<FIntVector> Removed;
+
+	/** Move amount of each moving Tile, by the Index it moves from */
+	TMap<FIntVector, int32> Moved;
+
+private:
+	/** Touched by a pending move, as its source or its target */
+	bool IsMoving(const FIntVector Index) const { return Moved.Contains(Index) || MoveTargets.Contains(Index); }
+
+	/** Where each pending move lands, to the Index it moves from */
+	TMap<FIntVector, FIntVector> MoveTargets;
+};
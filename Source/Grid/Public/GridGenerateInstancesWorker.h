@@ -3,15 +3,43 @@
 #pragma once
 
 #include "CoreMinimal.h"
-#include "GridRunnable.h"
+#include "Containers/Queue.h"
+#include <atomic>
+#include "GridJobScheduler.h"
 #include "GridTilesData.h"
+#include "GridChunk.h"
+#include "GridTerrain.h"
 
+class FGridChunkStore;
 
-class GRID_API FGridGenerateInstancesWorker : public FGridRunnable
+/** Generated chunk on its way to the Grid Actor */
+struct FGridGeneratedChunk
+{
+	FIntPoint Chunk = FIntPoint::ZeroValue;
+
+	TArray<FGridTileData> Tiles;
+};
+
+/**
+ * Chunks handed over from the generation worker to the Grid Actor in Morton order, drained under a frame budget.
+ * Shared by both sides so the worker can outlive a Grid that stopped listening.
+ */
+struct FGridGenerationQueue
+{
+	TQueue<FGridGeneratedChunk, EQueueMode::Spsc> Chunks;
+
+	/** Set by the worker once the last chunk is queued, or when it was cancelled */
+	std::atomic<bool> bComplete = false;
+};
+
+/**
+ * Builds a Grid's Tiles, run as a job of the Grid job scheduler. Depending on the mode the result goes
+ * into the chunk store, into the generation queue, or stays here until the Grid Actor takes it.
+ */
+class GRID_API FGridGenerateInstancesWorker
 {
 public:
 	FGridGenerateInstancesWorker(
-		UObject* InWorldContext,
 		FVector CenterLocation,
 		FVector TileSize,
 		FIntPoint TileCount,
@@ -19,28 +47,50 @@ public:
 		bool bFastGen
 	);
 
-	virtual ~FGridGenerateInstancesWorker() override;
+	/** Job body, polls the job for cancellation and reports progress on it */
+	bool Run(FGridJob& Job);
 
-	bool Init() override;
-	void RefreshResult();
-	uint32 Run() override;
+	/** Moves the generated Tiles out, for the Game Thread step that hands them to the Grid Actor */
+	FGridTilesPayload TakePayload();
 
-	void FillData(FGridTileData Data);
 	TMap<FIntVector, FGridTileData> GridTiles;
 	TArray<FIntVector> InstanceIndexes;
 	TMap<FIntPoint, FTileHeightTranslator> TileHeightTranslator;
 	TArray<FTransform> Transforms;
 
+	/** Summaries of the chunks written to the chunk store */
+	TMap<FIntPoint, FGridChunkSummary> ChunkSummaries;
+
 	FVector GetTileLocationFromGridIndex(const FIntVector Index) const;
 	FVector GetTileScale() const;
 
-	TObjectPtr<UObject> WorldContext = nullptr;
-
 	FVector GridCenterLocation;
 	FVector GridTileSize;
 	FIntPoint GridTileCount;
 	FVector GridBottomLeftCorner;
 	bool bGridFastGen;
 
-	void Stop() override;
+	/** Shape the Tiles from the terrain noise instead of laying them flat */
+	bool bTerrain = false;
+	FGridTerrainSettings TerrainSettings;
+
+	/** When set, the Grid is written chunk by chunk into the store instead of being handed to the Grid Actor */
+	TSharedPtr<FGridChunkStore> ChunkStore;
+
+	/** When set, chunks are queued as they're generated instead of handing the whole Grid over at the end */
+	TSharedPtr<FGridGenerationQueue> GenerationQueue;
+
+private:
+	bool GenerateToChunkStore(FGridJob& Job);
+
+	bool GenerateToQueue(FGridJob& Job);
+
+	/** Chunks holding at least one generated Tile, in Morton order */
+	void GetGeneratedChunks(TArray<FIntPoint>& OutChunks) const;
+
+	/** Tiles of one chunk in Morton order, safe to call from several threads at once */
+	void BuildChunkTiles(const FIntPoint Chunk, TArray<FGridTileData>& OutTiles) const;
+
+	/** Last Index generated on each axis, border generation goes up to and including TileCount */
+	FIntPoint GetLastIndex() const { return bGridFastGen ? GridTileCount : GridTileCount - FIntPoint(1, 1); }
 };
@@ -0,0 +1,74 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GridChunk.h"
+#include "GridJobScheduler.h"
+#include "GridImporter.generated.h"
+
+class FGridChunkStore;
+
+/**
+ * Files a Grid is imported from, at least one of them must be set. Both are read one row at a time,
+ * row 0 is Y 0 and column 0 is X 0.
+ */
+USTRUCT(BlueprintType)
+struct FGridImportSettings
+{
+	GENERATED_BODY()
+
+	/** 8 or 16 bit PNG, or 16 bit little endian RAW. Gives the Grid size and the height of each column */
+	UPROPERTY(Category="Grid|Import", EditAnywhere, BlueprintReadWrite)
+	FString HeightmapFile;
+
+	/** Size of a RAW heightmap, RAW files have no header. Zero for a square heightmap */
+	UPROPERTY(Category="Grid|Import", EditAnywhere, BlueprintReadWrite)
+	FIntPoint RawSize = FIntPoint::ZeroValue;
+
+	/** Height of the brightest heightmap value, in Tile steps */
+	UPROPERTY(Category="Grid|Import", EditAnywhere, BlueprintReadWrite, meta=(ClampMin=0))
+	int32 MaxHeight = 8;
+
+	/**
+	 * CSV, or TSV for .tsv and .txt files, one Tile type per cell as a name (Normal, Obstacle, FlyingOnly, None) or a number.
+	 * Empty cells are Normal, None leaves the column without a Tile. Gives the Grid size when there's no heightmap.
+	 */
+	UPROPERTY(Category="Grid|Import", EditAnywhere, BlueprintReadWrite)
+	FString TypeMapFile;
+};
+
+/**
+ * Streams heightmaps and type maps into a chunk store, a band of chunk rows at a time, so the decoded
+ * files are never held in memory as a whole. Run as a job of the Grid job scheduler, or directly from a commandlet.
+ */
+class GRID_API FGridImporter
+{
+public:
+	FGridImporter(const FGridImportSettings& InSettings, const FVector& InCenterLocation, const FVector& InTileSize, const TSharedRef<FGridChunkStore>& InChunkStore);
+
+	/** Job body, polls the job for cancellation and reports progress on it */
+	bool Run(FGridJob& Job);
+
+	/** Size in Tiles of the imported Grid, set once Run has read the file headers */
+	FIntPoint GetGridSize() const { return GridSize; }
+
+	/** Why Run failed */
+	const FString& GetError() const { return Error; }
+
+	/** Summaries of the chunks written to the chunk store */
+	TMap<FIntPoint, FGridChunkSummary> ChunkSummaries;
+
+private:
+	FGridImportSettings Settings;
+
+	FVector CenterLocation;
+
+	FVector TileSize;
+
+	TSharedRef<FGridChunkStore> ChunkStore;
+
+	FIntPoint GridSize = FIntPoint::ZeroValue;
+
+	FString Error;
+};
@@ -0,0 +1,99 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Tasks/Task.h"
+#include <atomic>
+
+enum class EGridJobStatus : uint8
+{
+	Pending,
+	Running,
+	Succeeded,
+	Failed,
+	Cancelled
+};
+
+/**
+ * State of one job, shared between the work itself, its handles and the jobs depending on it.
+ * The work polls IsCancelled and reports its progress, everything here is safe from any thread.
+ */
+class GRID_API FGridJob
+{
+public:
+	explicit FGridJob(const TCHAR* InName);
+
+	const FString& GetName() const { return Name; }
+
+	/** Cooperative, the work decides when to stop */
+	bool IsCancelled() const { return bCancelRequested.load(std::memory_order_relaxed); }
+
+	void Cancel() { bCancelRequested.store(true, std::memory_order_relaxed); }
+
+	/** 0 to 1 */
+	void SetProgress(const float InProgress) { Progress.store(FMath::Clamp(InProgress, 0.0f, 1.0f), std::memory_order_relaxed); }
+
+	float GetProgress() const { return Progress.load(std::memory_order_relaxed); }
+
+	EGridJobStatus GetStatus() const { return Status.load(std::memory_order_acquire); }
+
+	bool IsComplete() const { return GetStatus() > EGridJobStatus::Running; }
+
+private:
+	friend class FGridJobScheduler;
+	friend struct FGridJobHandle;
+
+	FString Name;
+
+	std::atomic<bool> bCancelRequested = false;
+
+	std::atomic<float> Progress = 0.0f;
+
+	std::atomic<EGridJobStatus> Status = EGridJobStatus::Pending;
+
+	/** Triggered once the job is complete whatever the outcome, what dependent jobs wait on */
+	UE::Tasks::FTaskEvent Completed;
+};
+
+/** Returns false when the job failed */
+using FGridJobFunction = TUniqueFunction<bool(FGridJob& Job)>;
+
+/**
+ * What callers hold on to, an empty handle behaves like a job that never ran
+ */
+struct GRID_API FGridJobHandle
+{
+	TSharedPtr<FGridJob> Job;
+
+	bool IsValid() const { return Job.IsValid(); }
+
+	void Cancel() const;
+
+	EGridJobStatus GetStatus() const;
+
+	bool IsComplete() const;
+
+	float GetProgress() const;
+
+	/** Blocks until the job is complete. Never wait on a Game Thread job from the Game Thread */
+	void Wait() const;
+};
+
+/**
+ * Runs Grid work on the engine task system, its worker threads are shared and reused instead of one thread per call.
+ * A job starts once all its prerequisites are complete, and is cancelled without running if any of them didn't succeed.
+ */
+class GRID_API FGridJobScheduler
+{
+public:
+	static FGridJobHandle Launch(const TCHAR* Name, FGridJobFunction&& Work, TConstArrayView<FGridJobHandle> Prerequisites = {});
+
+	/** Same, with the work running on the Game Thread, for steps that touch the Grid Actor or its components */
+	static FGridJobHandle LaunchOnGameThread(const TCHAR* Name, FGridJobFunction&& Work, TConstArrayView<FGridJobHandle> Prerequisites = {});
+
+private:
+	static FGridJobHandle Launch(const TCHAR* Name, FGridJobFunction&& Work, TConstArrayView<FGridJobHandle> Prerequisites, const bool bGameThread);
+
+	static void Execute(FGridJob& Job, FGridJobFunction& Work, TConstArrayView<TSharedPtr<FGridJob>> Prerequisites);
+};
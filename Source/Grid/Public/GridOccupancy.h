@@ -0,0 +1,85 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectKey.h"
+#include "GridChunk.h"
+
+/** Tile whose unit changed, and the unit now on it (null when freed) */
+DECLARE_MULTICAST_DELEGATE_TwoParams(FOnGridOccupancyChanged, const FIntVector /*Index*/, AActor* /*Unit*/);
+
+/**
+ * Which unit stands on which Tile, looked up both ways in O(1), with a per-chunk column bitset
+ * so neighbourhood checks can reject empty columns without hashing.
+ * Knows nothing about the Tiles themselves, the Grid Actor validates Tiles and mirrors the result in UnitOnTile.
+ */
+class GRID_API FGridOccupancy
+{
+public:
+	/** Puts the unit on a free Tile, taking it off its previous Tile if it had one */
+	bool Place(AActor* Unit, const FIntVector Index);
+
+	/** Moves a placed unit to a free Tile, both Tiles are updated before anyone is notified */
+	bool Move(AActor* Unit, const FIntVector To);
+
+	/** Frees the Tile, returns the unit that was on it */
+	AActor* RemoveAt(const FIntVector Index);
+
+	bool RemoveUnit(const AActor* Unit);
+
+	void Reset();
+
+	AActor* GetUnitAt(const FIntVector Index) const;
+
+	bool FindUnitTile(const AActor* Unit, FIntVector& OutIndex) const;
+
+	bool IsOccupied(const FIntVector Index) const;
+
+	/** True if any Tile of the column holds a unit, a bit test */
+	bool IsColumnOccupied(const FIntPoint Column) const;
+
+	/** Units standing in the neighbouring columns, at most MaxHeightDifference Tiles above or below Index */
+	int32 GetAdjacentUnits(const FIntVector Index, const bool bIncludeDiagonals, const int32 MaxHeightDifference, TArray<AActor*>& OutUnits) const;
+
+	int32 Num() const { return UnitToTile.Num(); }
+
+	/** Calls Function(Index) for every Tile holding a unit */
+	template <typename FunctionType>
+	void ForEachOccupiedTile(FunctionType&& Function) const
+	{
+		for (const TPair<FIntVector, FOccupant>& Pair : TileToUnit)
+		{
+			Function(Pair.Key);
+		}
+	}
+
+	FOnGridOccupancyChanged OnOccupancyChanged;
+
+private:
+	void Link(AActor* Unit, const FIntVector Index);
+
+	void Unlink(const FIntVector Index);
+
+	struct FChunkBits
+	{
+		uint64 Columns[FGridChunk::ColumnCount / 64] = {};
+	};
+
+	struct FOccupant
+	{
+		TWeakObjectPtr<AActor> Unit;
+
+		/** Still identifies the unit once it's destroyed, so the reverse entry can go too */
+		TObjectKey<AActor> Key;
+	};
+
+	TMap<FIntVector, FOccupant> TileToUnit;
+
+	TMap<TObjectKey<AActor>, FIntVector> UnitToTile;
+
+	TMap<FIntPoint, FChunkBits> ChunkBits;
+
+	/** Units per column, only to know when a column bit can be cleared */
+	TMap<FIntPoint, int32> ColumnUnitCounts;
+};
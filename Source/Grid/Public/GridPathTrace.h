@@ -0,0 +1,69 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GridPathTrace.generated.h"
+
+UENUM(BlueprintType)
+enum class EGridPathTraceEvent : uint8
+{
+	Discovered	UMETA(DisplayName="Discovered"),
+	Analyzed	UMETA(DisplayName="Analyzed"),
+	Path		UMETA(DisplayName="Path")
+};
+
+/**
+ * One step of a pathfinding search
+ */
+USTRUCT(BlueprintType)
+struct FGridPathTraceRecord
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Category="Pathfinding|Debug", VisibleAnywhere, BlueprintReadOnly)
+	FIntVector Index{0, 0, 0};
+
+	UPROPERTY(Category="Pathfinding|Debug", VisibleAnywhere, BlueprintReadOnly)
+	EGridPathTraceEvent Event = EGridPathTraceEvent::Discovered;
+
+	/** Cost from the start when the event happened */
+	UPROPERTY(Category="Pathfinding|Debug", VisibleAnywhere, BlueprintReadOnly)
+	int32 Cost = 0;
+};
+
+/**
+ * Fixed size ring buffer of search steps, recording never allocates once the buffer is full,
+ * the oldest records are overwritten instead
+ */
+class GRID_API FGridPathTraceRecorder
+{
+public:
+	/** Drops the records */
+	void SetCapacity(const int32 InCapacity);
+
+	int32 GetCapacity() const { return Capacity; }
+
+	void Record(const FIntVector Index, const EGridPathTraceEvent Event, const int32 Cost);
+
+	void Reset();
+
+	/** Records still in the buffer */
+	int32 Num() const { return Records.Num(); }
+
+	/** Records since the last reset, overwritten ones included */
+	int64 GetTotalRecorded() const { return TotalRecorded; }
+
+	/** Oldest first */
+	void GetRecords(TArray<FGridPathTraceRecord>& OutRecords) const;
+
+private:
+	TArray<FGridPathTraceRecord> Records;
+
+	int32 Capacity = 4096;
+
+	/** Slot the next record goes to once the buffer is full */
+	int32 Next = 0;
+
+	int64 TotalRecorded = 0;
+};
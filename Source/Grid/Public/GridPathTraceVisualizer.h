@@ -0,0 +1,62 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GridPathTrace.h"
+#include "GameFramework/Actor.h"
+#include "GridPathTraceVisualizer.generated.h"
+
+class AGridPathfinding;
+
+/**
+ * Replays the trace of the last search of a pathfinding actor over its Grid, step by step.
+ * Steps are drawn as the Grid's instance overlay holding the matching ETileState value, the Tiles themselves are left alone
+ */
+UCLASS()
+class GRID_API AGridPathTraceVisualizer : public AActor
+{
+	GENERATED_BODY()
+
+public:
+	// Sets default values for this actor's properties
+	AGridPathTraceVisualizer();
+
+	// Called every frame
+	virtual void Tick(float DeltaTime) override;
+
+	virtual bool ShouldTickIfViewportsOnly() const override;
+
+	UPROPERTY(Category="Pathfinding|Debug", EditAnywhere, BlueprintReadWrite)
+	TObjectPtr<AGridPathfinding> Pathfinding;
+
+	UPROPERTY(Category="Pathfinding|Debug", EditAnywhere, BlueprintReadWrite, meta=(ClampMin=1))
+	float StepsPerSecond = 60.0f;
+
+	/** Starts over once the replay is done */
+	UPROPERTY(Category="Pathfinding|Debug", EditAnywhere, BlueprintReadWrite)
+	bool bLoop = false;
+
+	/** Takes the current trace of Pathfinding and replays it from the start */
+	UFUNCTION(Category="Pathfinding|Debug", BlueprintCallable, CallInEditor)
+	void Replay();
+
+	/** Stops the replay and clears the overlay it drew */
+	UFUNCTION(Category="Pathfinding|Debug", BlueprintCallable, CallInEditor)
+	void Stop();
+
+	UFUNCTION(Category="Pathfinding|Debug", BlueprintCallable, BlueprintPure)
+	bool IsReplaying() const { return bReplaying; }
+
+private:
+	void ClearOverlay() const;
+
+	/** Copied when the replay starts, searches running meanwhile don't change it */
+	TArray<FGridPathTraceRecord> Records;
+
+	int32 Position = 0;
+
+	float Elapsed = 0.0f;
+
+	bool bReplaying = false;
+};
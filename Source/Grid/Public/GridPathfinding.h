@@ -4,11 +4,11 @@
 
 #include "CoreMinimal.h"
 #include "GridTilesData.h"
+#include "GridTileKey.h"
+#include "GridPathTrace.h"
 
 #include "GridPathfinding.generated.h"
 
-DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnPathfindingDataUpdatedSignature, FIntVector, Index);
-
 DECLARE_DYNAMIC_MULTICAST_DELEGATE(FOnPathfindingDataClearedSignature);
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnPathfindingCompletedSignature, TArray<FIntVector>, Path);
@@ -35,6 +35,27 @@ struct FPathfindingData
 };
 
 class AGridActor;
+class FGridSnapshot;
+
+/**
+ * Inputs of a pathfinding request, same meaning as the AGridPathfinding properties
+ */
+struct GRID_API FGridPathQuery
+{
+	FIntVector Start{0, 0, 0};
+
+	FIntVector Target{0, 0, 0};
+
+	bool bIncludeDiagonals = false;
+
+	TArray<ETileType> ValidTileTypes;
+
+	bool bReturnReachableTiles = false;
+
+	int32 MaxPathLength = 1;
+
+	float HeightReachMult = 4.0f;
+};
 
 UCLASS()
 class GRID_API AGridPathfinding : public AActor
@@ -57,9 +78,6 @@ public:
 	// Delegates
 	// ***
 
-	UPROPERTY(BlueprintAssignable)
-	FOnPathfindingDataUpdatedSignature OnPathfindingDataUpdated;
-
 	UPROPERTY(BlueprintAssignable)
 	FOnPathfindingDataClearedSignature OnPathfindingDataCleared;
 
@@ -94,6 +112,15 @@ public:
 	UPROPERTY(Category="Pathfinding", EditAnywhere, BlueprintReadWrite)
 	float HeightReachMult = 4.0f;
 
+	/** Records the steps of each search for AGridPathTraceVisualizer. Does nothing in shipping builds */
+	UPROPERTY(Category="Pathfinding|Debug", EditAnywhere, BlueprintReadWrite)
+	bool bRecordTrace = false;
+
+	/** Records kept per search, a longer search keeps its last steps */
+	UPROPERTY(Category="Pathfinding|Debug", EditAnywhere, BlueprintReadWrite, meta=(EditCondition="bRecordTrace", ClampMin=1))
+	int32 TraceCapacity = 4096;
+
+	/** Steps through streamed out chunks come from their summaries at the height the path entered them, nothing is loaded */
 	UFUNCTION(Category="Pathfinding|Generation", BlueprintCallable)
 	TArray<FIntVector> FindPath(const FIntVector Start, const FIntVector Target, const bool Diagonals,
 	                            const TArray<ETileType> TileTypes, const bool ReturnReachableTiles,
@@ -142,18 +169,59 @@ public:
 	UFUNCTION(Category="Pathfinding|Utilities", BlueprintCallable, BlueprintPure)
 	int32 GetPathCost(TArray<FIntVector> Path);
 
-private:
-	TArray<FIntVector> DiscoveredTilesIndexes;
+	/** Steps of the last search, oldest first. Empty unless bRecordTrace is set */
+	UFUNCTION(Category="Pathfinding|Debug", BlueprintCallable)
+	void GetTraceRecords(TArray<FGridPathTraceRecord>& OutRecords) const;
 
-	TArray<int32> DiscoveredTileSortingCosts;
+	// ***
+	// Snapshots
+	// ***
+
+	/**
+	 * Same search as FindPath but over a Grid snapshot, without any actor state or delegates.
+	 * Safe to run from worker threads, many at once.
+	 */
+	static TArray<FIntVector> FindPathInSnapshot(const FGridSnapshot& Snapshot, const FGridPathQuery& Query);
+
+	static int32 GetPathCostInSnapshot(const FGridSnapshot& Snapshot, const TArray<FIntVector>& Path);
+
+private:
+	/** Compiled out of shipping builds with the recorder */
+	void RecordTrace(const FIntVector Index, const EGridPathTraceEvent Event, const int32 Cost)
+	{
+#if WITH_GRID_PATH_TRACE
+		if (bRecordTrace)
+		{
+			Trace.Record(Index, Event, Cost);
+		}
+#endif
+	}
+
+#if WITH_GRID_PATH_TRACE
+	FGridPathTraceRecorder Trace;
+#endif
+
+	struct FDiscoveredTile
+	{
+		int32 SortingCost;
+		int32 Order;
+		FIntVector Index;
+	};
+
+	/** Heap, cheapest first. A Tile rediscovered cheaper leaves its old entry behind, skipped once it comes up */
+	TArray<FDiscoveredTile> DiscoveredTiles;
+
+	int32 DiscoveredCount = 0;
 
 	TArray<FIntVector> AnalyzedTileIndexes;
 
+	TSet<FGridTileKey> AnalyzedTiles;
+
 	FPathfindingData CurrentDiscoveredTile;
 
 	TArray<FPathfindingData> CurrentNeighbours;
 
-	TMap<FIntVector, FPathfindingData> PathfindingData;
+	TMap<FGridTileKey, FPathfindingData> PathfindingData;
 
 	FPathfindingData CurrentNeighbour;
 };
@@ -0,0 +1,30 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GridTilesData.h"
+
+/**
+ * Offsets of each pattern around the zero Index, built once per pattern, range and direction without duplicates.
+ * Stamping a cached pattern is a walk over its offsets, nothing gets allocated.
+ * Only the MaxStencils most recently used stencils are kept, a stencil dropped from the cache lives on while
+ * something still holds it. Safe from any thread.
+ */
+class GRID_API FGridPatternCache
+{
+public:
+	static constexpr int32 MaxStencils = 128;
+
+	/** Ranges are clamped to it, a Circle that size is already ~50k offsets */
+	static constexpr int32 MaxRange = 128;
+
+	/**
+	 * Direction is a column offset, only Cone (snapped to the closest of 8 directions) and LineToTarget use it.
+	 * Range X to Y is the distance span covered, in rings of Tiles around the zero Index
+	 */
+	static TSharedRef<const TArray<FIntVector>> GetStencil(const EGridPattern Pattern, const FIntPoint Range, const FIntPoint Direction = FIntPoint(1, 0));
+
+	/** Stencils in the cache */
+	static int32 Num();
+};
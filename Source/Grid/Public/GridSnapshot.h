@@ -0,0 +1,156 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GridTilesData.h"
+#include "GridChunk.h"
+
+class AGridActor;
+
+/**
+ * Tiles of one chunk inside a snapshot. Shared between snapshots and never edited while shared.
+ */
+struct GRID_API FGridSnapshotChunk
+{
+	/** Stored Tiles, and the default Tiles holding a unit or states */
+	TMap<FIntVector, FGridTileData> Tiles;
+
+	TMap<FIntPoint, FTileHeightTranslator> TileHeightTranslator;
+
+	/** One bit per column holding a bare default Tile at Z 0, synthesized when read instead of stored */
+	uint64 ImplicitColumns[FGridChunk::ColumnCount / 64] = {};
+
+	bool IsColumnImplicit(const FIntPoint Column) const
+	{
+		const int32 Offset = FGridChunk::GetColumnOffset(Column);
+		return (ImplicitColumns[Offset >> 6] & (1ull << (Offset & 63))) != 0;
+	}
+
+	void SetColumnImplicit(const FIntPoint Column, const bool bImplicit)
+	{
+		const int32 Offset = FGridChunk::GetColumnOffset(Column);
+		if (bImplicit)
+		{
+			ImplicitColumns[Offset >> 6] |= 1ull << (Offset & 63);
+		}
+		else
+		{
+			ImplicitColumns[Offset >> 6] &= ~(1ull << (Offset & 63));
+		}
+	}
+
+	/** Stored and default Tiles */
+	int32 Num() const;
+};
+
+/**
+ * Value type copy of the Grid Tiles that doesn't touch the Grid Actor, meant for AI lookahead and simulation.
+ * Chunks are shared copy-on-write: forking only copies the chunk table and an edit only copies the chunk it touches.
+ * Default Tiles of an implicit Grid are a bit per column, like on the Grid Actor they cost no storage.
+ * A snapshot can be read from any number of threads, edits need the usual exclusive access to that one snapshot.
+ */
+class GRID_API FGridSnapshot
+{
+public:
+	FGridSnapshot() = default;
+
+	/** Builds a snapshot of the whole Grid, Game Thread only */
+	static FGridSnapshot Capture(const AGridActor& Grid);
+
+	/** Copies the current Tiles of one chunk of the Grid, Game Thread only */
+	static TSharedPtr<FGridSnapshotChunk> CaptureChunk(const AGridActor& Grid, const FIntPoint Chunk);
+
+	/** Cheap copy sharing every chunk with this snapshot */
+	FGridSnapshot Fork() const { return *this; }
+
+	// ***
+	// Queries
+	// ***
+
+	/** A default Tile is synthesized, it stays valid until the next FindTile call on the same thread */
+	const FGridTileData* FindTile(const FIntVector Index) const;
+
+	bool IsIndexValid(const FIntVector Index) const { return FindTile(Index) != nullptr; }
+
+	bool IsWithinBounds(const FIntVector Index) const;
+
+	bool IsTileWalkable(const FIntVector Index) const;
+
+	/** For a column with a default Tile the view stays valid until the next call on the same thread */
+	TArrayView<const FIntVector> GetGridTilesAtIndex(const FIntPoint Index) const;
+
+	FVector GetTileLocationFromGridIndex(const FIntVector Index) const;
+
+	FVector GetTileScale() const { return GridTileSize / 100.f; }
+
+	const FVector& GetTileSize() const { return GridTileSize; }
+
+	const FIntPoint& GetGridTileCount() const { return GridTileCount; }
+
+	/** False for chunks without a single Tile */
+	bool HasChunk(const FIntPoint Chunk) const { return Chunks.Contains(Chunk); }
+
+	int32 Num() const { return TileCount; }
+
+	/** Default Tiles are synthesized one at a time on the way */
+	template <typename FunctionType>
+	void ForEachTile(FunctionType&& Function) const
+	{
+		for (const TPair<FIntPoint, TSharedPtr<FGridSnapshotChunk>>& Chunk : Chunks)
+		{
+			for (const TPair<FIntVector, FGridTileData>& Pair : Chunk.Value->Tiles)
+			{
+				Function(Pair.Value);
+			}
+
+			const FIntPoint Origin = FGridChunk::GetChunkOrigin(Chunk.Key);
+			for (int32 y = 0; y < FGridChunk::Size; ++y)
+			{
+				for (int32 x = 0; x < FGridChunk::Size; ++x)
+				{
+					if (Chunk.Value->IsColumnImplicit(Origin + FIntPoint(x, y)))
+					{
+						Function(MakeImplicitTile(FIntVector(Origin.X + x, Origin.Y + y, 0)));
+					}
+				}
+			}
+		}
+	}
+
+	// ***
+	// Edits, copy-on-write per chunk
+	// ***
+
+	void SetTile(const FGridTileData& Data);
+
+	bool RemoveTile(const FIntVector Index);
+
+	bool MoveTile(const FIntVector Index, const int32 MoveAmount);
+
+	bool MoveUnit(const FIntVector From, const FIntVector To);
+
+	/** Mutable access to a Tile, copies its chunk first if it's shared */
+	FGridTileData* FindTileMutable(const FIntVector Index);
+
+	/** Replaces a whole chunk, used to refresh a snapshot from the Grid Actor */
+	void SetChunk(const FIntPoint Chunk, TSharedPtr<FGridSnapshotChunk> Data);
+
+	bool SharesChunkWith(const FGridSnapshot& Other, const FIntPoint Chunk) const;
+
+private:
+	FGridSnapshotChunk& GetMutableChunk(const FIntPoint Chunk);
+
+	/** Same default as AGridActor::MakeImplicitTile, without unit or states */
+	FGridTileData MakeImplicitTile(const FIntVector Index) const;
+
+	TMap<FIntPoint, TSharedPtr<FGridSnapshotChunk>> Chunks;
+
+	int32 TileCount = 0;
+
+	FVector GridTileSize = FVector::ZeroVector;
+
+	FIntPoint GridTileCount = FIntPoint::ZeroValue;
+
+	FVector GridBottomLeftCorner = FVector::ZeroVector;
+};
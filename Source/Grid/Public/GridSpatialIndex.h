@@ -0,0 +1,123 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GridTilesData.h"
+#include "GridChunk.h"
+#include "GridSpatialIndex.generated.h"
+
+class AGridActor;
+class FGridSnapshot;
+
+/**
+ * Which Tiles a spatial query returns, every condition has to hold
+ */
+USTRUCT(BlueprintType)
+struct FGridTileQueryFilter
+{
+	GENERATED_BODY()
+
+	/** Accepted Tile types, any type when empty */
+	UPROPERTY(Category="Grid|Queries", EditAnywhere, BlueprintReadWrite)
+	TArray<ETileType> Types;
+
+	/** States the Tile must all have */
+	UPROPERTY(Category="Grid|Queries", EditAnywhere, BlueprintReadWrite)
+	TArray<ETileState> RequiredStates;
+
+	/** States the Tile must have none of */
+	UPROPERTY(Category="Grid|Queries", EditAnywhere, BlueprintReadWrite)
+	TArray<ETileState> ExcludedStates;
+
+	UPROPERTY(Category="Grid|Queries", EditAnywhere, BlueprintReadWrite)
+	bool bWalkableOnly = false;
+
+	/** Skip Tiles with a unit on them */
+	UPROPERTY(Category="Grid|Queries", EditAnywhere, BlueprintReadWrite)
+	bool bExcludeOccupied = false;
+};
+
+/**
+ * Filter flattened to bit masks, one bit per Tile type and per Tile state
+ */
+struct GRID_API FGridTileFilterMask
+{
+	uint8 Types = 0xFF;
+
+	uint32 RequiredStates = 0;
+
+	uint32 ExcludedStates = 0;
+
+	bool bExcludeOccupied = false;
+
+	static FGridTileFilterMask Make(const FGridTileQueryFilter& Filter);
+
+	static uint8 GetTypeBit(const ETileType Type) { return 1 << static_cast<uint8>(Type); }
+
+	static uint32 GetStateBit(const ETileState State) { return 1u << static_cast<uint8>(State); }
+
+	bool Matches(const FGridTileData& Tile) const;
+};
+
+/**
+ * What the spatial queries know about one chunk of the Tiles in memory
+ */
+struct GRID_API FGridChunkTileIndex
+{
+	static constexpr int32 TypeCount = static_cast<int32>(ETileType::FlyingOnly) + 1;
+
+	/** Chunk version from the change journal this was built at */
+	int64 Version = -1;
+
+	int32 TileCount = 0;
+
+	int32 TypeCounts[TypeCount] = {};
+
+	/** One bit per column, set when the column holds at least one Tile */
+	uint64 OccupiedColumns[FGridChunk::ColumnCount / 64] = {};
+
+	bool HasAnyType(const uint8 TypeMask) const;
+
+	bool IsColumnOccupied(const int32 ColumnOffset) const
+	{
+		return (OccupiedColumns[ColumnOffset >> 6] & (1ull << (ColumnOffset & 63))) != 0;
+	}
+};
+
+/**
+ * Chunk level index over the Tiles of a Grid Actor used to skip empty or unmatched regions in range queries.
+ * Chunks are rebuilt lazily when the change journal reports a newer version for them. Game Thread only.
+ * Result buffers are reset and filled, their allocation is kept between calls.
+ */
+class GRID_API FGridSpatialIndex
+{
+public:
+	void Reset() { Chunks.Empty(); }
+
+	/** Tiles whose column lies in the rect, Min and Max included */
+	int32 QueryRect(const AGridActor& Grid, const FIntPoint Min, const FIntPoint Max, const FGridTileFilterMask& Filter, TArray<FIntVector>& OutTiles);
+
+	/** Tiles whose column lies within Radius columns of Center */
+	int32 QueryRadius(const AGridActor& Grid, const FIntPoint Center, const float Radius, const FGridTileFilterMask& Filter, TArray<FIntVector>& OutTiles);
+
+	/** Up to Count Tiles closest to Origin by column distance then height, nearest first, searching up to MaxRadius columns away */
+	int32 QueryNearest(const AGridActor& Grid, const FIntVector Origin, const int32 Count, const int32 MaxRadius, const FGridTileFilterMask& Filter, TArray<FIntVector>& OutTiles);
+
+	// ***
+	// Same queries over a snapshot, its chunk table stands in for the chunk index. Safe from any thread
+	// ***
+
+	static int32 QueryRect(const FGridSnapshot& Snapshot, const FIntPoint Min, const FIntPoint Max, const FGridTileFilterMask& Filter, TArray<FIntVector>& OutTiles);
+
+	static int32 QueryRadius(const FGridSnapshot& Snapshot, const FIntPoint Center, const float Radius, const FGridTileFilterMask& Filter, TArray<FIntVector>& OutTiles);
+
+	static int32 QueryNearest(const FGridSnapshot& Snapshot, const FIntVector Origin, const int32 Count, const int32 MaxRadius, const FGridTileFilterMask& Filter, TArray<FIntVector>& OutTiles);
+
+	const FGridChunkTileIndex& GetChunk(const AGridActor& Grid, const FIntPoint Chunk);
+
+private:
+	void BuildChunk(const AGridActor& Grid, const FIntPoint Chunk, FGridChunkTileIndex& OutIndex) const;
+
+	TMap<FIntPoint, FGridChunkTileIndex> Chunks;
+};
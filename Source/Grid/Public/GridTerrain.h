@@ -0,0 +1,73 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GridTilesData.h"
+#include "GridTerrain.generated.h"
+
+/**
+ * How terrain Grids are shaped, heights come from fractal noise and are quantized to GridTileSize.Z steps
+ */
+USTRUCT(BlueprintType)
+struct FGridTerrainSettings
+{
+	GENERATED_BODY()
+
+	/** Same seed, same terrain, whichever chunk is built first */
+	UPROPERTY(Category="Grid|Terrain", EditAnywhere, BlueprintReadWrite)
+	int32 Seed = 1337;
+
+	/** Noise frequency of the first octave, in cycles per Tile */
+	UPROPERTY(Category="Grid|Terrain", EditAnywhere, BlueprintReadWrite, meta=(ClampMin=0.0001))
+	float Frequency = 0.02f;
+
+	UPROPERTY(Category="Grid|Terrain", EditAnywhere, BlueprintReadWrite, meta=(ClampMin=1, ClampMax=12))
+	int32 Octaves = 4;
+
+	/** Frequency multiplier from one octave to the next */
+	UPROPERTY(Category="Grid|Terrain", EditAnywhere, BlueprintReadWrite, meta=(ClampMin=1.0))
+	float Lacunarity = 2.0f;
+
+	/** Amplitude multiplier from one octave to the next */
+	UPROPERTY(Category="Grid|Terrain", EditAnywhere, BlueprintReadWrite, meta=(ClampMin=0.0, ClampMax=1.0))
+	float Persistence = 0.5f;
+
+	/** Height of the highest Tiles, in Tile steps */
+	UPROPERTY(Category="Grid|Terrain", EditAnywhere, BlueprintReadWrite, meta=(ClampMin=0))
+	int32 MaxHeight = 8;
+
+	/** Tiles with a neighbour more steps above or below them than this become obstacles */
+	UPROPERTY(Category="Grid|Terrain", EditAnywhere, BlueprintReadWrite, meta=(ClampMin=0))
+	int32 MaxWalkableStep = 1;
+
+	/** Frequency of the obstacle noise, in cycles per Tile */
+	UPROPERTY(Category="Grid|Terrain", EditAnywhere, BlueprintReadWrite, meta=(ClampMin=0.0001))
+	float ObstacleFrequency = 0.15f;
+
+	/** Tiles where the obstacle noise, 0 to 1, goes above this become obstacles. 1 turns it off */
+	UPROPERTY(Category="Grid|Terrain", EditAnywhere, BlueprintReadWrite, meta=(ClampMin=0.0, ClampMax=1.0))
+	float ObstacleThreshold = 1.0f;
+};
+
+struct FGridTerrainColumn
+{
+	int32 Height = 0;
+
+	ETileType Type = ETileType::Normal;
+};
+
+/**
+ * Seeded fractal value noise for terrain Grids. Everything is a pure function of the settings and the Tile,
+ * so any chunk can be rebuilt on its own and comes out identical. Rows are sampled as whole batches in
+ * branch free loops, with an integer hash instead of a permutation table, so they vectorize.
+ */
+class GRID_API FGridTerrain
+{
+public:
+	/** Fractal noise in [0, 1] for consecutive Tiles of a row, starting at Start */
+	static void SampleRow(const FGridTerrainSettings& Settings, const uint32 Seed, const float Frequency, const int32 Octaves, const FIntPoint Start, TArrayView<float> OutValues);
+
+	/** Height and type of every column of a chunk, indexed by FGridChunk::GetColumnOffset */
+	static void BuildChunk(const FGridTerrainSettings& Settings, const FIntPoint Chunk, TArray<FGridTerrainColumn>& OutColumns);
+};
@@ -0,0 +1,107 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Engine/EngineTypes.h"
+#include "WorldCollision.h"
+#include "GridTerrain.h"
+#include "GridTerrainTracer.generated.h"
+
+struct FGridGenerationQueue;
+
+/**
+ * How Grids conforming to the world sample it, one vertical trace per Tile
+ */
+USTRUCT(BlueprintType)
+struct FGridTraceSettings
+{
+	GENERATED_BODY()
+
+	UPROPERTY(Category="Grid|Conform", EditAnywhere, BlueprintReadWrite)
+	TEnumAsByte<ECollisionChannel> TraceChannel = ECC_WorldStatic;
+
+	/** Traces start this far above the Grid */
+	UPROPERTY(Category="Grid|Conform", EditAnywhere, BlueprintReadWrite, meta=(ClampMin=0.0))
+	float TraceHeight = 10000.0f;
+
+	/** Traces end this far below the Grid */
+	UPROPERTY(Category="Grid|Conform", EditAnywhere, BlueprintReadWrite, meta=(ClampMin=0.0))
+	float TraceDepth = 10000.0f;
+
+	/** Hits on steeper surfaces make obstacles */
+	UPROPERTY(Category="Grid|Conform", EditAnywhere, BlueprintReadWrite, meta=(ClampMin=0.0, ClampMax=90.0, Units="Degrees"))
+	float MaxWalkableSlope = 35.0f;
+
+	UPROPERTY(Category="Grid|Conform", EditAnywhere, BlueprintReadWrite)
+	bool bTraceComplex = false;
+
+	/** Chunks being traced at once, 1024 traces each */
+	UPROPERTY(Category="Grid|Conform", EditAnywhere, BlueprintReadWrite, meta=(ClampMin=1, ClampMax=64))
+	int32 ChunksInFlight = 4;
+};
+
+/**
+ * Builds a Grid on top of the world with asynchronous line traces, chunk by chunk. Each finished chunk
+ * goes into the generation queue, so the Grid Actor drains it like any generated chunk.
+ * Tiles snap to the hit height, steep hits make obstacles and columns without a hit get no Tile. Game Thread only.
+ */
+class GRID_API FGridTerrainTracer : public TSharedFromThis<FGridTerrainTracer>
+{
+public:
+	FGridTerrainTracer(const FGridTraceSettings& InSettings, const FVector& InBottomLeftCorner, const FVector& InTileSize, const FIntPoint InTileCount, const TSharedRef<FGridGenerationQueue>& InQueue);
+
+	/** Starts tracing chunks until ChunksInFlight are pending */
+	void Tick(UWorld* World, const AActor* IgnoredActor);
+
+	bool IsComplete() const { return NextChunk >= Chunks.Num() && PendingChunks == 0; }
+
+	float GetProgress() const;
+
+private:
+	struct FTracedChunk
+	{
+		FIntPoint Chunk = FIntPoint::ZeroValue;
+
+		int32 RemainingTraces = 0;
+
+		TArray<FGridTerrainColumn> Columns;
+	};
+
+	void TraceChunk(UWorld* World, const FCollisionQueryParams& Params, const int32 Slot);
+
+	void HandleTrace(const FTraceHandle& Handle, FTraceDatum& Datum);
+
+	void FinishChunk(FTracedChunk& Traced);
+
+	FGridTraceSettings Settings;
+
+	FVector BottomLeftCorner;
+
+	FVector TileSize;
+
+	FIntPoint TileCount;
+
+	TSharedRef<FGridGenerationQueue> Queue;
+
+	/** Every chunk to trace, in Morton order */
+	TArray<FIntPoint> Chunks;
+
+	int32 NextChunk = 0;
+
+	/** Chunks being traced, a trace finds its chunk through the slot packed in its user data */
+	TArray<FTracedChunk> Slots;
+
+	TArray<int32> FreeSlots;
+
+	int32 PendingChunks = 0;
+
+	/** Chunks finished but waiting for the ones before them, so they reach the queue in order */
+	TMap<int32, TArray<FGridTileData>> FinishedChunks;
+
+	int32 NextChunkToQueue = 0;
+
+	TMap<FIntPoint, int32> ChunkOrder;
+
+	FTraceDelegate TraceDelegate;
+};
@@ -0,0 +1,106 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Morton (Z-order) codes, interleaving the bits of two coordinates so columns close on the Grid get close codes
+ */
+struct GRID_API FGridMorton
+{
+	/** Spreads the low 32 bits of Value over the even bits */
+	static uint64 SpreadBits(uint64 Value)
+	{
+		Value &= 0x00000000FFFFFFFFull;
+		Value = (Value | (Value << 16)) & 0x0000FFFF0000FFFFull;
+		Value = (Value | (Value << 8)) & 0x00FF00FF00FF00FFull;
+		Value = (Value | (Value << 4)) & 0x0F0F0F0F0F0F0F0Full;
+		Value = (Value | (Value << 2)) & 0x3333333333333333ull;
+		Value = (Value | (Value << 1)) & 0x5555555555555555ull;
+		return Value;
+	}
+
+	/** Gathers the even bits of Value back into the low 32 bits */
+	static uint64 CompactBits(uint64 Value)
+	{
+		Value &= 0x5555555555555555ull;
+		Value = (Value | (Value >> 1)) & 0x3333333333333333ull;
+		Value = (Value | (Value >> 2)) & 0x0F0F0F0F0F0F0F0Full;
+		Value = (Value | (Value >> 4)) & 0x00FF00FF00FF00FFull;
+		Value = (Value | (Value >> 8)) & 0x0000FFFF0000FFFFull;
+		Value = (Value | (Value >> 16)) & 0x00000000FFFFFFFFull;
+		return Value;
+	}
+
+	static uint64 Encode(const uint32 X, const uint32 Y)
+	{
+		return SpreadBits(X) | (SpreadBits(Y) << 1);
+	}
+
+	static void Decode(const uint64 Code, uint32& OutX, uint32& OutY)
+	{
+		OutX = static_cast<uint32>(CompactBits(Code));
+		OutY = static_cast<uint32>(CompactBits(Code >> 1));
+	}
+};
+
+/**
+ * Tile Index packed in 64 bits: the Morton code of the column in the high 42 bits, the height in the low 22.
+ * Sorting keys walks the Grid column by column in Z-order, and the key hashes as a single integer.
+ * X and Y must fit in [-2^20, 2^20), Z in [-2^21, 2^21).
+ */
+struct GRID_API FGridTileKey
+{
+	static constexpr int32 ColumnAxisBits = 21;
+	static constexpr int32 HeightBits = 22;
+
+	static constexpr int32 ColumnBias = 1 << (ColumnAxisBits - 1);
+	static constexpr int32 HeightBias = 1 << (HeightBits - 1);
+
+	uint64 Packed = 0;
+
+	FGridTileKey() = default;
+
+	/** Implicit so containers keyed by FGridTileKey can be used with a plain Index */
+	FGridTileKey(const FIntVector Index)
+		: Packed((GetColumnCode(FIntPoint(Index.X, Index.Y)) << HeightBits) | static_cast<uint64>(static_cast<uint32>(Index.Z + HeightBias) & ((1u << HeightBits) - 1)))
+	{
+	}
+
+	static FGridTileKey FromPacked(const uint64 Packed)
+	{
+		FGridTileKey Key;
+		Key.Packed = Packed;
+		return Key;
+	}
+
+	/** Morton code of a column, what the keys are ordered by first */
+	static uint64 GetColumnCode(const FIntPoint Column)
+	{
+		constexpr uint32 Mask = (1u << ColumnAxisBits) - 1;
+		return FGridMorton::Encode(static_cast<uint32>(Column.X + ColumnBias) & Mask, static_cast<uint32>(Column.Y + ColumnBias) & Mask);
+	}
+
+	FIntVector GetIndex() const
+	{
+		uint32 X, Y;
+		FGridMorton::Decode(Packed >> HeightBits, X, Y);
+
+		const int32 Z = static_cast<int32>(Packed & ((1ull << HeightBits) - 1)) - HeightBias;
+		return FIntVector(static_cast<int32>(X) - ColumnBias, static_cast<int32>(Y) - ColumnBias, Z);
+	}
+
+	uint64 GetColumnCode() const { return Packed >> HeightBits; }
+
+	bool operator==(const FGridTileKey& Other) const { return Packed == Other.Packed; }
+
+	bool operator!=(const FGridTileKey& Other) const { return Packed != Other.Packed; }
+
+	bool operator<(const FGridTileKey& Other) const { return Packed < Other.Packed; }
+
+	friend uint32 GetTypeHash(const FGridTileKey& Key)
+	{
+		return GetTypeHash(Key.Packed);
+	}
+};
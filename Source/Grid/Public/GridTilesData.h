@@ -4,8 +4,11 @@
 
 #include "CoreMinimal.h"
 #include "Engine/DataAsset.h"
+#include "Serialization/BulkData.h"
 #include "GridTilesData.generated.h"
 
+class IBulkDataIORequest;
+
 UENUM(BlueprintType)
 enum class ETileType : uint8
 {
@@ -40,7 +43,11 @@ enum class EGridPattern : uint8
 	HalfDiagonal	UMETA(DisplayName="Half Diagonal"),
 	Star			UMETA(DisplayName="Star"),
 	Diamond			UMETA(DisplayName="Diamond"),
-	Square			UMETA(DisplayName="Square")
+	Square			UMETA(DisplayName="Square"),
+	Circle			UMETA(DisplayName="Circle"),
+	Ring			UMETA(DisplayName="Ring"),
+	Cone			UMETA(DisplayName="Cone"),
+	LineToTarget	UMETA(DisplayName="Line To Target")
 };
 
 USTRUCT(BlueprintType)
@@ -69,20 +76,68 @@ struct FTileHeightTranslator
 {
 	GENERATED_BODY()
 	
+	/** Every Tile of a single X/Y column, kept sorted by Z */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite, Category = "Tile Translator")
 	TArray<FIntVector> Translator;
+
+	/** Inserts the Index in place, keeping the column sorted by Z. Returns false if it was already present */
+	bool AddTile(const FIntVector Index)
+	{
+		int32 InsertAt = 0;
+		for (; InsertAt < Translator.Num(); ++InsertAt)
+		{
+			if (Translator[InsertAt].Z == Index.Z)
+			{
+				return false;
+			}
+
+			if (Translator[InsertAt].Z > Index.Z)
+			{
+				break;
+			}
+		}
+
+		Translator.Insert(Index, InsertAt);
+		return true;
+	}
+
+	/** Removes the Index in place, preserving the Z order. Returns false if it wasn't present */
+	bool RemoveTile(const FIntVector Index)
+	{
+		return Translator.RemoveSingle(Index) > 0;
+	}
 };
 
 
+/**
+ * Decoded form of the compact Tile payload, built off the Game Thread and then moved into the data asset
+ */
+struct GRID_API FGridTilesPayload
+{
+	TMap<FIntVector, FGridTileData> GridTiles;
+	TArray<FIntVector> InstanceIndexes;
+	TMap<FIntPoint, FTileHeightTranslator> TileHeightTranslator;
+};
+
 UCLASS()
 class GRID_API UGridTilesData : public UPrimaryDataAsset
 {
 	GENERATED_BODY()
 
 public:
+	virtual void Serialize(FArchive& Ar) override;
+
+	virtual void PostLoad() override;
+
+	virtual void PostSaveRoot(FObjectPostSaveRootContext ObjectSaveContext) override;
+
+	virtual void BeginDestroy() override;
+
+	/** Kept in Morton order after generation and loading, so neighbouring Tiles sit close together in memory */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	TMap<FIntVector, FGridTileData> GridTiles;
 
+	/** Instance order of Grids saved with a single instance component, the Grid Actor now keeps its instances per chunk */
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	TArray<FIntVector> InstanceIndexes;
 	
@@ -92,6 +147,51 @@ public:
 	UPROPERTY(EditAnywhere, BlueprintReadWrite)
 	TMap<ETileState, FIntVector> TileStateToIndexes;
 
+	/** Columns of an implicit Grid whose default Tile was removed */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TSet<FIntPoint> RemovedImplicitTiles;
+
+	/** Bottom left corner of the Grid, Tiles sitting at their default transform are rebuilt from it on load */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FVector GridOrigin = FVector::ZeroVector;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FVector GridTileSize = FVector::ZeroVector;
+
+	/** Leave the Tile payload on disk when loading, LoadTilePayload or LoadTilePayloadAsync bring it in later */
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	bool bDeferTilePayload = false;
+
+	// ***
+	// Compact Tile payload
+	// ***
+
+	bool HasPendingTilePayload() const { return bTilePayloadPending; }
+
+	/** Blocking load and decode of a deferred Tile payload */
+	void LoadTilePayload();
+
+	/** Streams and decodes a deferred Tile payload off the Game Thread, OnLoaded is called on the Game Thread */
+	void LoadTilePayloadAsync(TFunction<void()> OnLoaded);
+
+	/**
+	 * Chunked binary form of the Tiles: run-length encoded types, delta encoded columns and heights,
+	 * bit-packed states and only the transforms that differ from the one derived from the Index.
+	 * States are stored as a set, their order inside a Tile isn't kept.
+	 */
+	static void EncodeTiles(const TMap<FIntVector, FGridTileData>& Tiles, const TArray<FIntVector>& Instances, const FVector& Origin, const FVector& TileSize, TArray<uint8>& OutBytes);
+
+	static bool DecodeTiles(TArrayView<const uint8> Bytes, const FVector& Origin, const FVector& TileSize, FGridTilesPayload& OutPayload);
+
+	// ***
+	// Tile layout
+	// ***
+
+	/** Reorders the Tile storage by FGridTileKey, columns in Z-order then by height, and compacts it */
+	void SortTilesMorton() { SortTilesMorton(GridTiles); }
+
+	static void SortTilesMorton(TMap<FIntVector, FGridTileData>& Tiles);
+
 	UFUNCTION(BlueprintCallable)
 	static int32 GetTileTypeCost(const ETileType TileType)
 	{
@@ -115,4 +215,25 @@ public:
 	{
 		return TileType != ETileType::None && TileType != ETileType::Obstacle;
 	}
+
+private:
+	void ApplyTilePayload(FGridTilesPayload&& Payload);
+
+	/** Logs a payload that didn't decode and keeps it pending, so it's never replaced by the Tiles in memory */
+	void FailTilePayload();
+
+	FByteBulkData TilePayload;
+
+	bool bTilePayloadPending = false;
+
+	/** Set once the payload failed to decode, loading it isn't tried again */
+	bool bTilePayloadUndecodable = false;
+
+	IBulkDataIORequest* TilePayloadRequest = nullptr;
+
+	TArray<TFunction<void()>> TilePayloadCallbacks;
+
+	/** Units are object references, so they travel through the archive and wait here until the payload is decoded */
+	UPROPERTY(Transient)
+	TMap<FIntVector, TObjectPtr<AActor>> PendingUnitsOnTiles;
 };
@@ -16,4 +16,7 @@ class GRID_API UGridUtilities : public UBlueprintFunctionLibrary
 	
 public:
 	static FVector SnapVectorToVector(const FVector& V1, const FVector& V2);
+
+	/** Location of Tile 0,0 for a Grid of TileCount Tiles centered on CenterLocation */
+	static FVector GetGridBottomLeftCorner(const FVector& CenterLocation, const FVector& TileSize, const FIntPoint TileCount);
 };
@@ -18,6 +18,7 @@
 #include "Styling/SlateStyleRegistry.h"
 
 #include "Tools/GridGenerationTool.h"
+#include "Tools/GridImportTool.h"
 #include "Tools/GridSelectTool.h"
 #include "Tools/GridTileAddTool.h"
 #include "Tools/GridTileDeleteTool.h"
@@ -32,6 +33,7 @@
 const FEditorModeID UGridEditorMode::EM_GridEditorModeId = TEXT("EM_GridEditorMode");
 
 FString UGridEditorMode::GenerationToolName = TEXT("Grid_GenerationTool");
+FString UGridEditorMode::ImportToolName = TEXT("Grid_ImportTool");
 FString UGridEditorMode::SelectToolName = TEXT("Grid_SelectTool");
 FString UGridEditorMode::TileAddToolName = TEXT("Grid_TileAddTool");
 FString UGridEditorMode::TileDeleteToolName = TEXT("Grid_TileDeleteTool");
@@ -71,6 +73,7 @@ void UGridEditorMode::Enter()
 	const FGridEditorModeCommands& SampleToolCommands = FGridEditorModeCommands::Get();
 	
 	RegisterTool(SampleToolCommands.GenerationTool, GenerationToolName, NewObject<UGridGenerationToolBuilder>(this));
+	RegisterTool(SampleToolCommands.ImportTool, ImportToolName, NewObject<UGridImportToolBuilder>(this));
 	RegisterTool(SampleToolCommands.SelectTool, SelectToolName, NewObject<UGridSelectToolBuilder>(this));
 	RegisterTool(SampleToolCommands.TileAddTool, TileAddToolName, NewObject<UGridTileAddToolBuilder>(this));
 	RegisterTool(SampleToolCommands.TileDeleteTool, TileDeleteToolName, NewObject<UGridTileDeleteToolBuilder>(this));
@@ -23,6 +23,9 @@ void FGridEditorModeCommands::RegisterCommands()
 	UI_COMMAND(GenerationTool, "New", "Generates Grid based on provided values", EUserInterfaceActionType::ToggleButton, FInputChord());
 	ToolCommands.Add(GenerationTool);
 
+	UI_COMMAND(ImportTool, "Import", "Imports a Grid from a heightmap and a type map", EUserInterfaceActionType::ToggleButton, FInputChord());
+	ToolCommands.Add(ImportTool);
+
 	UI_COMMAND(SelectTool, "Select", "Select Tool", EUserInterfaceActionType::ToggleButton, FInputChord());
 	ToolCommands.Add(SelectTool);
 
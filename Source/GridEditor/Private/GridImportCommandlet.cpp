@@ -0,0 +1,81 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridImportCommandlet.h"
+#include "GridChunkStore.h"
+#include "GridImporter.h"
+#include "Misc/Paths.h"
+
+DEFINE_LOG_CATEGORY_STATIC(LogGridImportCommandlet, Log, All);
+
+namespace GridImportCommandlet
+{
+	/** X,Y,Z */
+	static bool ParseVector(const FString& Params, const TCHAR* Name, FVector& OutVector)
+	{
+		FString Value;
+		if (!FParse::Value(*Params, Name, Value))
+		{
+			return false;
+		}
+
+		TArray<FString> Components;
+		Value.ParseIntoArray(Components, TEXT(","));
+		if (Components.Num() != 3)
+		{
+			return false;
+		}
+
+		OutVector = FVector(FCString::Atod(*Components[0]), FCString::Atod(*Components[1]), FCString::Atod(*Components[2]));
+		return true;
+	}
+}
+
+UGridImportCommandlet::UGridImportCommandlet()
+{
+	IsClient = false;
+	IsEditor = true;
+	IsServer = false;
+	LogToConsole = true;
+}
+
+int32 UGridImportCommandlet::Main(const FString& Params)
+{
+	FGridImportSettings Settings;
+	FParse::Value(*Params, TEXT("Heightmap="), Settings.HeightmapFile);
+	FParse::Value(*Params, TEXT("TypeMap="), Settings.TypeMapFile);
+	FParse::Value(*Params, TEXT("MaxHeight="), Settings.MaxHeight);
+
+	FString RawSize;
+	if (FParse::Value(*Params, TEXT("RawSize="), RawSize))
+	{
+		FString Width, Height;
+		if (RawSize.Split(TEXT("x"), &Width, &Height, ESearchCase::IgnoreCase))
+		{
+			Settings.RawSize = FIntPoint(FCString::Atoi(*Width), FCString::Atoi(*Height));
+		}
+	}
+
+	FVector TileSize(100.0f, 100.0f, 50.0f);
+	GridImportCommandlet::ParseVector(Params, TEXT("TileSize="), TileSize);
+
+	FVector CenterLocation(0.0f, 0.0f, 0.0f);
+	GridImportCommandlet::ParseVector(Params, TEXT("Center="), CenterLocation);
+
+	FString Output;
+	if (!FParse::Value(*Params, TEXT("Output="), Output))
+	{
+		Output = FPaths::ProjectSavedDir() / TEXT("GridChunks") / TEXT("Imported");
+	}
+
+	UE_LOG(LogGridImportCommandlet, Display, TEXT("Importing %s %s into %s"), *Settings.HeightmapFile, *Settings.TypeMapFile, *Output);
+
+	const TSharedRef<FGridChunkStore> ChunkStore = MakeShared<FGridChunkStore>(Output);
+	ChunkStore->Clear();
+
+	// No scheduler here, the import runs on the commandlet thread and still only holds one band of rows
+	FGridImporter Importer(Settings, CenterLocation, TileSize, ChunkStore);
+	FGridJob Job(TEXT("GridImportCommandlet"));
+
+	return Importer.Run(Job) ? 0 : 1;
+}
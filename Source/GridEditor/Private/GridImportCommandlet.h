@@ -0,0 +1,22 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "GridImportCommandlet.generated.h"
+
+/**
+ * Imports a Grid into a chunk store folder, for content pipelines. Point a streamed Grid Actor's ChunkStoreDirectory at the folder to use it.
+ * -run=GridImport -Heightmap=<png|raw> -TypeMap=<csv|tsv> -Output=<folder> [-RawSize=WxH] [-MaxHeight=8] [-TileSize=X,Y,Z] [-Center=X,Y,Z]
+ */
+UCLASS()
+class UGridImportCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UGridImportCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+};
@@ -0,0 +1,87 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "GridImportTool.h"
+#include "InteractiveToolManager.h"
+#include "Engine/World.h"
+
+// localization namespace
+#define LOCTEXT_NAMESPACE "GridImportTool"
+
+/*
+ * ToolBuilder implementation
+*/
+
+UInteractiveTool* UGridImportToolBuilder::BuildTool(const FToolBuilderState& SceneState) const
+{
+	UGridImportTool* NewTool = NewObject<UGridImportTool>(SceneState.ToolManager);
+	NewTool->SetWorld(SceneState.World);
+	return NewTool;
+}
+
+/*
+ * ToolProperties implementation
+*/
+
+UGridImportToolProperties::UGridImportToolProperties()
+{
+	GridManager = nullptr;
+	Mesh = nullptr;
+	Material = nullptr;
+	CenterLocation = FVector(0.0f, 0.0f, 0.0f);
+	TileSize = FVector(100.0f, 100.0f, 50.0f);
+	RawSize = FIntPoint(0, 0);
+	MaxHeight = 8;
+}
+
+void UGridImportToolProperties::Import() const
+{
+	FGridImportSettings Settings;
+	Settings.HeightmapFile = Heightmap.FilePath;
+	Settings.RawSize = RawSize;
+	Settings.MaxHeight = MaxHeight;
+	Settings.TypeMapFile = TypeMap.FilePath;
+
+	AGridManager* TargetGridManager = GridManager;
+	if (!TargetGridManager)
+	{
+		TargetGridManager = GetWorld()->SpawnActor<AGridManager>(CenterLocation, FRotator::ZeroRotator);
+		TargetGridManager->InitializeGridManager();
+	}
+
+	TargetGridManager->GridActor->InitializeInstances(Mesh, Material);
+	TargetGridManager->GridActor->ImportGrid(CenterLocation, TileSize, Settings);
+}
+
+
+
+/*
+ * Tool implementation
+*/
+
+void UGridImportTool::SetWorld(UWorld* World)
+{
+	this->TargetWorld = World;
+}
+
+void UGridImportTool::Setup()
+{
+	UInteractiveTool::Setup();
+
+	Properties = NewObject<UGridImportToolProperties>(this);
+	AddToolPropertySource(Properties);
+}
+
+void UGridImportTool::OnPropertyModified(UObject* PropertySet, FProperty* Property)
+{
+	if (Property->GetFName() == GET_MEMBER_NAME_CHECKED(UGridImportToolProperties, GridManager) && Properties->GridManager)
+	{
+		Properties->Material = Properties->GridManager->GridActor->GridMaterial;
+		Properties->Mesh = Properties->GridManager->GridActor->GridMesh;
+		Properties->CenterLocation = Properties->GridManager->GridActor->GridCenterLocation;
+		Properties->TileSize = Properties->GridManager->GridActor->GridTileSize;
+	}
+}
+
+
+#undef LOCTEXT_NAMESPACE
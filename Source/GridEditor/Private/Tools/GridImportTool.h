@@ -0,0 +1,96 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "GridManager.h"
+#include "InteractiveToolBuilder.h"
+#include "BaseTools/SingleClickTool.h"
+#include "GridImportTool.generated.h"
+
+/**
+ *  Builder for UGridImportTool
+ */
+UCLASS()
+class GRIDEDITOR_API UGridImportToolBuilder : public UInteractiveToolBuilder
+{
+	GENERATED_BODY()
+
+public:
+	virtual bool CanBuildTool(const FToolBuilderState& SceneState) const override { return true; }
+	virtual UInteractiveTool* BuildTool(const FToolBuilderState& SceneState) const override;
+};
+
+/**
+ * Settings UObject for UGridImportTool
+ */
+UCLASS(Transient)
+class GRIDEDITOR_API UGridImportToolProperties : public UInteractiveToolPropertySet
+{
+	GENERATED_BODY()
+public:
+	UGridImportToolProperties();
+
+	/** Grid reference, assign if you want to replace an existing Grid */
+	UPROPERTY(EditAnywhere, Category = "Grid")
+	TObjectPtr<AGridManager> GridManager;
+
+	/** Grid Mesh */
+	UPROPERTY(EditAnywhere, Category = "Grid")
+	TObjectPtr<UStaticMesh> Mesh;
+
+	/** Grid Material */
+	UPROPERTY(EditAnywhere, Category = "Grid")
+	TObjectPtr<UMaterialInstance> Material;
+
+	/** Center of the Grid */
+	UPROPERTY(EditAnywhere, Category = "Grid")
+	FVector CenterLocation;
+
+	/** Size of each Tile */
+	UPROPERTY(EditAnywhere, Category = "Grid")
+	FVector TileSize;
+
+	/** 8 or 16 bit PNG, or 16 bit RAW */
+	UPROPERTY(EditAnywhere, Category = "Import", meta = (FilePathFilter = "Heightmap (*.png;*.raw;*.r16)|*.png;*.raw;*.r16"))
+	FFilePath Heightmap;
+
+	/** Size of a RAW heightmap, zero for a square one */
+	UPROPERTY(EditAnywhere, Category = "Import")
+	FIntPoint RawSize;
+
+	/** Height of the brightest heightmap value, in Tile steps */
+	UPROPERTY(EditAnywhere, Category = "Import", meta = (ClampMin = 0))
+	int32 MaxHeight;
+
+	/** Tile types, one cell per Tile */
+	UPROPERTY(EditAnywhere, Category = "Import", meta = (FilePathFilter = "Type Map (*.csv;*.tsv;*.txt)|*.csv;*.tsv;*.txt"))
+	FFilePath TypeMap;
+
+	/** Import the Grid in the background, it streams in once done */
+	UFUNCTION(CallInEditor, Category = "Import")
+	void Import() const;
+};
+
+/**
+ * UGridImportTool
+ */
+UCLASS()
+class GRIDEDITOR_API UGridImportTool : public UInteractiveTool
+{
+	GENERATED_BODY()
+
+public:
+	virtual void SetWorld(UWorld* World);
+
+	virtual void Setup() override;
+
+	virtual void OnPropertyModified(UObject* PropertySet, FProperty* Property) override;
+
+protected:
+	UPROPERTY()
+	TObjectPtr<UGridImportToolProperties> Properties;
+
+	/** target World */
+	TObjectPtr<UWorld> TargetWorld;
+};
@@ -7,9 +7,6 @@
 #include "BaseBehaviors/ClickDragBehavior.h"
 #include "Kismet/GameplayStatics.h"
 
-// for raycast into World
-#include "CollisionQueryParams.h"
-
 
 // localization namespace
 #define LOCTEXT_NAMESPACE "GridTileAddTool"
@@ -44,7 +41,7 @@ UGridTileAddToolProperties::UGridTileAddToolProperties()
 FInputRayHit UGridTileAddTool::CanBeginClickDragSequence(const FInputDeviceRay& PressPos)
 {
 	// we only start drag if press-down is on top of something we can raycast
-	FVector Temp;
+	FIntVector Temp;
 	FInputRayHit Result = FindRayHit(PressPos.WorldRay, Temp);
 	return Result;
 }
@@ -60,14 +57,14 @@ void UGridTileAddTool::OnClickDrag(const FInputDeviceRay& DragPos)
 	if (!Properties->GridManager)
 		return;
 	
-	FVector HitPos;
-	FindRayHit(DragPos.WorldRay, HitPos);
+	FIntVector HitIndex;
+	FindRayHit(DragPos.WorldRay, HitIndex);
 
 	
 	// Selecting multiple tiles?
 	if (Properties->Pattern != EGridPattern::None && (Properties->Range.X > 0 || Properties->Range.Y > 0))
 	{
-		const TArray<FIntVector> Indexes = Properties->GridManager->GridActor->GetIndexesFromPatternAndRange(Properties->GridManager->GridActor->GetTileIndexFromWorldLocation(HitPos), Properties->Pattern, Properties->Range);
+		const TArray<FIntVector> Indexes = Properties->GridManager->GridActor->GetIndexesFromPatternAndRange(HitIndex, Properties->Pattern, Properties->Range);
 		
 		// Shift down?
 		if (!bShiftModifierDown)
@@ -88,44 +85,42 @@ void UGridTileAddTool::OnClickDrag(const FInputDeviceRay& DragPos)
 	{
 		Properties->GridManager->GridActor->AddGridTile(
 		FGridTileData(
-			Properties->GridManager->GridActor->GetTileIndexFromWorldLocation(HitPos),
+			HitIndex,
 			ETileType::Normal,
 			FTransform(
 			FRotator(0,0,0),
-			Properties->GridManager->GridActor->GetTileLocationFromGridIndex(Properties->GridManager->GridActor->GetTileIndexFromWorldLocation(HitPos)),
+			Properties->GridManager->GridActor->GetTileLocationFromGridIndex(HitIndex),
 						Properties->GridManager->GridActor->GetTileScale()
 						)));
 	}
 	else
 	{
-		Properties->GridManager->GridActor->RemoveGridTile(Properties->GridManager->GridActor->GetTileIndexFromWorldLocation(HitPos));
+		Properties->GridManager->GridActor->RemoveGridTile(HitIndex);
 	}
 	
 }
 
-FInputRayHit UGridTileAddTool::FindRayHit(const FRay& WorldRay, FVector& HitPos)
+FInputRayHit UGridTileAddTool::FindRayHit(const FRay& WorldRay, FIntVector& HitIndex)
 {
-	 // trace a ray into the World
-	FCollisionObjectQueryParams QueryParams(FCollisionObjectQueryParams::AllObjects);
-	 FHitResult Result;
-
-	// @TODO: Iannis - Implement world trace by changing it to a LineTraceSingleByChannel
-	bool bHitWorld = TargetWorld->LineTraceSingleByObjectType(Result, WorldRay.Origin, WorldRay.PointAt(999999), QueryParams);
-	if (bHitWorld)
+	if (!Properties->GridManager || !Properties->GridManager->GridActor)
 	{
-		HitPos = Result.ImpactPoint;
-		return FInputRayHit(Result.Distance);
+		return FInputRayHit();
 	}
 
-	if (Properties->GridManager)
+	const AGridActor* Grid = Properties->GridManager->GridActor;
+
+	// Walks the Tile columns under the ray instead of a physics trace, Tiles without collision can be picked too
+	FGridRayHit Hit;
+	if (Grid->TraceGridTiles(WorldRay.Origin, WorldRay.PointAt(999999), Hit))
 	{
-		// If nothing hit, we simulate a plane and make the system think it hit something
-		const FPlane Plane = FPlane(Properties->GridManager->GridActor->GridCenterLocation, FVector(0.0f, 0.0f,1.0f));
-		HitPos = FMath::LinePlaneIntersection(WorldRay.Origin, WorldRay.PointAt(999999), Plane);
-		return FInputRayHit(0);
+		HitIndex = Hit.Index;
+		return FInputRayHit(Hit.Distance);
 	}
-	
-	return FInputRayHit();
+
+	// If nothing hit, we simulate a plane and make the system think it hit something
+	const FPlane Plane = FPlane(Grid->GridCenterLocation, FVector(0.0f, 0.0f,1.0f));
+	HitIndex = Grid->GetTileIndexFromWorldLocation(FMath::LinePlaneIntersection(WorldRay.Origin, WorldRay.PointAt(999999), Plane));
+	return FInputRayHit(0);
 }
 
 
@@ -79,5 +79,5 @@ protected:
 	static const int ShiftModifierID = 1;		// identifier we associate with the shift key
 	bool bShiftModifierDown = false;					// flag we use to keep track of modifier state
 
-	FInputRayHit FindRayHit(const FRay& WorldRay, FVector& HitPos);		// raycasts into World
+	FInputRayHit FindRayHit(const FRay& WorldRay, FIntVector& HitIndex);		// Tile under the ray, or the Grid plane
 };
\ No newline at end of file
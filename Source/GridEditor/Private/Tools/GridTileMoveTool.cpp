@@ -7,9 +7,6 @@
 #include "BaseBehaviors/ClickDragBehavior.h"
 #include "Kismet/GameplayStatics.h"
 
-// for raycast into World
-#include "CollisionQueryParams.h"
-
 
 // localization namespace
 #define LOCTEXT_NAMESPACE "GridTileMoveTool"
@@ -46,7 +43,7 @@ UGridTileMoveToolProperties::UGridTileMoveToolProperties()
 FInputRayHit UGridTileMoveTool::CanBeginClickDragSequence(const FInputDeviceRay& PressPos)
 {
 	// we only start drag if press-down is on top of something we can raycast
-	FVector Temp;
+	FIntVector Temp;
 	bool TempBool;
 	FInputRayHit Result = FindRayHit(PressPos.WorldRay, Temp, TempBool);
 	return Result;
@@ -55,81 +52,47 @@ FInputRayHit UGridTileMoveTool::CanBeginClickDragSequence(const FInputDeviceRay&
 void UGridTileMoveTool::OnClickPress(const FInputDeviceRay& PressPos)
 {
 	bFirstClick = true;
+	BeginStroke();
 	OnClickDrag(PressPos);
 }
 
 void UGridTileMoveTool::OnClickDrag(const FInputDeviceRay& DragPos)
 {
-	if (Properties->GridManager)
+	if (Properties->GridManager && bStrokeActive)
 	{
-		FVector HitPos;
-		bool bHitWorld;
-		FindRayHit(DragPos.WorldRay, HitPos, bHitWorld);
+		FIntVector TileIndex;
+		bool bHitTile;
+		FindRayHit(DragPos.WorldRay, TileIndex, bHitTile);
 
-		if (!bHitWorld)
+		if (!bHitTile)
 			return;
 
-		const FIntVector TileIndex = Properties->GridManager->GridActor->GetTileIndexFromWorldLocation(HitPos);
-
-		// If it's the same Index, excluding Z, then we can continue
-		//if (PreviousIndex == FIntPoint(TileIndex.X, TileIndex.Y))
-		//	return;
-		//PreviousIndex = FIntPoint(TileIndex.X, TileIndex.Y);
-
-		
-
 		// Shift down?
 		const int32 Modifier = bShiftModifierDown ? -1 : 1;
 
 		// Selecting multiple tiles?
 		if (Properties->Pattern != EGridPattern::None && (Properties->Range.X > 0 || Properties->Range.Y > 0))
 		{
-			const TArray<FIntVector> Indexes = Properties->GridManager->GridActor->GetIndexesFromPatternAndRange(Properties->GridManager->GridActor->GetTileIndexFromWorldLocation(HitPos), Properties->Pattern, Properties->Range);
-			
-			for (FIntVector Index : Indexes)
+			// Cached offsets of the pattern, stamped around the hit Tile
+			const TSharedRef<const TArray<FIntVector>> Offsets = AGridActor::GetPatternOffsets(Properties->Pattern, Properties->Range);
+			for (const FIntVector Offset : *Offsets)
 			{
-				if (!PreviousIndexes.Contains(FIntPoint(Index.X, Index.Y)))
+				const FIntPoint Column(TileIndex.X + Offset.X, TileIndex.Y + Offset.Y);
+				if (IsColumnVisited(Column))
+				{
+					continue;
+				}
+
+				bool bQueued = false;
+				for (const FIntVector Tile : Properties->GridManager->GridActor->GetGridTilesAtIndex(Column))
+				{
+					bQueued |= QueueTileMove(Tile, TileIndex.Z, Modifier);
+				}
+
+				// Past the first click a column that didn't move won't move later in the stroke either
+				if (bQueued || !bFirstClick)
 				{
-					TArray<FIntVector> Tiles = Properties->GridManager->GridActor->FindGridTilesAtIndex(FIntPoint(Index.X, Index.Y));
-
-					for (FIntVector Tile : Tiles)
-					{
-						switch (Properties->MoveMode)
-						{
-						case ETileMoveMode::Flatten:
-							if (StartingZ != Tile.Z && !bFirstClick)
-							{
-								Properties->GridManager->GridActor->MoveGridTile(Tile, (StartingZ - Tile.Z));
-								PreviousIndexes.Emplace(FIntPoint(Tile.X, Tile.Y));
-							}
-							else if (TileIndex.Z == Tile.Z && bFirstClick)
-							{
-								StartingZ = (TileIndex.Z + Properties->MoveAmount) * Modifier;
-								Properties->GridManager->GridActor->MoveGridTile(Tile, Properties->MoveAmount * Modifier);
-								PreviousIndexes.Emplace(FIntPoint(Tile.X, Tile.Y));
-							}
-						break;
-
-						case ETileMoveMode::Add:
-							Properties->GridManager->GridActor->MoveGridTile(Tile, Properties->MoveAmount * Modifier);
-							PreviousIndexes.Emplace(FIntPoint(Tile.X, Tile.Y));
-						break;
-
-						case ETileMoveMode::Preserve:
-							if (StartingZ == Tile.Z && !bFirstClick)
-							{
-								Properties->GridManager->GridActor->MoveGridTile(Tile, Properties->MoveAmount * Modifier);
-								PreviousIndexes.Emplace(FIntPoint(Tile.X, Tile.Y));
-							}
-							else if (TileIndex.Z == Tile.Z && bFirstClick)
-							{
-								StartingZ = (TileIndex.Z + Properties->MoveAmount - 1) * Modifier;
-								Properties->GridManager->GridActor->MoveGridTile(Tile, Properties->MoveAmount * Modifier);
-								PreviousIndexes.Emplace(FIntPoint(Tile.X, Tile.Y));
-							}
-						break;
-						}
-					}
+					MarkColumnVisited(Column);
 				}
 			}
 
@@ -137,42 +100,12 @@ void UGridTileMoveTool::OnClickDrag(const FInputDeviceRay& DragPos)
 			return;
 		}
 
-		if (!PreviousIndexes.Contains(FIntPoint(TileIndex.X, TileIndex.Y)))
+		const FIntPoint Column(TileIndex.X, TileIndex.Y);
+		if (!IsColumnVisited(Column))
 		{
-			switch (Properties->MoveMode)
+			if (QueueTileMove(TileIndex, TileIndex.Z, Modifier))
 			{
-			case ETileMoveMode::Flatten:
-				if (StartingZ != TileIndex.Z && !bFirstClick)
-				{
-					Properties->GridManager->GridActor->MoveGridTile(TileIndex, (StartingZ - TileIndex.Z));
-					PreviousIndexes.Emplace(FIntPoint(TileIndex.X, TileIndex.Y));
-				}
-				else if (bFirstClick)
-				{
-					StartingZ = (TileIndex.Z + Properties->MoveAmount) * Modifier;
-					Properties->GridManager->GridActor->MoveGridTile(TileIndex, Properties->MoveAmount * Modifier);
-					PreviousIndexes.Emplace(FIntPoint(TileIndex.X, TileIndex.Y));
-				}
-			break;
-				
-			case ETileMoveMode::Add:
-				Properties->GridManager->GridActor->MoveGridTile(TileIndex, Properties->MoveAmount * Modifier);
-				PreviousIndexes.Emplace(FIntPoint(TileIndex.X, TileIndex.Y));
-			break;
-
-			case ETileMoveMode::Preserve:
-				if (StartingZ == TileIndex.Z && !bFirstClick)
-				{
-					Properties->GridManager->GridActor->MoveGridTile(TileIndex, Properties->MoveAmount * Modifier);
-					PreviousIndexes.Emplace(FIntPoint(TileIndex.X, TileIndex.Y));
-				}
-				else if (bFirstClick)
-				{
-					StartingZ = (TileIndex.Z + Properties->MoveAmount - 1) * Modifier;
-					Properties->GridManager->GridActor->MoveGridTile(TileIndex, Properties->MoveAmount * Modifier);
-					PreviousIndexes.Emplace(FIntPoint(TileIndex.X, TileIndex.Y));
-				}
-			break;
+				MarkColumnVisited(Column);
 			}
 			bFirstClick = false;
 		}
@@ -181,23 +114,158 @@ void UGridTileMoveTool::OnClickDrag(const FInputDeviceRay& DragPos)
 
 void UGridTileMoveTool::OnClickRelease(const FInputDeviceRay& ReleasePos)
 {
-	PreviousIndexes.Empty();
+	EndStroke();
 }
 
+void UGridTileMoveTool::OnTerminateDragSequence()
+{
+	EndStroke();
+}
 
-FInputRayHit UGridTileMoveTool::FindRayHit(const FRay& WorldRay, FVector& HitPos, bool& HitWorld)
+void UGridTileMoveTool::OnTick(float DeltaTime)
 {
-	 // trace a ray into the World
-	FCollisionObjectQueryParams QueryParams(FCollisionObjectQueryParams::AllObjects);
-	 FHitResult Result;
+	CommitPendingMoves();
+}
 
-	// @TODO: Iannis - Implement world trace by changing it to a LineTraceSingleByChannel
-	bool bHitWorld = TargetWorld->LineTraceSingleByObjectType(Result, WorldRay.Origin, WorldRay.PointAt(999999), QueryParams);
-	HitWorld = bHitWorld;
-	if (bHitWorld)
+
+/*
+ * Stroke
+*/
+
+void UGridTileMoveTool::BeginStroke()
+{
+	EndStroke();
+
+	if (!Properties->GridManager || !Properties->GridManager->GridActor)
+	{
+		return;
+	}
+
+	AGridActor* GridActor = Properties->GridManager->GridActor;
+
+	VisitedSize = GridActor->GridTileCount + FIntPoint(1, 1);
+	VisitedColumns.Init(false, VisitedSize.X * VisitedSize.Y);
+
+	// The whole stroke undoes at once, the Tiles are recorded when it starts rather than on every move
+	GetToolManager()->BeginUndoTransaction(LOCTEXT("MoveTilesTransaction", "Move Tiles"));
+	GridActor->Modify();
+	if (GridActor->GridTilesData)
+	{
+		GridActor->GridTilesData->Modify();
+	}
+	bStrokeActive = true;
+}
+
+void UGridTileMoveTool::EndStroke()
+{
+	if (!bStrokeActive)
 	{
-		HitPos = Result.ImpactPoint;
-		return FInputRayHit(Result.Distance);
+		return;
+	}
+
+	CommitPendingMoves();
+	GetToolManager()->EndUndoTransaction();
+
+	VisitedColumns.Empty();
+	VisitedSize = FIntPoint::ZeroValue;
+	bStrokeActive = false;
+}
+
+void UGridTileMoveTool::CommitPendingMoves()
+{
+	if (PendingIndexes.IsEmpty())
+	{
+		return;
+	}
+
+	// Instances keep their slot and only their transform is updated, once per chunk for everything the frame's drags gathered
+	if (Properties->GridManager && Properties->GridManager->GridActor)
+	{
+		Properties->GridManager->GridActor->MoveGridTiles(PendingIndexes, PendingAmounts);
+	}
+
+	PendingIndexes.Reset();
+	PendingAmounts.Reset();
+}
+
+bool UGridTileMoveTool::QueueTileMove(const FIntVector& Tile, const int32 HitZ, const int32 Modifier)
+{
+	int32 Amount = 0;
+	switch (Properties->MoveMode)
+	{
+	case ETileMoveMode::Flatten:
+		if (StartingZ != Tile.Z && !bFirstClick)
+		{
+			Amount = StartingZ - Tile.Z;
+		}
+		else if (HitZ == Tile.Z && bFirstClick)
+		{
+			StartingZ = (HitZ + Properties->MoveAmount) * Modifier;
+			Amount = Properties->MoveAmount * Modifier;
+		}
+	break;
+
+	case ETileMoveMode::Add:
+		Amount = Properties->MoveAmount * Modifier;
+	break;
+
+	case ETileMoveMode::Preserve:
+		if (StartingZ == Tile.Z && !bFirstClick)
+		{
+			Amount = Properties->MoveAmount * Modifier;
+		}
+		else if (HitZ == Tile.Z && bFirstClick)
+		{
+			StartingZ = (HitZ + Properties->MoveAmount - 1) * Modifier;
+			Amount = Properties->MoveAmount * Modifier;
+		}
+	break;
+	}
+
+	if (Amount == 0)
+	{
+		return false;
+	}
+
+	PendingIndexes.Emplace(Tile);
+	PendingAmounts.Emplace(Amount);
+	return true;
+}
+
+bool UGridTileMoveTool::IsColumnVisited(const FIntPoint& Column) const
+{
+	// Columns off the Grid have no Tiles, they count as done
+	if (Column.X < 0 || Column.Y < 0 || Column.X >= VisitedSize.X || Column.Y >= VisitedSize.Y)
+	{
+		return true;
+	}
+	return VisitedColumns[Column.Y * VisitedSize.X + Column.X];
+}
+
+void UGridTileMoveTool::MarkColumnVisited(const FIntPoint& Column)
+{
+	if (Column.X >= 0 && Column.Y >= 0 && Column.X < VisitedSize.X && Column.Y < VisitedSize.Y)
+	{
+		VisitedColumns[Column.Y * VisitedSize.X + Column.X] = true;
+	}
+}
+
+
+FInputRayHit UGridTileMoveTool::FindRayHit(const FRay& WorldRay, FIntVector& HitIndex, bool& HitTile)
+{
+	HitTile = false;
+	if (!Properties->GridManager || !Properties->GridManager->GridActor)
+	{
+		return FInputRayHit();
+	}
+
+	// Walks the Tile columns under the ray instead of a physics trace, Tiles without collision can be picked too
+	FGridRayHit Hit;
+	HitTile = Properties->GridManager->GridActor->TraceGridTiles(WorldRay.Origin, WorldRay.PointAt(999999), Hit);
+	if (HitTile)
+	{
+		HitIndex = Hit.Index;
+		return FInputRayHit(Hit.Distance);
 	}
 	return FInputRayHit();
 }
@@ -226,6 +294,12 @@ void UGridTileMoveTool::Setup()
 	AddToolPropertySource(Properties);
 }
 
+void UGridTileMoveTool::Shutdown(EToolShutdownType ShutdownType)
+{
+	EndStroke();
+	UInteractiveTool::Shutdown(ShutdownType);
+}
+
 void UGridTileMoveTool::OnUpdateModifierState(int ModifierID, bool bIsOn)
 {
 	// keep track of the "second point" modifier (shift key for mouse input)
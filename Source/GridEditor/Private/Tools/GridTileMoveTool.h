@@ -73,12 +73,17 @@ public:
 
 	virtual void Setup() override;
 
+	virtual void Shutdown(EToolShutdownType ShutdownType) override;
+
+	/** Moves gathered by the drags of this frame are applied here, once */
+	virtual void OnTick(float DeltaTime) override;
+
 	/** IClickDragBehaviorTarget implementation */
 	virtual FInputRayHit CanBeginClickDragSequence(const FInputDeviceRay& PressPos) override;
 	virtual void OnClickPress(const FInputDeviceRay& PressPos) override;
 	virtual void OnClickDrag(const FInputDeviceRay& DragPos) override;
 	virtual void OnClickRelease(const FInputDeviceRay& ReleasePos) override;
-	virtual void OnTerminateDragSequence() override {}
+	virtual void OnTerminateDragSequence() override;
 
 	virtual void OnUpdateModifierState(int ModifierID, bool bIsOn) override;
 	
@@ -92,9 +97,20 @@ protected:
 
 	static const int ShiftModifierID = 1;								// identifier we associate with the shift key
 	bool bShiftModifierDown = false;									// flag we use to keep track of modifier state
-	TArray<FIntPoint> PreviousIndexes;									// used to track previous index so we don't keep modifying height of same tile, don't consider Z
+	TBitArray<> VisitedColumns;											// columns already moved this stroke so we don't keep modifying height of same tile, don't consider Z
+	FIntPoint VisitedSize = FIntPoint::ZeroValue;						// size of the visited columns, a column is bit Y * Size.X + X
+	TArray<FIntVector> PendingIndexes;									// Tiles moved by the stroke since the last commit
+	TArray<int32> PendingAmounts;										// move amount of each pending Tile
+	bool bStrokeActive = false;											// a stroke is running, its undo transaction is open
 	bool bFirstClick = true;											// used to track if it's the first click for filtering reasons, we can always enforce the first move
 	int32 StartingZ = 0;												// used to track the starting Z when clicking, useful for out of bounds situations
 
-	FInputRayHit FindRayHit(const FRay& WorldRay, FVector& HitPos, bool& HitWorld);		// raycasts into World
+	FInputRayHit FindRayHit(const FRay& WorldRay, FIntVector& HitIndex, bool& HitTile);		// Tile under the ray
+
+	void BeginStroke();													// opens the undo transaction of a press and resets the visited columns
+	void EndStroke();													// commits what's left and closes the transaction
+	void CommitPendingMoves();											// moves the pending Tiles in one batch
+	bool QueueTileMove(const FIntVector& Tile, const int32 HitZ, const int32 Modifier);	// queues a move of a Tile depending on the move mode, false if it stays
+	bool IsColumnVisited(const FIntPoint& Column) const;
+	void MarkColumnVisited(const FIntPoint& Column);
 };
\ No newline at end of file
@@ -25,6 +25,7 @@ public:
 	const static FEditorModeID EM_GridEditorModeId;
 	
 	static FString GenerationToolName;
+	static FString ImportToolName;
 	static FString SelectToolName;
 	static FString TileAddToolName;
 	static FString TileDeleteToolName;
@@ -17,6 +17,7 @@ public:
 	static TMap<FName, TArray<TSharedPtr<FUICommandInfo>>> GetCommands();
 	
 	TSharedPtr<FUICommandInfo> GenerationTool;
+	TSharedPtr<FUICommandInfo> ImportTool;
 	TSharedPtr<FUICommandInfo> SelectTool;
 	TSharedPtr<FUICommandInfo> TileAddTool;
 	TSharedPtr<FUICommandInfo> TileDeleteTool;